@@ -0,0 +1,356 @@
+//	compile command
+// 		gcc -Wall -O3 -o benchKernel benchKernel.c textKernel.c wordFreq.c -lpthread
+// 		(add -mavx2 for the 32 byte ascii fast path, or -U__SSE2__ -mno-sse2 for the plain table decoder)
+
+//	run command
+// 		./benchKernel [-b bytes] [-k chunk_size] [-r repetitions] [-w warmup] [-p cpu] [file...]
+
+//	options
+// 		-b bytes	size of each generated buffer (default 16 MB)
+// 		-k bytes	size of the chunks the buffer is processed in (default the whole buffer)
+// 		-r reps		timed repetitions, the best and the median are reported (default 20)
+// 		-w reps		untimed warmup repetitions (default 3)
+// 		-p cpu		cpu the benchmark is pinned to (default the cpu it starts on)
+// 		file...		also run over the given files, read into memory first
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "consts.h"
+#include "textKernel.h"
+
+/** \brief character mix of a generated buffer */
+struct Mix {
+	const char* name;
+	const char** tokens;
+	int nTokens;
+};
+
+/** \brief plain ascii words and spaces */
+static const char* asciiTokens[] = { "casa", "de", "que", "o", "para", "com", "uma", "os", "no", "se", "mais", "como", " ", " ", " ", " ", " ", " ", "\n" };
+
+/** \brief accented words, nearly every other letter is a two byte char */
+static const char* accentTokens[] = { "não", "está", "você", "ação", "àquela", "pôr", "órgão", "público", "Érico", "Ângela", "três", "lá", " ", " ", " ", " ", " ", " ", "\n" };
+
+/** \brief short words between ascii and typographic punctuation */
+static const char* punctuationTokens[] = { "a", "é", "x", "“", "”", "–", "…", ", ", ". ", "(", ")", "-", "?", "!", ";", ":", "\"", " ", "\n" };
+
+/** \brief character mixes of the generated buffers */
+static const struct Mix mixes[] = {
+	{ "ascii", asciiTokens, sizeof(asciiTokens) / sizeof(asciiTokens[0]) },
+	{ "accents", accentTokens, sizeof(accentTokens) / sizeof(accentTokens[0]) },
+	{ "punctuation", punctuationTokens, sizeof(punctuationTokens) / sizeof(punctuationTokens[0]) },
+	{ "random bytes", NULL, 0 }
+};
+
+/** \brief thread return status, set by the word tables on errors */
+int *statusWorkers = NULL;
+
+/** \brief main thread return status */
+int statusMain;
+
+/** \brief keeps the results alive, so the kernel calls are not optimized away */
+static long checksum = 0;
+
+/** \brief fill a buffer with a character mix */
+static void fillBuffer(unsigned char* buffer, int size, const struct Mix* mix);
+
+/** \brief read a file into memory */
+static unsigned char* readFile(const char* fileName, int* size);
+
+/** \brief run the kernel over a buffer and print its throughput */
+static void benchBuffer(const char* name, unsigned char* buffer, int size, int chunkSize, int reps, int warmup);
+
+/** \brief nanoseconds of CLOCK_MONOTONIC_RAW */
+static double rawTime(void);
+
+/** \brief time stamp counter, 0 where there is none */
+static unsigned long long cycles(void);
+
+/** \brief compare two doubles, for qsort */
+static int compareDoubles(const void* a, const void* b);
+
+/**
+ *  \brief Main function.
+ *
+ *  Runs the text kernel over in memory buffers of each character mix, and over the given files,
+ *  without any I/O or locking in the timed loop.
+ *
+ *  \param argc number of words of the command line
+ *  \param argv list of words of the command line
+ *
+ *  \return status of operation
+ */
+
+int main(int argc, char *argv[])
+{
+	int size = 16 << 20, chunkSize = 0, reps = 20, warmup = 3;
+	int cpu = sched_getcpu();
+	int opt;
+
+	// parse command line options
+	while ((opt = getopt(argc, argv, "b:k:r:w:p:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'b':
+				size = atoi(optarg);
+				break;
+			case 'k':
+				chunkSize = atoi(optarg);
+				break;
+			case 'r':
+				reps = atoi(optarg);
+				break;
+			case 'w':
+				warmup = atoi(optarg);
+				break;
+			case 'p':
+				cpu = atoi(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-b bytes] [-k chunk_size] [-r repetitions] [-w warmup] [-p cpu] [file...]\n", argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+
+	if (size < 1 || chunkSize < 0 || reps < 1 || warmup < 0)
+	{
+		fprintf(stderr, "invalid option value\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* pin to a single cpu, so the time stamp counter and the caches stay the same */
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	if (sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+		perror("error on pinning the benchmark, running unpinned");
+
+	initDecoder();
+
+	printf("cpu %d, %d repetitions after %d warmup, chunks of %d bytes\n", cpu, reps, warmup, (chunkSize > 0) ? chunkSize : size);
+	printf("%-16s %10s %12s %12s %12s %12s %10s\n", "input", "MB", "best ns/B", "median ns/B", "best B/cyc", "median B/cyc", "best GB/s");
+
+	unsigned char* buffer;
+	if ((buffer = malloc(size)) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the benchmark buffer\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int m = 0; m < (int) (sizeof(mixes) / sizeof(mixes[0])); m++)
+	{
+		fillBuffer(buffer, size, &mixes[m]);
+		benchBuffer(mixes[m].name, buffer, size, chunkSize, reps, warmup);
+	}
+	free(buffer);
+
+	for (int i = optind; i < argc; i++)
+	{
+		int fileSize;
+
+		buffer = readFile(argv[i], &fileSize);
+		benchBuffer(argv[i], buffer, fileSize, chunkSize, reps, warmup);
+		free(buffer);
+	}
+
+	printf("checksum %ld\n", checksum);
+
+	return 0;
+}
+
+/**
+ *  \brief Fill a buffer with a character mix, tokens picked at random with a fixed seed.
+ *
+ *  \param buffer buffer to fill
+ *  \param size buffer size
+ *  \param mix character mix, random bytes without tokens
+ */
+
+static void fillBuffer(unsigned char* buffer, int size, const struct Mix* mix)
+{
+	unsigned int state = 12345;
+
+	for (int pos = 0; pos < size; )
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+
+		if (mix->tokens == NULL)
+		{
+			buffer[pos++] = (unsigned char) state;
+			continue;
+		}
+
+		const char* token = mix->tokens[state % mix->nTokens];
+		int length = (int) strlen(token);
+
+		if (length > size - pos)
+			length = size - pos;
+		memcpy(buffer + pos, token, length);
+		pos += length;
+	}
+}
+
+/**
+ *  \brief Read a file into memory.
+ *
+ *  \param fileName file name
+ *  \param size size of the file
+ *
+ *  \return file contents
+ */
+
+static unsigned char* readFile(const char* fileName, int* size)
+{
+	FILE* file;
+	unsigned char* buffer;
+
+	if ((file = fopen(fileName, "r")) == NULL)
+	{
+		fprintf(stderr, "error on opening text file \"%s\"\n", fileName);
+		exit(EXIT_FAILURE);
+	}
+	fseek(file, 0, SEEK_END);
+	*size = (int) ftell(file);
+	rewind(file);
+
+	if ((buffer = malloc(*size + 1)) == NULL || fread(buffer, 1, *size, file) != (size_t) *size)
+	{
+		fprintf(stderr, "error on reading text file \"%s\"\n", fileName);
+		exit(EXIT_FAILURE);
+	}
+	fclose(file);
+
+	return buffer;
+}
+
+/**
+ *  \brief Run the kernel over a buffer and print its throughput.
+ *
+ *  Each repetition processes the whole buffer, chunk after chunk, and joins the chunk edges as main
+ *  would. The best repetition shows what the kernel can do, the median how steady it is.
+ *
+ *  \param name input name
+ *  \param buffer buffer
+ *  \param size buffer size
+ *  \param chunkSize chunk size, 0 for the whole buffer
+ *  \param reps timed repetitions
+ *  \param warmup untimed repetitions
+ */
+
+static void benchBuffer(const char* name, unsigned char* buffer, int size, int chunkSize, int reps, int warmup)
+{
+	double* times;
+	double* rates;
+
+	if (size == 0)
+		return;
+	if (chunkSize == 0 || chunkSize > size)
+		chunkSize = size;
+
+	if ((times = malloc(reps * sizeof(double))) == NULL || (rates = malloc(reps * sizeof(double))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the benchmark times\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int r = -warmup; r < reps; r++)
+	{
+		struct ChunkSummary summary;
+		struct FileResult result = { 0 };
+
+		memset(&summary, 0, sizeof(summary));
+
+		double t0 = rawTime();
+		unsigned long long c0 = cycles();
+
+		for (int pos = 0; pos < size; pos += chunkSize)
+		{
+			struct ChunkSummary chunk = processChunk(buffer + pos, (size - pos < chunkSize) ? size - pos : chunkSize);
+
+			summary.nWords += chunk.nWords;
+			for (int i = 0; i < 6; i++)
+				summary.vowels[i] += chunk.vowels[i];
+			joinEdges(&summary, &chunk.edges);
+		}
+		addSummary(&result, &summary);
+
+		unsigned long long c1 = cycles();
+		double t1 = rawTime();
+
+		checksum += result.nWords + result.vowels[A];
+		if (r >= 0)
+		{
+			times[r] = (t1 - t0) / size;
+			rates[r] = (c1 > c0) ? (double) size / (double) (c1 - c0) : 0.0;
+		}
+	}
+
+	qsort(times, reps, sizeof(double), compareDoubles);
+	qsort(rates, reps, sizeof(double), compareDoubles);
+
+	printf("%-16s %10.2f %12.4f %12.4f %12.3f %12.3f %10.3f\n", name, size / 1.0e6, times[0], times[reps / 2],
+		rates[reps - 1], rates[(reps - 1) / 2], 1.0 / times[0]);
+
+	free(times);
+	free(rates);
+}
+
+/**
+ *  \brief Nanoseconds of CLOCK_MONOTONIC_RAW.
+ *
+ *  \return nanoseconds
+ */
+
+static double rawTime(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+	return t.tv_sec * 1.0e9 + t.tv_nsec;
+}
+
+/**
+ *  \brief Time stamp counter (reference cycles, they do not follow frequency scaling).
+ *
+ *  \return cycles, 0 where there is no time stamp counter
+ */
+
+static unsigned long long cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/**
+ *  \brief Compare two doubles, for qsort.
+ *
+ *  \param a first double
+ *  \param b second double
+ *
+ *  \return negative, zero or positive
+ */
+
+static int compareDoubles(const void* a, const void* b)
+{
+	double x = *(const double*) a, y = *(const double*) b;
+
+	return (x > y) - (x < y);
+}
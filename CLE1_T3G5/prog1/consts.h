@@ -31,25 +31,471 @@
 /** \brief "y" character offset */
 #define Y 5
 
-/** \brief chunck size to be read */
-#define  MAX_CHUNK_SIZE           4096
+/** \brief largest number of worker threads accepted */
+#define  MAX_THREADS              4096
 
-/** \brief file results structure */
+/** \brief smallest chunk size, the chunk unit is never below it */
+#define  MIN_CHUNK_SIZE           4096
+
+/** \brief largest chunk size to be read */
+#define  MAX_CHUNK_SIZE           (16 << 20)
+
+/** \brief processing a chunk takes at least this many times its fixed overhead */
+#define  CHUNK_OVERHEAD           100
+
+/** \brief guided chunks are the remaining bytes split this many times per worker */
+#define  GUIDED_FACTOR            2
+
+/** \brief maximum number of bytes of an utf-8 char */
+#define  MAX_CHAR_BYTES           6
+
+/** \brief malformed utf-8 sequences whose offsets are kept, per chunk and per file */
+#define  INVALID_OFFSETS          4
+
+/** \brief cache line size, used to keep worker private data apart */
+#define  CACHE_LINE_SIZE          64
+
+/** \brief size of each buffer of the streaming ring */
+#define  STREAM_BUFFER_SIZE       (1 << 20)
+
+/** \brief bytes of a compressed file read ahead by its decoder */
+#define  DECODER_INPUT_SIZE       (256 << 10)
+
+/** \brief largest BGZF block, compressed or not */
+#define  BGZF_BLOCK_SIZE          (64 << 10)
+
+/** \brief reads kept in flight by the io_uring reader */
+#define  IO_RING_DEPTH            64
+
+/** \brief bytes before the resume offset hashed to check that a file was only appended to */
+#define  TAIL_HASH_BYTES          4096
+
+/** \brief chunk size of the server jobs, when not given */
+#define  SERVER_CHUNK_SIZE        (256 << 10)
+
+/** \brief largest job request, the file paths sent by a client */
+#define  MAX_JOB_REQUEST          (1 << 20)
+
+/** \brief seconds a client has to send its job request */
+#define  JOB_REQUEST_TIMEOUT      5
+
+/** \brief seconds a client has to take its job results */
+#define  JOB_REPLY_TIMEOUT        5
+
+/** \brief shards of each word table, merged in parallel */
+#define  WORD_SHARDS              64
+
+/** \brief size of the blocks of the word arenas */
+#define  ARENA_BLOCK_SIZE         (1 << 20)
+
+/** \brief whole small files handed out to a worker at once */
+#define  PACKED_FILES             32
+
+/** \brief room left in each task deque for the halves of the split tasks */
+#define  SPLIT_TASKS              64
+
+/** \brief log2 buckets of the latency histograms, from 1 ns up */
+#define  HISTOGRAM_BINS           40
+
+/** \brief word lengths told apart by the word length metric, the longer words share the last one */
+#define  WORD_LENGTHS             20
+
+/** \brief accented letters counted by the accent metric, in code point order (à á â ã ç é ê í ó ô õ ú) */
+#define  ACCENTS                  12
+
+/* Input formats */
+
+/** \brief uncompressed text */
+#define FORMAT_PLAIN 0
+
+/** \brief gzip stream, possibly of several members */
+#define FORMAT_GZIP 1
+
+/** \brief BGZF, gzip members that carry their compressed size */
+#define FORMAT_BGZF 2
+
+/** \brief zstd frames */
+#define FORMAT_ZSTD 3
+
+/* Instrumented phases */
+
+/** \brief time spent in requestChunk */
+#define PHASE_REQUEST 0
+
+/** \brief time waiting for a lock */
+#define PHASE_LOCK_WAIT 1
+
+/** \brief time holding a lock, without the condition waits */
+#define PHASE_LOCK_HOLD 2
+
+/** \brief time waiting for the reader to fill a buffer */
+#define PHASE_STARVED 3
+
+/** \brief time reading a chunk inside the monitor */
+#define PHASE_READ 4
+
+/** \brief time spent in processChunk */
+#define PHASE_DECODE 5
+
+/** \brief time spent in postResults */
+#define PHASE_POST 6
+
+/** \brief number of instrumented phases */
+#define PHASES 7
+
+/* Text metrics */
+
+/** \brief bytes of text, after decompression */
+#define METRIC_BYTES 0x01
+
+/** \brief utf-8 chars, each malformed sequence counting as one */
+#define METRIC_CHARS 0x02
+
+/** \brief newline characters */
+#define METRIC_LINES 0x04
+
+/** \brief words of each length, in chars */
+#define METRIC_LENGTHS 0x08
+
+/** \brief accented letters, the upper case ones counted as lower case */
+#define METRIC_ACCENTS 0x10
+
+/** \brief text metrics structure, counted in the same pass as the words */
+struct TextMetrics {
+	long bytes;
+	long chars;
+	long lines;
+	long lengths[WORD_LENGTHS];						/* words of 1 to WORD_LENGTHS chars, the longer ones in the last */
+	long accents[ACCENTS];
+};
+
+/** \brief file results structure, 64-bit counters so files past 4 GB do not overflow */
 struct FileResult {
-	int nWords;
-	int vowels[6];
+	long nWords;
+	long vowels[6];
+	long invalid;									/* malformed utf-8 sequences */
+	long invalidAt[INVALID_OFFSETS];				/* offsets of the first ones */
+	struct TextMetrics* metrics;					/* NULL if no text metric is counted */
 	char* fileName;
 };
 
+/** \brief chunk edges structure, the runs and chars that can only be completed by the neighbour chunks */
+struct ChunkEdges {
+	bool separator;									/* at least one separator in the chunk */
+	bool headOnly;									/* the chunk only has leading continuation bytes */
+	bool headWord;									/* word characters before the first separator */
+	bool tailWord;									/* word characters after the last separator */
+	unsigned char headVowels;						/* vowels before the first separator */
+	unsigned char tailVowels;						/* vowels after the last separator */
+	unsigned char headLen;							/* leading utf-8 continuation bytes */
+	unsigned char tailLen;							/* bytes of the uncomplete utf-8 char at the end */
+	unsigned char headBytes[MAX_CHAR_BYTES - 1];
+	unsigned char tailBytes[MAX_CHAR_BYTES - 1];
+	long size;										/* bytes of the chunk, or of the chunks joined */
+	long headChars;									/* chars before the first separator (text metrics) */
+	long tailChars;									/* chars after the last separator (text metrics) */
+	long invalid;									/* malformed utf-8 sequences, but the ones cut by the edges */
+	long invalidAt[INVALID_OFFSETS];				/* offsets of the first ones, from the start of the chunk */
+};
+
+/** \brief chunk results structure */
+struct ChunkSummary {
+	long nWords;									/* words between the first and the last separators */
+	long vowels[6];
+	struct ChunkEdges edges;
+	struct TextMetrics metrics;						/* the chars and words cut by the edges are left out */
+};
+
+/** \brief word fragments structure, the raw bytes of the runs cut by the chunk edges */
+struct WordFragments {
+	bool separator;									/* at least one separator in the chunk */
+	unsigned char* head;							/* bytes before the first separator, the whole chunk without one */
+	unsigned char* tail;							/* bytes after the last separator */
+	int headLen;
+	int tailLen;
+};
+
+/** \brief word run structure, the bytes of the run still open at the end of the joined chunks of a file */
+struct WordRun {
+	unsigned char* bytes;
+	int len;
+	int capacity;
+};
+
+/** \brief word table entry structure, a folded word and its count */
+struct WordEntry {
+	unsigned long long hash;
+	unsigned char* word;							/* NULL for an empty slot */
+	int len;
+	long count;
+};
+
+/** \brief word table shard structure, an open addressing table */
+struct WordShard {
+	struct WordEntry* entries;
+	int capacity;									/* a power of two */
+	int used;
+};
+
+/** \brief word arena structure, the folded words are written in blocks that are never freed */
+struct WordArena {
+	unsigned char* top;
+	unsigned char* end;
+};
+
+/** \brief word table structure, each thread inserts into its own */
+struct WordTable {
+	struct WordShard shards[WORD_SHARDS];
+	struct WordArena arena;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/** \brief chunk data structure */
+struct ChunkData {
+	int fileId;
+	int chunkId;
+	int chunkSize;
+	int bufferId;									/* read buffer holding the chunk (io_uring reader) */
+	long offset;									/* file offset the chunk is read from (stdio path) */
+	unsigned char* buffer;
+};
+
+/** \brief file pack structure, whole small files handed out to a worker in a single monitor entry */
+struct FilePack {
+	struct ChunkData chunks[PACKED_FILES];
+	int count;
+	int next;										/* next chunk taken without entering the monitor */
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/** \brief task structure, a range of chunks of a file */
+struct Task {
+	int fileId;
+	int firstChunk;
+	int lastChunk;									/* one past the last chunk of the range */
+};
+
+/** \brief worker task deque structure, the owner works at the bottom and the thieves steal from the top */
+struct TaskDeque {
+	pthread_mutex_t access;
+	struct Task* tasks;
+	int capacity;
+	int top;
+	int count;										/* written atomically, the thieves peek at it without the lock */
+	long lockAcquisitions;
+	long steals;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/** \brief stream buffer structure, a slot of the ring filled by the reader */
+struct StreamBuffer {
+	int fileId;
+	int size;
+	bool done;										/* processed, its edges are waiting to be joined */
+	bool compressed;								/* whole BGZF blocks, inflated by the worker that takes it */
+	unsigned char* data;
+	struct ChunkEdges edges;
+	struct WordFragments fragments;
+};
+
+/** \brief decoder structure, a file read by the reader and the state of its decompression */
+struct Decoder {
+	int fd;
+	int format;
+	unsigned char* input;							/* bytes read ahead, not decoded yet */
+	int inputPos;									/* first byte not consumed */
+	int inputSize;
+	bool inputEnd;									/* the end of the file was reached */
+	bool frameOpen;									/* a zstd frame is not complete yet */
+	bool outputEnd;									/* the last byte was decoded */
+	long inputBytes;								/* bytes read from the file */
+	long outputBytes;								/* bytes decoded, or held by the blocks read */
+	void* stream;									/* z_stream or ZSTD_DStream, NULL for plain text and BGZF */
+};
+
+/** \brief read buffer structure, a buffer filled by the io_uring reader */
+struct ReadBuffer {
+	int fileId;
+	int chunkId;
+	int size;
+	int read;										/* bytes read so far, reads can come short */
+	long offset;
+	unsigned char* data;
+};
+
+/** \brief result cache entry structure, the results of a file and the identity they were counted for */
+struct CacheEntry {
+	unsigned long long device;
+	unsigned long long inode;
+	long long size;
+	long long mtimeSec;
+	long long mtimeNsec;
+	unsigned long long hash;						/* content hash, 0 if not computed */
+	int racy;										/* modified just before it was counted, checked by hash */
+	long nWords;
+	long vowels[6];
+	long invalid;
+	long invalidAt[INVALID_OFFSETS];
+	unsigned long long tailHash;					/* hash of the last bytes, checked before resuming */
+	struct ChunkSummary carry;						/* summary of the whole file, its edges still open */
+};
+
+/** \brief worker phase statistics structure, in nanoseconds */
+struct PhaseStats {
+	long samples[PHASES];
+	double time[PHASES];
+	long histogram[PHASES][HISTOGRAM_BINS];
+	long chunks;
+	long bytes;
+	unsigned long long heldSince;					/* instant the held lock was acquired */
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/** \brief server job structure, the files sent by a client and their results */
+struct ServerJob {
+	int client;										/* socket the results are written to */
+	char* request;									/* paths sent by the client, the file names point into it */
+	int requestLen;									/* request bytes received so far */
+	int totalFiles;
+	char** fileNames;
+	int* fds;										/* -1 for a file that could not be opened */
+	long* fileSizes;
+	bool* failed;									/* open or read error */
+	struct FileResult* results;
+	int* firstChunk;								/* first chunk of each file, and the total chunks at the end */
+	struct ChunkEdges* chunkEdges;
+	int nextChunk;									/* next chunk handed out */
+	int chunkFile;									/* file of the next chunk */
+	int pendingChunks;								/* chunks not posted yet */
+	struct timespec start;							/* instant the client was accepted */
+	struct ServerJob* next;							/* ring of the jobs with chunks left */
+	struct ServerJob* prev;
+};
+
+/** \brief server chunk structure, a chunk of a job handed out to a worker */
+struct ServerChunk {
+	struct ServerJob* job;
+	int fileId;
+	int chunkId;
+	long offset;
+	int chunkSize;
+};
+
+/** \brief cpu topology structure, where a cpu is in the machine */
+struct CpuTopology {
+	int cpu;
+	int package;
+	int core;
+	int node;
+	int smt;										/* index among the SMT siblings of its core */
+	int coreRank;									/* rank of its core within the package */
+};
+
+/** \brief worker placement structure, the cpu of a worker and its throughput */
+struct WorkerPlacement {
+	int cpu;										/* pinned cpu, or the one the worker started on */
+	int lastCpu;
+	int node;
+	long units;
+	double wallTime;
+	double cpuTime;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+/** \brief command line options structure */
+struct Options {
+	int nThreads;
+	int chunkSize;									/* 0 to choose it at run time */
+	bool mapFiles;
+	bool atomicChunks;
+	bool workStealing;
+	bool streamInput;
+	bool ioUring;
+	bool instrument;
+	char* cacheFile;								/* NULL for no result cache */
+	bool verifyHash;
+	bool appendOnly;								/* resume grown files from the cached offset (with -C) */
+	bool checkUtf8;									/* report the malformed utf-8 sequences of each file */
+	int topWords;									/* most frequent words printed, 0 not to count them */
+	char* serverSocket;								/* serve jobs on this socket, NULL to count the given files */
+	char* jobSocket;								/* send the files as a job to the server on this socket */
+	char* placement;								/* worker placement policy, NULL to leave the workers unpinned */
+	bool keepOrder;									/* hand out the files in command line order, not largest first */
+	unsigned int metrics;							/* text metrics counted (METRIC flags), 0 for none */
+};
+
 /** \brief shared region structure */
 struct SharedMemory {
 	struct FileResult* fileResults;
 	char** fileNames;
 	int fileId;
 	int totalFiles;
-	int chunkSize;
-	bool openFile;
-	FILE* currentFile;
+	int* fileOrder;									/* files in the order they are handed out, largest first */
+	int orderPos;									/* position of the current file in that order */
+	bool largestFirst;
+	struct FilePack* packs;							/* small files packed for each worker (stdio and mmap paths) */
+	long long firstIdle;							/* instant the first worker found no work left, in ns */
+	long long lastIdle;								/* instant the last one did */
+	int chunkSize;									/* chunk unit, every chunk but the last of a file is a multiple of it */
+	bool guidedChunks;
+	long remainingBytes;
+	int* fileFds;									/* descriptor of each file being read (stdio path), -1 if closed */
+	int* pendingReads;								/* chunks of each file claimed and not yet read */
+	bool mapFiles;
+	unsigned char** fileMaps;
+	long* fileSizes;
+	long filePos;
+	bool atomicChunks;
+	struct ChunkData* chunks;
+	int totalChunks;
+	int splitChunks;
+	int nextChunk;
+	struct FileResult** workerResults;
+	bool workStealing;
+	int totalWorkers;
+	struct TaskDeque* deques;
+	long queuedChunks;								/* chunks in the task deques or being split, not taken yet */
+	bool streamInput;
+	struct StreamBuffer* streamBuffers;
+	int totalBuffers;
+	long fillPos;
+	long takePos;
+	long joinPos;
+	bool streamEnd;
+	struct ChunkSummary* fileSummaries;
+	bool ioUring;
+	struct ReadBuffer* readBuffers;
+	int* freeBuffers;
+	int totalFree;
+	int* filledBuffers;
+	int filledHead;
+	int totalFilled;
+	long ioReads;
+	long ioBytes;
+	double ioTime;
+	int* firstChunk;
+	struct ChunkEdges* chunkEdges;
+	int* chunkUnits;
+	long lockAcquisitions;
+	bool cacheResults;
+	bool verifyHash;
+	struct stat* fileStats;
+	unsigned long long* fileHashes;
+	bool* cachedFiles;
+	int* duplicateOf;								/* first file with the same identity or content, -1 if none */
+	int cacheHits;
+	int duplicates;
+	bool appendOnly;
+	long* fileStarts;								/* offset the counting of each file resumes at */
+	int resumedFiles;
+	long resumedBytes;
+	bool wordFrequency;
+	struct WordFragments* chunkFragments;
+	struct WordRun* fileRuns;
+	bool* decodeFailed;								/* a block of the file could not be inflated */
+	int compressedFiles;
+	long compressedBytes;
+	long decodedBytes;
+	bool checkUtf8;
+	bool instrument;								/* print the monitor, scheduling and read diagnostics (-t) */
+	unsigned int metrics;
+	struct TextMetrics** workerMetrics;
+	struct TextMetrics* fileMetrics;
 };
 
 #endif /* CONSTS_H_ */
@@ -13,10 +13,49 @@
  */
  
 //	compile command
-// 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c -lpthread -lm
+// 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c textKernel.c ioRing.c instrument.c resultCache.c wordFreq.c server.c placement.c decompress.c textMetrics.c -lpthread -lm -lz
+// 		(add -mavx2 to classify 32 bytes at a time instead of the SSE2 16, and -DHAVE_ZSTD -lzstd to read zstd files)
 
 //	run command
 // 		./countWords 4 text0.txt text1.txt text2.txt text3.txt text4.txt
+// 		./countWords text0.txt text1.txt text2.txt text3.txt text4.txt		(one thread per online cpu)
+// 		cat text*.txt | ./countWords -p 4 -
+// 		./countWords 4 text0.txt.gz text1.txt.zst
+// 		./countWords -M lines,lengths,accents 4 text0.txt text1.txt
+// 		./countWords -S /tmp/countWords.sock 4 &  ./countWords -J /tmp/countWords.sock text0.txt text1.txt
+
+//	options
+// 		-m	memory map the files and hand out chunks without copying them
+// 		-a	pre-split the mapped files and let the workers claim chunks with an atomic index (implies -m)
+// 		-p	stream the files (or stdin, given as -) through a ring of buffers filled by a reader thread,
+// 			so pipes and FIFOs can be read
+// 		-u	read the files through io_uring, keeping many reads in flight (falls back to stdio)
+// 		-o	hand out the files in command line order, not largest first with the small files packed together
+// 			(the results are printed in command line order either way)
+// 		-c bytes	fixed chunk size, otherwise it is chosen at run time and chunks shrink toward the end
+// 		-s	give each worker a deque of chunk ranges and let idle workers steal from the others (implies -m)
+// 		-C file	keep the file results in a cache file, unchanged files are not read again on the next runs, and
+// 			files given twice or with the same content (same size and content hash, then same bytes) are counted once
+// 		-A	the files are only appended to, count the bytes appended since the cached run (with -C)
+// 		-V	check the cached results by a content hash (with -C)
+// 		-w N	also count every word (lower cased, accents folded) and print the N most frequent ones and the
+// 			number of distinct words (the result cache is not used)
+// 		-S socket	serve jobs on a Unix domain socket with a pool of workers kept alive, until SIGINT or SIGTERM
+// 			(only the thread number, if any, is given, -c sets the chunk size of the jobs)
+// 		-J socket	send the files as a job to the server on the socket and print its results (no thread number)
+// 		-P policy	pin the workers to cores (compact or scatter, physical cores before SMT siblings) with their
+// 			buffers on the local NUMA node, or none, and print the throughput of each worker
+// 		-t	time the worker phases (lock wait and hold, reads, decoding) and print them with histograms, along with
+// 			the monitor lock acquisitions, the scheduling tail, the chunk unit, the read throughput, the result
+// 			cache hits and duplicates (with -C), the resumed files (with -A) and the compressed files
+// 		-U	print the number of malformed utf-8 sequences of each file and the offsets of the first ones; each
+// 			one is counted as a single char that is neither a word character nor a separator (as U+FFFD)
+// 		-M metrics	also print text metrics of each file, counted in the same pass as the words: a comma separated
+// 			list of bytes, chars, lines, lengths (words of each length in chars) and accents (accented letters),
+// 			or all (the result cache is not used, and neither is the ascii fast path for chars, lengths or accents)
+//
+//	gzip and zstd files are always streamed, decompressed by the reader while the workers count, and BGZF
+//	files (bgzip) are inflated block by block by the workers themselves
  
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +69,13 @@
 
 #include "consts.h"
 #include "sharedMemory.h"
+#include "textKernel.h"
+#include "instrument.h"
+#include "wordFreq.h"
+#include "server.h"
+#include "placement.h"
+#include "decompress.h"
+#include "textMetrics.h"
 
 //#define nThreads 4
 
@@ -39,29 +85,35 @@ int *statusWorkers;
 /** \brief main thread return status */
 int statusMain;
 
-/** \brief worker life cycle routine */
-static void *worker(void *id);
+/** \brief reader thread return status */
+int statusReader;
 
-/** \brief execution time measurement */
-static double get_delta_time(void);
+/** \brief the workers count every word in their word tables */
+static bool wordFrequency = false;
 
-/** \brief process chunk of text */
-static struct FileResult processChunk(unsigned char* buffer, int chunkSize);
+/** \brief text metrics counted by the workers, 0 for none */
+static unsigned int textMetrics = 0;
+
+/** \brief number of mergers of the word tables */
+static int totalMergers = 0;
+
+/** \brief worker life cycle routine */
+static void *worker(void *id);
 
-/** \brief set all elements of a given array to 0 */
-static void setToZero(int array[6]);
+/** \brief merger life cycle routine */
+static void *merger(void *id);
 
-/** \brief extract a char from a given buffer */
-static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsigned char UTF8Char[5]);
+/** \brief server worker life cycle routine */
+static void *serverWorker(void *id);
 
-/** \brief verify if a given char is a vowel */
-static int isVowel(int c);
+/** \brief reader life cycle routine */
+static void *reader(void *id);
 
-/** \brief process a character */
-static void processAChar(int c, int* inWord, int* nWords, int nWordswVowel[6], int firstOccur[6]);
+/** \brief execution time measurement */
+static double get_delta_time(void);
 
-/** \brief offset of a vowel */
-static int vowelOffset(int c);
+/** \brief thread number given in the command line */
+static int threadNumber(const char* arg);
 
 /**
  *  \brief Main thread.
@@ -77,15 +129,139 @@ static int vowelOffset(int c);
 
 int main(int argc, char *argv[])
 {	
+	struct Options options = { .nThreads = 0, .chunkSize = 0, .mapFiles = false, .atomicChunks = false, .workStealing = false, .streamInput = false, .ioUring = false, .instrument = false, .cacheFile = NULL, .verifyHash = false, .appendOnly = false, .topWords = 0, .serverSocket = NULL, .jobSocket = NULL, .placement = NULL, .keepOrder = false, .checkUtf8 = false, .metrics = 0 };
+	int opt;
+	
+	// parse command line options
+	while ((opt = getopt(argc, argv, "maspuoc:tC:VAw:S:J:P:UM:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'm':
+				options.mapFiles = true;
+				break;
+			case 'a':
+				options.mapFiles = true;
+				options.atomicChunks = true;
+				break;
+			case 'p':
+				options.streamInput = true;
+				break;
+			case 'o':
+				options.keepOrder = true;
+				break;
+			case 'c':
+				options.chunkSize = atoi(optarg);
+				if (options.chunkSize < 1 || options.chunkSize > MAX_CHUNK_SIZE)
+				{
+					fprintf(stderr, "invalid chunk size \"%s\" (1 to %d bytes)\n", optarg, MAX_CHUNK_SIZE);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'u':
+				options.ioUring = true;
+				break;
+			case 's':
+				options.mapFiles = true;
+				options.workStealing = true;
+				break;
+			case 't':
+				options.instrument = true;
+				break;
+			case 'C':
+				options.cacheFile = optarg;
+				break;
+			case 'V':
+				options.verifyHash = true;
+				break;
+			case 'A':
+				options.appendOnly = true;
+				break;
+			case 'w':
+				options.topWords = atoi(optarg);
+				if (options.topWords < 1)
+				{
+					fprintf(stderr, "invalid number of words \"%s\"\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'S':
+				options.serverSocket = optarg;
+				break;
+			case 'J':
+				options.jobSocket = optarg;
+				break;
+			case 'P':
+				options.placement = optarg;
+				break;
+			case 'U':
+				options.checkUtf8 = true;
+				break;
+			case 'M':
+				options.metrics = parseMetrics(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-m] [-a] [-s] [-p] [-u] [-o] [-t] [-C cache_file [-V] [-A]] [-w words] [-P placement] [-U] [-M metrics] [-c bytes] [threads] file...\n", argv[0]);
+				fprintf(stderr, "       %s -S socket [-P placement] [-U] [-c bytes] [threads]\n", argv[0]);
+				fprintf(stderr, "       %s -J socket file...\n", argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+	
+	// client mode, the job is counted by the server
+	if (options.jobSocket != NULL)
+	{
+		if (argc - optind < 1)
+		{
+			fprintf(stderr, "no file name provided\n");
+			exit(EXIT_FAILURE);
+		}
+		exit(submitJob(options.jobSocket, &argv[optind]) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	
+	// the thread number is optional, one thread per online cpu otherwise
+	int nThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	int firstFile = optind;
+	int given = (optind < argc && (options.serverSocket != NULL || argc - optind > 1)) ? threadNumber(argv[optind]) : -1;
+	
+	if (given == 0)
+	{
+		fprintf(stderr, "invalid number of threads \"%s\" (1 to %d)\n", argv[optind], MAX_THREADS);
+		exit(EXIT_FAILURE);
+	}
+	if (given > 0)
+	{
+		nThreads = given;
+		firstFile++;
+	}
+	if (nThreads > MAX_THREADS)
+		nThreads = MAX_THREADS;
+	options.nThreads = nThreads = (nThreads < 1) ? 1 : nThreads;
+	
 	// not enough arguments provided
-	if (argc < 3)
+	if (options.serverSocket == NULL && firstFile == argc)
 	{
-		fprintf(stderr, "no thread number or file name provided\n");
+		fprintf(stderr, "no file name provided\n");
 		exit(EXIT_FAILURE);
 	}
 	
-	// get number of threads
-	int nThreads = argv[1][0] - '0';
+	// compressed files can only be decoded from their start, by the reader
+	for (int i = firstFile; !options.streamInput && options.serverSocket == NULL && i < argc; i++)
+	{
+		if (compressedFile(argv[i]))
+		{
+			fprintf(stderr, "compressed input, the files are streamed\n");
+			options.streamInput = true;
+		}
+	}
+	
+	// streamed files are neither mapped nor split in advance, nor read at offsets
+	if (options.streamInput)
+		options.mapFiles = options.atomicChunks = options.workStealing = options.ioUring = false;
+	
+	// files read through io_uring are not mapped
+	if (options.ioUring)
+		options.mapFiles = options.atomicChunks = options.workStealing = false;
 	
 	if ((statusWorkers = malloc (nThreads * sizeof (int))) == NULL)
 	{
@@ -93,6 +269,7 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 	
+	pthread_t tIdReader;			/* reader internal thread id */
 	pthread_t *tIdWorkers;			/* workers internal thread id array */
 	unsigned int *workers;			/* workers application defined thread id array */
 	int *pStatus;					/* pointer to execution status */
@@ -110,13 +287,71 @@ int main(int argc, char *argv[])
 	
 	(void) get_delta_time();
 	
+	/* fill the text kernel decoder tables */
+	initDecoder();
+	
+	/* choose the cpu of each worker */
+	if (options.placement != NULL)
+		initPlacement(options.placement, nThreads);
+	
+	/* server mode, the workers are kept alive and count the chunks of every job sent */
+	if (options.serverSocket != NULL)
+	{
+		if (options.metrics != 0)
+			fprintf(stderr, "text metrics are not counted by the server\n");
+		initServer(options.serverSocket, options.chunkSize, options.checkUtf8);
+		
+		for (int i = 0; i < nThreads; i++)
+		{
+			if (pthread_create(&tIdWorkers[i], workerAttributes(i), serverWorker, &workers[i]) != 0)	/* thread server worker */
+			{
+				perror ("error on creating thread worker");
+				exit (EXIT_FAILURE);
+			}
+		}
+		
+		long jobs = acceptJobs();
+		
+		for (int i = 0; i < nThreads; i++)
+		{
+			if (pthread_join(tIdWorkers[i], (void *) &pStatus) != 0)				/* thread server worker */
+			{
+				perror("error on waiting for thread worker");
+				exit (EXIT_FAILURE);
+			}
+		}
+		
+		printf("Jobs served = %ld in %.6f s\n", jobs, get_delta_time());
+		printPlacement("MB");
+		exit(EXIT_SUCCESS);
+	}
+	
+	/* turn the phase probes on */
+	if (options.instrument)
+		initInstrument(nThreads);
+	
+	/* one word table per worker, and one for main */
+	if (options.topWords > 0)
+	{
+		initWordTables(nThreads);
+		wordFrequency = true;
+		totalMergers = nThreads;
+	}
+	
+	textMetrics = options.metrics;
+	
 	/* fill shared memory with files names */
-	fillSharedMem(argv);
+	fillSharedMem(&argv[firstFile], &options);
 
 	/* generation of intervening entity threads */
+	if ((options.streamInput || options.ioUring) && pthread_create(&tIdReader, NULL, reader, NULL) != 0)	/* thread reader */
+	{
+		perror ("error on creating thread reader");
+		exit (EXIT_FAILURE);
+	}
 	for (int i = 0; i < nThreads; i++)
 	{
-		if (pthread_create(&tIdWorkers[i], NULL, worker, &workers[i]) != 0)		/* thread worker */
+		if (pthread_create(&tIdWorkers[i], workerAttributes(i), worker, &workers[i]) != 0)		/* thread worker */
 		{
 			perror ("error on creating thread worker");
 			exit (EXIT_FAILURE);
@@ -133,10 +368,60 @@ int main(int argc, char *argv[])
 		}
 		printf("thread workers, with id %u, has terminated: ", i);
 		printf("its status was %d\n", *pStatus);
+		
+		/* merge its private results */
+		mergeResults(i);
 	}
 	
+	if (options.streamInput || options.ioUring)
+	{
+		if (pthread_join(tIdReader, (void *) &pStatus) != 0)					/* thread reader */
+		{
+			perror("error on waiting for thread reader");
+			exit (EXIT_FAILURE);
+		}
+		printf("thread reader has terminated: ");
+		printf("its status was %d\n", *pStatus);
+		
+		if (*pStatus != EXIT_SUCCESS)
+			exit(EXIT_FAILURE);
+	}
+	
+	/* count the words cut by the chunk edges */
+	joinChunks();
+	
+	/* merge the word tables, each merger owning a share of the shards */
+	if (options.topWords > 0)
+	{
+		for (int i = 0; i < nThreads; i++)
+		{
+			if (pthread_create(&tIdWorkers[i], workerAttributes(i), merger, &workers[i]) != 0)		/* thread merger */
+			{
+				perror ("error on creating thread merger");
+				exit (EXIT_FAILURE);
+			}
+		}
+		for (int i = 0; i < nThreads; i++)
+		{
+			if (pthread_join(tIdWorkers[i], (void *) &pStatus) != 0)				/* thread merger */
+			{
+				perror("error on waiting for thread merger");
+				exit (EXIT_FAILURE);
+			}
+			if (*pStatus != EXIT_SUCCESS)
+				exit(EXIT_FAILURE);
+		}
+	}
+	
+	/* copy the results of the duplicate files and keep the new results */
+	cacheResults();
+	
 	/* print obtained results */
 	printResults();
+	if (options.topWords > 0)
+		printWords(options.topWords);
+	printInstrument();
+	printPlacement("MB");
 	
 	printf ("\nElapsed time = %.6f s\n", get_delta_time());
 
@@ -155,339 +440,143 @@ static void *worker(void *par)
 {
 	unsigned int id = *((unsigned int *) par);									/* worker id */
 	
-	unsigned char buffer[MAX_CHUNK_SIZE] = "";
-	int fileId = 0;
-	int chunkSize = 0;
-	struct FileResult fileResult;
+	unsigned char* buffer;
+	struct ChunkData chunkData;
+	struct ChunkSummary chunkSummary;
+	struct WordFragments fragments;
 
-	while (requestChunk(id, buffer, &fileId, &chunkSize))
+	beginWork(id);
+	
+	/* only touched by the stdio path and the BGZF blocks, the pages of the largest chunk are only used when written */
+	if ((buffer = allocLocal(id, MAX_CHUNK_SIZE)) == NULL)
 	{
-		fileResult = processChunk(buffer, chunkSize);
-		postResults(id, fileResult, &fileId);
+		fprintf(stderr, "error on allocating space to the worker buffer\n");
+		statusWorkers[id] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[id]);
 	}
 
-	statusWorkers[id] = EXIT_SUCCESS;
-	pthread_exit(&statusWorkers[id]);
-}
-
-/**
- *  \brief Get the process time that has elapsed since last call of this time.
- *
- *  \return process elapsed time
- */
-
-static double get_delta_time(void)
-{
-	static struct timespec t0, t1;
-
-	t0 = t1;
-	if(clock_gettime (CLOCK_MONOTONIC, &t1) != 0)
+	unsigned long long t = probeTime();
+	
+	while (requestChunk(id, buffer, &chunkData))
 	{
-		perror ("clock_gettime");
-		exit(1);
+		t = recordPhase(id, PHASE_REQUEST, t);
+		if (wordFrequency)
+			chunkSummary = processChunkWords(chunkData.buffer, chunkData.chunkSize, id, &fragments, textMetrics);
+		else if (textMetrics)
+			chunkSummary = processChunkMetrics(chunkData.buffer, chunkData.chunkSize, textMetrics);
+		else
+			chunkSummary = processChunk(chunkData.buffer, chunkData.chunkSize);
+		t = recordPhase(id, PHASE_DECODE, t);
+		recordChunk(id, chunkData.chunkSize);
+		recordWork(id, chunkData.chunkSize);
+		postResults(id, chunkSummary, wordFrequency ? &fragments : NULL, &chunkData);
+		t = recordPhase(id, PHASE_POST, t);
 	}
-	return (double) (t1.tv_sec - t0.tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0.tv_nsec);
+	(void) recordPhase(id, PHASE_REQUEST, t);
+
+	freeLocal(buffer, MAX_CHUNK_SIZE);
+	endWork(id);
+
+	statusWorkers[id] = EXIT_SUCCESS;
+	pthread_exit(&statusWorkers[id]);
 }
 
 /**
- *  \brief Process a text chunk.
+ *  \brief Function merger.
  *
- *	\param buffer buffer to be parsed
- *	\param chunkSize valid size of the buffer
+ *  Its role is to merge its share of the word table shards, once the workers are done.
  *
- *  \return file result
+ *  \param par pointer to application defined merger identification
  */
 
-static struct FileResult processChunk(unsigned char* buffer, int chunkSize)
+static void *merger(void *par)
 {
-	struct FileResult fileResult;
-	fileResult.nWords = 0;
-	setToZero(fileResult.vowels);
+	unsigned int id = *((unsigned int *) par);									/* merger id */
 	
-    int inWord = 0;
-    int firstOccur[6];
-    unsigned char UTF8Char[5];
-	int cutf8;
-	int curPos = 0;
-	
-	while ((cutf8 = extractAChar(buffer, &curPos, &chunkSize, UTF8Char)) != EOF)
-	{
-		processAChar(cutf8, &inWord, &fileResult.nWords, fileResult.vowels, firstOccur);
-	}
+	mergeWords(id, totalMergers);
 	
-	return fileResult;
-}
-
-/**
- *  \brief Set all elements of a given array to 0.
- *
- *	\param array buffer to be initialized
- */
-
-static void setToZero(int array[6])
-{
-    for (int i = 0; i < 6; i++)
-        array[i] = 0;
+	statusWorkers[id] = EXIT_SUCCESS;
+	pthread_exit(&statusWorkers[id]);
 }
 
 /**
- *  \brief Extract an utf-8 char from a given buffer.
+ *  \brief Function server worker.
  *
- *	\param buffer to get the char
- *	\param curPos current buffer position
- *	\param chunkSize maximum buffer size
- *	\param UTF8Char buffer to store the char
+ *  Its role is to count the chunks of the server jobs, until the server closes.
  *
- *	\return extracted char
+ *  \param par pointer to application defined worker identification
  */
 
-static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsigned char UTF8Char[5])
+static void *serverWorker(void *par)
 {
-	// buffer ended
-	if (*curPos >= *chunkSize)
-		return EOF;
-	
-    int cutf8;
-	
-	UTF8Char[0] = buffer[*curPos];
-	(*curPos)++;
-
-    // ASCII char
-    if ((UTF8Char[0] & 0x80) == 0)
-    {
-        // 0x80 -> 128 decimal value, which is [ 1 0 0 0 0 0 0 0 ] binary value
-        // by checking if the first bit is 0, we know that it only occupies 1 byte
-        UTF8Char[0] = toupper(UTF8Char[0]);
-        UTF8Char[1] = '\0';
-
-        return UTF8Char[0];
-    }
-    // not the first byte of the UTF-8 char (the second most significant bit must be 1 as well)
-    else if ((UTF8Char[0] & 0xC0) == 0x80)   // 0xC0 -> [ 1 1 0 0 0 0 0 0 ]
-    {
-        return -1;
-    }
-    // invalid UTF-8 stream (to be a valid UTF-8 char, it must have one zero in position 0, 2, 3 or 4 of the msb)
-    else if ((UTF8Char[0] & 0xFE) == 0xFE)   // 0xFE -> [ 1 1 1 1 1 1 1 0 ]
-    {
-        return -1;
-    }
-    // UTF-8 char
-    else
-    {
-        // get how many bytes the utf-8 char occupies
-        int bytes;
-        for (bytes = 1; UTF8Char[0] & (0x80 >> bytes); bytes++);
-
-        // get remaining char bytes
-        cutf8 = UTF8Char[0];
-        for (int i = 1; i < bytes; i++)
-        {
-			UTF8Char[(i * sizeof(char))] = buffer[*curPos];
-			(*curPos)++;
-			
-            cutf8 = (cutf8 << 8) | UTF8Char[i];
-        }
-
-        UTF8Char[bytes] = '\0';
-
-        if (cutf8 == 0xC3A1 || cutf8 == 0xC381)
-        {
-            UTF8Char[0] = 'A';
-            UTF8Char[1] = '\0';
-            return 'A';
-        }
-        else if (cutf8 == 0xC3A0 || cutf8 == 0xC380)
-        {
-            UTF8Char[0] = 'A';
-            UTF8Char[1] = '\0';
-            return 'A';
-        }
-        else if (cutf8 == 0xC3A2 || cutf8 == 0xC382)
-        {
-            UTF8Char[0] = 'A';
-            UTF8Char[1] = '\0';
-            return 'A';
-        }
-        else if (cutf8 == 0xC3A3 || cutf8 == 0xC383)
-        {
-            UTF8Char[0] = 'A';
-            UTF8Char[1] = '\0';
-            return 'A';
-        }
-        else if (cutf8 == 0xC3A9 || cutf8 == 0xC389)
-        {
-            UTF8Char[0] = 'E';
-            UTF8Char[1] = '\0';
-            return 'E';
-        }
-        else if (cutf8 == 0xC3A8 || cutf8 == 0xC388)
-        {
-            UTF8Char[0] = 'E';
-            UTF8Char[1] = '\0';
-            return 'E';
-        }
-        else if (cutf8 == 0xC3AA || cutf8 == 0xC38A)
-        {
-            UTF8Char[0] = 'E';
-            UTF8Char[1] = '\0';
-            return 'E';
-        }
-        else if (cutf8 == 0xC3AD || cutf8 == 0xC38D)
-        {
-            UTF8Char[0] = 'I';
-            UTF8Char[1] = '\0';
-            return 'I';
-        }
-        else if (cutf8 == 0xC3AC || cutf8 == 0xC38C)
-        {
-            UTF8Char[0] = 'I';
-            UTF8Char[1] = '\0';
-            return 'I';
-        }
-        else if (cutf8 == 0xC3B3 || cutf8 == 0xC393)
-        {
-            UTF8Char[0] = 'O';
-            UTF8Char[1] = '\0';
-            return 'O';
-        }
-        else if (cutf8 == 0xC3B2 || cutf8 == 0xC392)
-        {
-            UTF8Char[0] = 'O';
-            UTF8Char[1] = '\0';
-            return 'O';
-        }
-        else if (cutf8 == 0xC3B4 || cutf8 == 0xC394)
-        {
-            UTF8Char[0] = 'O';
-            UTF8Char[1] = '\0';
-            return 'O';
-        }
-        else if (cutf8 == 0xC3B5 || cutf8 == 0xC395)
-        {
-            UTF8Char[0] = 'O';
-            UTF8Char[1] = '\0';
-            return 'O';
-        }
-        else if (cutf8 == 0xC3BA || cutf8 == 0xC39A)
-        {
-            UTF8Char[0] = 'U';
-            UTF8Char[1] = '\0';
-            return 'U';
-        }
-        else if (cutf8 == 0xC3B9 || cutf8 == 0xC399)
-        {
-            UTF8Char[0] = 'U';
-            UTF8Char[1] = '\0';
-            return 'U';
-        }
-        else if (cutf8 == 0xC3A7 || cutf8 == 0xC387)
-        {
-            UTF8Char[0] = 'C';
-            UTF8Char[1] = '\0';
-            return 'C';
-        }
-        else
-            return cutf8;
-    }
+	unsigned int id = *((unsigned int *) par);									/* worker id */
+	
+	beginWork(id);
+	serveChunks(id);
+	endWork(id);
+	
+	statusWorkers[id] = EXIT_SUCCESS;
+	pthread_exit(&statusWorkers[id]);
 }
 
 /**
- *  \brief Check if a given character is a vowel.
+ *  \brief Function reader.
  *
- *	\param c character to be checked
+ *  Its role is to simulate the life cycle of the reader, which fills the stream or read buffers.
  *
- *	\return 1 if is vowel
+ *  \param par pointer to application defined reader identification (unused)
  */
 
-static int isVowel(int c)
+static void *reader(void *par)
 {
-    if (c == 'A' || c == 'E' || c == 'I' || c == 'O' || c == 'U' || c == 'Y')
-        return 1;
+	(void) par;
+	
+	streamFiles();
 
-    return 0;
+	statusReader = EXIT_SUCCESS;
+	pthread_exit(&statusReader);
 }
 
 /**
- *  \brief Process a given character.
+ *  \brief Get the process time that has elapsed since last call of this time.
  *
- *	\param c character to be checked
- *	\param inWord inWord flag
- *	\param nWords total words
- *	\param nWordswVowel number of vowels per word
- *	\param firstOccur first vowel occurence flag
+ *  \return process elapsed time
  */
 
-static void processAChar(int c, int* inWord, int* nWords, int nWordswVowel[6], int firstOccur[6])
+static double get_delta_time(void)
 {
-    // outside a word
-    if (*inWord == 0)
-    {
-        // alpha numeric character or underscore
-        if ((c > 64 && c < 91) || (c > 47 && c < 58) || c == '_')
-        {
-            *inWord = 1;
-            (*nWords)++;
-            setToZero(firstOccur);
-            if (isVowel(c))
-            {
-                nWordswVowel[vowelOffset(c)] += 1;
-                firstOccur[vowelOffset(c)] = 1;
-            }
-        }
-    }
-    // inside a word
-    else 
-    {
-        // space or punctuation symbol or separation symbol
-        if ((c == 0x20 || c == 0x9 || c == 0xA || c == 0xD) || (c == '-' || c == 0x22 || c == 0xE2809C || c == 0xE2809D || c == '[' || c == ']' || c == '(' || c == ')') || (c == '.' || c == ',' || c == ':' || c == ';' || c == '?' || c == '!' || c == 0xE28093 || c == 0xE280A6))
-        {
-            *inWord = 0;
-        }
-        // alpha numeric character or underscore or apostrophe
-        if ((c > 64 && c < 91) || (c > 47 && c < 58) || c == '_' || c == 0x27)
-        {
-            if (isVowel(c) && firstOccur[vowelOffset(c)] == 0)
-            {
-                nWordswVowel[vowelOffset(c)] += 1;
-                firstOccur[vowelOffset(c)] = 1;
-            }
-        }
-    }
+	static struct timespec t0, t1;
+
+	t0 = t1;
+	if(clock_gettime (CLOCK_MONOTONIC, &t1) != 0)
+	{
+		perror ("clock_gettime");
+		exit(1);
+	}
+	return (double) (t1.tv_sec - t0.tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0.tv_nsec);
 }
 
 /**
- *  \brief Get the offset of a vowel.
+ *  \brief Thread number given in the command line.
  *
- *	\param c character to get the offset
+ *  Only an argument made of digits is a thread number, anything else is the first file name.
  *
- *	\return offset
+ *  \param arg first argument after the options
+ *
+ *  \return number of threads, 0 if out of range, -1 if not a number
  */
 
-static int vowelOffset(int c)
+static int threadNumber(const char* arg)
 {
-	int offset = -1;
-	switch(c)
+	long number = 0;
+	
+	for (const char* c = arg; *c != '\0'; c++)
 	{
-		case 'A':
-			offset = A;
-			break;
-		case 'E':
-			offset = E;
-			break;
-		case 'I':
-			offset = I;
-			break;
-		case 'O':
-			offset = O;
-			break;
-		case 'U':
-			offset = U;
-			break;
-		case 'Y':
-			offset = Y;
-			break;
+		if (!isdigit((unsigned char) *c))
+			return -1;
+		if (number <= MAX_THREADS)
+			number = number * 10 + (*c - '0');
 	}
 	
-	return offset;
-}
+	return (*arg == '\0') ? -1 : (number >= 1 && number <= MAX_THREADS) ? (int) number : 0;
+}
\ No newline at end of file
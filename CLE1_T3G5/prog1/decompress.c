@@ -0,0 +1,573 @@
+/**
+ *  \file decompress.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Compressed input.
+ *
+ *  gzip and zstd files read by the reader, either decompressed by it into the stream buffers or, for
+ *  BGZF files, cut into whole blocks that the workers inflate in parallel:
+ *     \li compressedFile
+ *     \li initInflaters
+ *     \li openDecoder
+ *     \li decodeBuffer
+ *     \li readBlocks
+ *     \li inflateBlocks
+ *     \li closeDecoder.
+ *
+ *  A gzip stream can only be inflated from its start, so a single reader decodes it while the workers
+ *  count the buffers already decoded. BGZF members record their compressed size in the header, so
+ *  the reader just frames them and every worker inflates its own blocks. zstd input needs a build
+ *  with -DHAVE_ZSTD -lzstd.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "consts.h"
+#include "decompress.h"
+
+/** \brief gzip header with a BGZF size, 12 fixed bytes and a 6 byte extra field */
+#define BGZF_HEADER_SIZE 18
+
+/** \brief gzip trailer, crc and decoded size */
+#define GZIP_TRAILER_SIZE 8
+
+/** \brief inflate stream of each worker, reset for every block */
+static z_stream* inflaters = NULL;
+
+/** \brief find the format of a file from its first bytes */
+static int fileFormat(unsigned char* head, int size);
+
+/** \brief size of a BGZF block from its header */
+static int blockSize(unsigned char* header, int size);
+
+/** \brief keep at least some bytes read ahead */
+static bool fillInput(struct Decoder* decoder, int wanted);
+
+/** \brief read until a buffer is full or the end of the file */
+static int readFull(int fd, unsigned char* buffer, int size);
+
+/** \brief inflate a gzip stream into a buffer */
+static int inflateStream(struct Decoder* decoder, unsigned char* buffer, int capacity);
+
+#ifdef HAVE_ZSTD
+/** \brief decompress zstd frames into a buffer */
+static int decompressFrames(struct Decoder* decoder, unsigned char* buffer, int capacity);
+#endif
+
+/**
+ *  \brief Tell whether a file is gzip or zstd compressed, from its first bytes.
+ *
+ *  Operation carried out by main, before choosing how the files are read.
+ *
+ *  \param fileName file name, "-" (stdin) is never looked at
+ *
+ *  \return true if the file is compressed
+ */
+
+bool compressedFile(const char* fileName)
+{
+	unsigned char head[BGZF_HEADER_SIZE];
+	int fd;
+	int size;
+
+	if (strcmp(fileName, "-") == 0 || (fd = open(fileName, O_RDONLY)) == -1)
+		return false;
+	size = readFull(fd, head, sizeof(head));
+	close(fd);
+
+	return size > 0 && fileFormat(head, size) != FORMAT_PLAIN;
+}
+
+/**
+ *  \brief Set up the inflate streams of the workers.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param nWorkers number of workers
+ *
+ *  \return false on allocation failure
+ */
+
+bool initInflaters(int nWorkers)
+{
+	if ((inflaters = calloc(nWorkers, sizeof(z_stream))) == NULL)
+		return false;
+
+	/* the gzip wrapper of each block is checked, crc included */
+	for (int i = 0; i < nWorkers; i++)
+		if (inflateInit2(&inflaters[i], 16 + MAX_WBITS) != Z_OK)
+			return false;
+
+	return true;
+}
+
+/**
+ *  \brief Find the format of a file from its first bytes and set up its decoder.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  Pipes are never seeked, the bytes looked at are kept and decoded first.
+ *
+ *  \param decoder decoder to set up
+ *  \param fd file descriptor
+ *
+ *  \return false on a read error or a format that cannot be decoded
+ */
+
+bool openDecoder(struct Decoder* decoder, int fd)
+{
+	memset(decoder, 0, sizeof(struct Decoder));
+	decoder->fd = fd;
+
+	if ((decoder->input = malloc(DECODER_INPUT_SIZE)) == NULL)
+		return false;
+	if (!fillInput(decoder, BGZF_HEADER_SIZE))
+	{
+		free(decoder->input);
+		return false;
+	}
+	decoder->format = fileFormat(decoder->input, decoder->inputSize);
+
+	if (decoder->format == FORMAT_GZIP)
+	{
+		z_stream* stream;
+
+		if ((stream = calloc(1, sizeof(z_stream))) == NULL || inflateInit2(stream, 16 + MAX_WBITS) != Z_OK)
+		{
+			free(stream);
+			free(decoder->input);
+			return false;
+		}
+		decoder->stream = stream;
+	}
+	else if (decoder->format == FORMAT_ZSTD)
+	{
+#ifdef HAVE_ZSTD
+		ZSTD_DStream* stream;
+
+		if ((stream = ZSTD_createDStream()) == NULL || ZSTD_isError(ZSTD_initDStream(stream)))
+		{
+			ZSTD_freeDStream(stream);
+			free(decoder->input);
+			return false;
+		}
+		decoder->stream = stream;
+		decoder->frameOpen = true;
+#else
+		fprintf(stderr, "zstd input needs a build with -DHAVE_ZSTD -lzstd\n");
+		free(decoder->input);
+		return false;
+#endif
+	}
+
+	return true;
+}
+
+/**
+ *  \brief Fill a buffer with the decoded text of a plain, gzip or zstd file.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param decoder decoder of the file
+ *  \param buffer buffer to store the text
+ *  \param capacity buffer size
+ *
+ *  \return number of bytes decoded (less than capacity only at the end of the file), -1 on error
+ */
+
+int decodeBuffer(struct Decoder* decoder, unsigned char* buffer, int capacity)
+{
+	int size;
+
+	if (decoder->format == FORMAT_GZIP)
+		size = inflateStream(decoder, buffer, capacity);
+#ifdef HAVE_ZSTD
+	else if (decoder->format == FORMAT_ZSTD)
+		size = decompressFrames(decoder, buffer, capacity);
+#endif
+	else
+	{
+		/* plain text, the bytes looked at first and then straight from the file */
+		size = decoder->inputSize - decoder->inputPos;
+		if (size > capacity)
+			size = capacity;
+		memcpy(buffer, decoder->input + decoder->inputPos, size);
+		decoder->inputPos += size;
+
+		if (size < capacity && !decoder->inputEnd)
+		{
+			int n = readFull(decoder->fd, buffer + size, capacity - size);
+
+			if (n == -1)
+				return -1;
+			decoder->inputEnd = (n < capacity - size);
+			decoder->inputBytes += n;
+			size += n;
+		}
+	}
+
+	if (size > 0)
+		decoder->outputBytes += size;
+
+	return size;
+}
+
+/**
+ *  \brief Fill a buffer with the next whole blocks of a BGZF file, still compressed.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  Only the block headers and trailers are looked at, the decoded size of each block is in its trailer.
+ *
+ *  \param decoder decoder of the file
+ *  \param buffer buffer to store the blocks
+ *  \param capacity buffer size
+ *  \param decodedCapacity largest decoded size of the blocks taken together
+ *
+ *  \return number of bytes stored (0 at the end of the file), -1 on error
+ */
+
+int readBlocks(struct Decoder* decoder, unsigned char* buffer, int capacity, int decodedCapacity)
+{
+	int size = 0;
+	long decoded = 0;
+
+	while (true)
+	{
+		if (!fillInput(decoder, BGZF_BLOCK_SIZE))
+			return -1;
+
+		int left = decoder->inputSize - decoder->inputPos;
+		unsigned char* block = decoder->input + decoder->inputPos;
+
+		if (left == 0)
+			break;
+
+		/* every member must carry its size and be complete */
+		int bsize = blockSize(block, left);
+
+		if (bsize < BGZF_HEADER_SIZE + GZIP_TRAILER_SIZE || bsize > left)
+			return -1;
+
+		long isize = block[bsize - 4] | (block[bsize - 3] << 8) | (block[bsize - 2] << 16) | ((long) block[bsize - 1] << 24);
+
+		if (isize > BGZF_BLOCK_SIZE)
+			return -1;
+		if (size + bsize > capacity || decoded + isize > decodedCapacity)
+			break;
+
+		memcpy(buffer + size, block, bsize);
+		decoder->inputPos += bsize;
+		size += bsize;
+		decoded += isize;
+	}
+
+	decoder->outputBytes += decoded;
+
+	return size;
+}
+
+/**
+ *  \brief Inflate the blocks stored by readBlocks.
+ *
+ *  Operation carried out by the workers, outside the monitor.
+ *
+ *  \param workerId worker id
+ *  \param blocks compressed blocks
+ *  \param size size of the blocks
+ *  \param buffer buffer to store the text
+ *  \param capacity buffer size
+ *  \param corruptBlocks number of blocks that could not be inflated, their text is left out
+ *
+ *  \return number of bytes decoded
+ */
+
+int inflateBlocks(int workerId, unsigned char* blocks, int size, unsigned char* buffer, int capacity, int* corruptBlocks)
+{
+	z_stream* stream = &inflaters[workerId];
+	int decoded = 0;
+	int bsize;
+
+	*corruptBlocks = 0;
+
+	/* the reader checked that the blocks are whole, a corrupt one only loses its own text */
+	for (int pos = 0; pos < size; pos += bsize)
+	{
+		bsize = blockSize(blocks + pos, size - pos);
+
+		stream->next_in = blocks + pos;
+		stream->avail_in = bsize;
+		stream->next_out = buffer + decoded;
+		stream->avail_out = capacity - decoded;
+		if (inflateReset(stream) == Z_OK && inflate(stream, Z_FINISH) == Z_STREAM_END)
+			decoded = capacity - (int) stream->avail_out;
+		else
+			(*corruptBlocks)++;
+	}
+
+	return decoded;
+}
+
+/**
+ *  \brief Release a decoder, the file descriptor is left open.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param decoder decoder of the file
+ */
+
+void closeDecoder(struct Decoder* decoder)
+{
+	if (decoder->format == FORMAT_GZIP)
+	{
+		inflateEnd(decoder->stream);
+		free(decoder->stream);
+	}
+#ifdef HAVE_ZSTD
+	else if (decoder->format == FORMAT_ZSTD)
+		ZSTD_freeDStream(decoder->stream);
+#endif
+	free(decoder->input);
+	decoder->stream = NULL;
+	decoder->input = NULL;
+}
+
+/**
+ *  \brief Find the format of a file from its first bytes.
+ *
+ *  Auxiliar function.
+ *
+ *  \param head first bytes of the file
+ *  \param size number of bytes
+ *
+ *  \return input format
+ */
+
+static int fileFormat(unsigned char* head, int size)
+{
+	if (size >= 2 && head[0] == 0x1f && head[1] == 0x8b)
+		return (blockSize(head, size) > 0) ? FORMAT_BGZF : FORMAT_GZIP;
+	if (size >= 4 && head[0] == 0x28 && head[1] == 0xb5 && head[2] == 0x2f && head[3] == 0xfd)
+		return FORMAT_ZSTD;
+
+	return FORMAT_PLAIN;
+}
+
+/**
+ *  \brief Size of a BGZF block from its header.
+ *
+ *  Auxiliar function.
+ *
+ *  The size is in the "BC" subfield of the gzip extra field.
+ *
+ *  \param header gzip member header
+ *  \param size number of header bytes available
+ *
+ *  \return block size, 0 if the member is not a BGZF block
+ */
+
+static int blockSize(unsigned char* header, int size)
+{
+	if (size < 12 || header[0] != 0x1f || header[1] != 0x8b || header[2] != 8 || (header[3] & 4) == 0)
+		return 0;
+
+	int extraEnd = 12 + (header[10] | (header[11] << 8));
+
+	if (extraEnd > size)
+		return 0;
+
+	for (int i = 12; i + 4 <= extraEnd; i += 4 + (header[i + 2] | (header[i + 3] << 8)))
+	{
+		if (header[i] == 'B' && header[i + 1] == 'C' && (header[i + 2] | (header[i + 3] << 8)) == 2 && i + 6 <= extraEnd)
+			return (header[i + 4] | (header[i + 5] << 8)) + 1;
+	}
+
+	return 0;
+}
+
+/**
+ *  \brief Keep at least some bytes read ahead.
+ *
+ *  Auxiliar function.
+ *
+ *  The bytes not consumed yet are moved to the start of the input, which is then filled up.
+ *
+ *  \param decoder decoder of the file
+ *  \param wanted bytes wanted, fewer are left only at the end of the file
+ *
+ *  \return false on a read error
+ */
+
+static bool fillInput(struct Decoder* decoder, int wanted)
+{
+	int left = decoder->inputSize - decoder->inputPos;
+
+	if (left >= wanted || decoder->inputEnd)
+		return true;
+
+	memmove(decoder->input, decoder->input + decoder->inputPos, left);
+	decoder->inputPos = 0;
+	decoder->inputSize = left;
+
+	int n = readFull(decoder->fd, decoder->input + left, DECODER_INPUT_SIZE - left);
+
+	if (n == -1)
+		return false;
+	decoder->inputEnd = (n < DECODER_INPUT_SIZE - left);
+	decoder->inputSize += n;
+	decoder->inputBytes += n;
+
+	return true;
+}
+
+/**
+ *  \brief Read until a buffer is full or the end of the file.
+ *
+ *  Auxiliar function.
+ *
+ *  Pipes return short reads, so it keeps reading.
+ *
+ *  \param fd file descriptor
+ *  \param buffer buffer to store the bytes
+ *  \param size buffer size
+ *
+ *  \return number of bytes read (less than size only at the end of the file), -1 on error
+ */
+
+static int readFull(int fd, unsigned char* buffer, int size)
+{
+	int done = 0;
+
+	while (done < size)
+	{
+		ssize_t n = read(fd, buffer + done, size - done);
+
+		if (n == -1 && errno == EINTR)
+			continue;
+		if (n == -1)
+			return -1;
+		if (n == 0)
+			break;
+		done += (int) n;
+	}
+
+	return done;
+}
+
+/**
+ *  \brief Inflate a gzip stream into a buffer.
+ *
+ *  Auxiliar function.
+ *
+ *  Concatenated members are decoded as a single stream, bytes after the last member that do not
+ *  start another one are ignored, like gzip does.
+ *
+ *  \param decoder decoder of the file
+ *  \param buffer buffer to store the text
+ *  \param capacity buffer size
+ *
+ *  \return number of bytes decoded (less than capacity only at the end of the file), -1 on error
+ */
+
+static int inflateStream(struct Decoder* decoder, unsigned char* buffer, int capacity)
+{
+	z_stream* stream = decoder->stream;
+
+	stream->next_out = buffer;
+	stream->avail_out = capacity;
+
+	while (stream->avail_out > 0 && !decoder->outputEnd)
+	{
+		if (decoder->inputPos == decoder->inputSize && !fillInput(decoder, 1))
+			return -1;
+
+		stream->next_in = decoder->input + decoder->inputPos;
+		stream->avail_in = decoder->inputSize - decoder->inputPos;
+
+		int status = inflate(stream, Z_NO_FLUSH);
+
+		decoder->inputPos = decoder->inputSize - stream->avail_in;
+
+		if (status == Z_STREAM_END)
+		{
+			if (!fillInput(decoder, 2))
+				return -1;
+
+			unsigned char* next = decoder->input + decoder->inputPos;
+
+			if (decoder->inputSize - decoder->inputPos >= 2 && next[0] == 0x1f && next[1] == 0x8b)
+				inflateReset(stream);
+			else
+				decoder->outputEnd = true;
+		}
+		/* no progress with the whole file read, it was cut short */
+		else if (status == Z_BUF_ERROR && decoder->inputEnd && decoder->inputPos == decoder->inputSize)
+			return -1;
+		else if (status != Z_OK && status != Z_BUF_ERROR)
+			return -1;
+	}
+
+	return capacity - (int) stream->avail_out;
+}
+
+#ifdef HAVE_ZSTD
+/**
+ *  \brief Decompress zstd frames into a buffer.
+ *
+ *  Auxiliar function.
+ *
+ *  Concatenated frames are decoded as a single stream.
+ *
+ *  \param decoder decoder of the file
+ *  \param buffer buffer to store the text
+ *  \param capacity buffer size
+ *
+ *  \return number of bytes decoded (less than capacity only at the end of the file), -1 on error
+ */
+
+static int decompressFrames(struct Decoder* decoder, unsigned char* buffer, int capacity)
+{
+	ZSTD_outBuffer output = { buffer, capacity, 0 };
+
+	while (output.pos < output.size && !decoder->outputEnd)
+	{
+		if (decoder->inputPos == decoder->inputSize && !fillInput(decoder, 1))
+			return -1;
+
+		/* every frame was completed and flushed */
+		if (decoder->inputPos == decoder->inputSize && !decoder->frameOpen)
+		{
+			decoder->outputEnd = true;
+			break;
+		}
+
+		ZSTD_inBuffer input = { decoder->input + decoder->inputPos, decoder->inputSize - decoder->inputPos, 0 };
+		size_t decoded = output.pos;
+		size_t hint = ZSTD_decompressStream(decoder->stream, &output, &input);
+
+		if (ZSTD_isError(hint))
+			return -1;
+		decoder->inputPos += (int) input.pos;
+		decoder->frameOpen = (hint != 0);
+
+		/* no progress with the whole file read, it was cut short */
+		if (input.pos == 0 && output.pos == decoded && decoder->inputPos == decoder->inputSize)
+			return -1;
+	}
+
+	return (int) output.pos;
+}
+#endif
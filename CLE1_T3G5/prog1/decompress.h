@@ -0,0 +1,119 @@
+/**
+ *  \file decompress.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Compressed input.
+ *
+ *  gzip and zstd files read by the reader, either decompressed by it into the stream buffers or, for
+ *  BGZF files, cut into whole blocks that the workers inflate in parallel:
+ *     \li compressedFile
+ *     \li initInflaters
+ *     \li openDecoder
+ *     \li decodeBuffer
+ *     \li readBlocks
+ *     \li inflateBlocks
+ *     \li closeDecoder.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef DECOMPRESS_H
+#define DECOMPRESS_H
+
+/**
+ *  \brief Tell whether a file is gzip or zstd compressed, from its first bytes.
+ *
+ *  Operation carried out by main, before choosing how the files are read.
+ *
+ *  \param fileName file name, "-" (stdin) is never looked at
+ *
+ *  \return true if the file is compressed
+ */
+
+extern bool compressedFile(const char* fileName);
+
+/**
+ *  \brief Set up the inflate streams of the workers.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param nWorkers number of workers
+ *
+ *  \return false on allocation failure
+ */
+
+extern bool initInflaters(int nWorkers);
+
+/**
+ *  \brief Find the format of a file from its first bytes and set up its decoder.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  Pipes are never seeked, the bytes looked at are kept and decoded first.
+ *
+ *  \param decoder decoder to set up
+ *  \param fd file descriptor
+ *
+ *  \return false on a read error or a format that cannot be decoded
+ */
+
+extern bool openDecoder(struct Decoder* decoder, int fd);
+
+/**
+ *  \brief Fill a buffer with the decoded text of a plain, gzip or zstd file.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param decoder decoder of the file
+ *  \param buffer buffer to store the text
+ *  \param capacity buffer size
+ *
+ *  \return number of bytes decoded (less than capacity only at the end of the file), -1 on error
+ */
+
+extern int decodeBuffer(struct Decoder* decoder, unsigned char* buffer, int capacity);
+
+/**
+ *  \brief Fill a buffer with the next whole blocks of a BGZF file, still compressed.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param decoder decoder of the file
+ *  \param buffer buffer to store the blocks
+ *  \param capacity buffer size
+ *  \param decodedCapacity largest decoded size of the blocks taken together
+ *
+ *  \return number of bytes stored (0 at the end of the file), -1 on error
+ */
+
+extern int readBlocks(struct Decoder* decoder, unsigned char* buffer, int capacity, int decodedCapacity);
+
+/**
+ *  \brief Inflate the blocks stored by readBlocks.
+ *
+ *  Operation carried out by the workers, outside the monitor.
+ *
+ *  \param workerId worker id
+ *  \param blocks compressed blocks
+ *  \param size size of the blocks
+ *  \param buffer buffer to store the text
+ *  \param capacity buffer size
+ *  \param corruptBlocks number of blocks that could not be inflated, their text is left out
+ *
+ *  \return number of bytes decoded
+ */
+
+extern int inflateBlocks(int workerId, unsigned char* blocks, int size, unsigned char* buffer, int capacity, int* corruptBlocks);
+
+/**
+ *  \brief Release a decoder, the file descriptor is left open.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param decoder decoder of the file
+ */
+
+extern void closeDecoder(struct Decoder* decoder);
+
+#endif /* DECOMPRESS_H */
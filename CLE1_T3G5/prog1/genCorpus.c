@@ -0,0 +1,383 @@
+//	compile command
+// 		gcc -Wall -O3 -o genCorpus genCorpus.c
+
+//	run command
+// 		./genCorpus [-s seed] [-b bytes] [-f files] [-a accents] [-q quotes] [-w word_length] [-l line_length] [prefix]
+// 		./genCorpus -s 7 -b 2G -f 4 corpus > corpus.expected
+
+//	options
+// 		-s seed		random seed, the same seed and options always give the same corpus (default 1)
+// 		-b bytes	total size of the corpus, with an optional K, M, G or T suffix (default 64M)
+// 		-f files	number of files, named prefix0.txt, prefix1.txt, ... (default 1)
+// 		-a accents	fraction of accented letters, á é í ó ú â ê ô ã õ à ç and their capitals (default 0.05)
+// 		-q quotes	fraction of word gaps with a multi-byte separator, “ ” – … (default 0.02)
+// 		-w length	mean word length in letters (default 5)
+// 		-l length	mean line length in bytes (default 70)
+
+//	verify command
+// 		./countWords 4 corpus*.txt | sed -n '/^File name/,/^$/p' | diff - corpus.expected
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+
+#include "consts.h"
+
+/** \brief size of the output buffer */
+#define OUT_BUFFER_SIZE (1 << 20)
+
+/** \brief longest word, in letters */
+#define MAX_WORD_LENGTH 30
+
+/** \brief letter entry, its utf-8 bytes in lower and upper case and its vowel offset */
+struct Letter {
+	const char* lower;
+	const char* upper;
+	int vowel;										/* -1 for consonants */
+	int weight;
+};
+
+/** \brief plain letters, weighted by their frequency in Portuguese text (y is raised so it shows up) */
+static const struct Letter plainLetters[] = {
+	{ "a", "A", A, 146 }, { "e", "E", E, 126 }, { "o", "O", O, 107 }, { "s", "S", -1, 78 }, { "r", "R", -1, 65 },
+	{ "i", "I", I, 62 }, { "n", "N", -1, 50 }, { "d", "D", -1, 50 }, { "m", "M", -1, 47 }, { "u", "U", U, 46 },
+	{ "t", "T", -1, 43 }, { "c", "C", -1, 39 }, { "l", "L", -1, 28 }, { "p", "P", -1, 25 }, { "v", "V", -1, 17 },
+	{ "g", "G", -1, 13 }, { "h", "H", -1, 13 }, { "q", "Q", -1, 12 }, { "b", "B", -1, 10 }, { "f", "F", -1, 10 },
+	{ "z", "Z", -1, 5 }, { "j", "J", -1, 4 }, { "x", "X", -1, 2 }, { "y", "Y", Y, 2 }, { "w", "W", -1, 1 },
+	{ "k", "K", -1, 1 }
+};
+
+/** \brief accented letters, folded by the counters to their base letter */
+static const struct Letter accentedLetters[] = {
+	{ "á", "Á", A, 30 }, { "é", "É", E, 20 }, { "í", "Í", I, 15 }, { "ó", "Ó", O, 10 }, { "ú", "Ú", U, 5 },
+	{ "â", "Â", A, 5 }, { "ê", "Ê", E, 10 }, { "ô", "Ô", O, 5 }, { "ã", "Ã", A, 30 }, { "õ", "Õ", O, 10 },
+	{ "à", "À", A, 5 }, { "ç", "Ç", -1, 30 }
+};
+
+/** \brief word gaps with a multi-byte separator */
+static const char* quoteGaps[] = { " “", "” ", " – ", "… " };
+
+/** \brief word gaps with ascii punctuation, the first ones end a sentence */
+static const char* punctuationGaps[] = { ". ", "! ", "? ", ", ", "; ", ": ", " (", ") ", " \"", "\" ", "-" };
+
+/** \brief punctuation gaps that end a sentence */
+static const int sentenceGaps = 3;
+
+/** \brief letters are looked up in a table where each one fills as many slots as its weight */
+static unsigned char plainTable[1024], accentedTable[256];
+
+/** \brief random generator state */
+static unsigned long long rngState;
+
+/** \brief output buffer */
+static char outBuffer[OUT_BUFFER_SIZE];
+
+/** \brief bytes in the output buffer */
+static int outSize = 0;
+
+/** \brief bytes emitted so far */
+static long long emitted = 0;
+
+/** \brief next random number */
+static unsigned long long nextRandom(void);
+
+/** \brief random number in [0, 1) */
+static double nextUniform(void);
+
+/** \brief fill a letter lookup table */
+static void fillTable(unsigned char* table, int size, const struct Letter* letters, int nLetters);
+
+/** \brief parse a size with an optional suffix */
+static long long parseSize(const char* text);
+
+/** \brief append bytes to the output buffer */
+static void emit(FILE* file, const char* bytes);
+
+/** \brief write the output buffer */
+static void flushBuffer(FILE* file);
+
+/**
+ *  \brief Main function.
+ *
+ *  Writes the corpus files and prints the expected results of every file in the format of the
+ *  counters.
+ *
+ *  Words are runs of letters (or digits) with an apostrophe now and then, which does not split
+ *  them. Every gap holds at least one separator, so each generated word is exactly one counted word
+ *  and its vowels are known as it is written.
+ *
+ *  \param argc number of words of the command line
+ *  \param argv list of words of the command line
+ *
+ *  \return status of operation
+ */
+
+int main(int argc, char *argv[])
+{
+	unsigned long long seed = 1;
+	long long totalBytes = 64LL << 20;
+	int nFiles = 1;
+	double accents = 0.05, quotes = 0.02, wordLength = 5.0, lineLength = 70.0;
+	const char* prefix = "corpus";
+	int opt;
+
+	// parse command line options
+	while ((opt = getopt(argc, argv, "s:b:f:a:q:w:l:")) != -1)
+	{
+		switch (opt)
+		{
+			case 's':
+				seed = strtoull(optarg, NULL, 0);
+				break;
+			case 'b':
+				totalBytes = parseSize(optarg);
+				break;
+			case 'f':
+				nFiles = atoi(optarg);
+				break;
+			case 'a':
+				accents = atof(optarg);
+				break;
+			case 'q':
+				quotes = atof(optarg);
+				break;
+			case 'w':
+				wordLength = atof(optarg);
+				break;
+			case 'l':
+				lineLength = atof(optarg);
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-s seed] [-b bytes] [-f files] [-a accents] [-q quotes] [-w word_length] [-l line_length] [prefix]\n", argv[0]);
+				exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc)
+		prefix = argv[optind];
+
+	if (totalBytes < 0 || nFiles < 1 || accents < 0.0 || accents > 1.0 || quotes < 0.0 || quotes > 1.0 ||
+		wordLength < 1.0 || wordLength > MAX_WORD_LENGTH || lineLength < 1.0)
+	{
+		fprintf(stderr, "invalid option value\n");
+		exit(EXIT_FAILURE);
+	}
+
+	fillTable(plainTable, sizeof(plainTable), plainLetters, sizeof(plainLetters) / sizeof(plainLetters[0]));
+	fillTable(accentedTable, sizeof(accentedTable), accentedLetters, sizeof(accentedLetters) / sizeof(accentedLetters[0]));
+
+	/* splitmix64 seeding, so that close seeds give unrelated corpora */
+	rngState = seed;
+
+	/* longer words are more likely to go on */
+	double goOn = (wordLength - 1.0) / wordLength;
+
+	for (int f = 0; f < nFiles; f++)
+	{
+		char fileName[4096];
+		long long fileBytes = totalBytes / nFiles + ((f == nFiles - 1) ? totalBytes % nFiles : 0);
+		long long start = emitted;
+		long long nWords = 0;
+		long long vowels[6] = { 0 };
+		long lineLeft = (long) (lineLength * (0.5 + nextUniform()));
+		bool capital = true;
+		FILE* file;
+
+		snprintf(fileName, sizeof(fileName), "%s%d.txt", prefix, f);
+		if ((file = fopen(fileName, "w")) == NULL)
+		{
+			fprintf(stderr, "error on opening text file \"%s\"\n", fileName);
+			exit(EXIT_FAILURE);
+		}
+
+		while (emitted - start < fileBytes)
+		{
+			unsigned int vowelMask = 0;
+			int length = 1;
+
+			while (length < MAX_WORD_LENGTH && nextUniform() < goOn)
+				length++;
+
+			/* word, a number now and then */
+			long long before = emitted;
+			if (nextUniform() < 0.01)
+			{
+				for (int i = 0; i < length; i++)
+				{
+					char digit[2] = { (char) ('0' + nextRandom() % 10), '\0' };
+					emit(file, digit);
+				}
+			}
+			else
+			{
+				for (int i = 0; i < length; i++)
+				{
+					const struct Letter* letter = (nextUniform() < accents) ? &accentedLetters[accentedTable[nextRandom() & 255]] :
+						&plainLetters[plainTable[nextRandom() & 1023]];
+
+					emit(file, (capital && i == 0) ? letter->upper : letter->lower);
+					if (letter->vowel >= 0)
+						vowelMask |= 1 << letter->vowel;
+
+					/* apostrophes are neither word characters nor separators */
+					if (i == 0 && length > 2 && nextUniform() < 0.01)
+						emit(file, (nextRandom() & 1) ? "'" : "’");
+				}
+			}
+			capital = false;
+
+			nWords++;
+			for (int i = 0; i < 6; i++)
+				vowels[i] += (vowelMask >> i) & 1;
+
+			/* gap, a new line once the line is long enough */
+			const char* gap = " ";
+			double r = nextUniform();
+
+			if (r < quotes)
+				gap = quoteGaps[nextRandom() % 4];
+			else if (r < quotes + 0.12)
+			{
+				int p = (int) (nextRandom() % (sizeof(punctuationGaps) / sizeof(punctuationGaps[0])));
+
+				gap = punctuationGaps[p];
+				capital = (p < sentenceGaps);
+			}
+			emit(file, gap);
+
+			lineLeft -= emitted - before;
+			if (lineLeft <= 0)
+			{
+				emit(file, "\n");
+				lineLeft = (long) (lineLength * (0.5 + nextUniform()));
+			}
+		}
+
+		flushBuffer(file);
+		if (fclose(file) == EOF)
+		{
+			fprintf(stderr, "error on closing text file \"%s\"\n", fileName);
+			exit(EXIT_FAILURE);
+		}
+
+		printf("File name: %s\n", fileName);
+		printf("Total number of words = %lld\n", nWords);
+		printf("Number of words with an\n");
+		printf("\tA\tE\tI\tO\tU\tY\n");
+		printf("\t%lld\t%lld\t%lld\t%lld\t%lld\t%lld\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
+	}
+
+	return 0;
+}
+
+/**
+ *  \brief Next random number (splitmix64).
+ *
+ *  \return 64 random bits
+ */
+
+static unsigned long long nextRandom(void)
+{
+	unsigned long long z = (rngState += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ *  \brief Random number in [0, 1).
+ *
+ *  \return random number
+ */
+
+static double nextUniform(void)
+{
+	return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ *  \brief Fill a letter lookup table, each letter fills a share of the slots given by its weight.
+ *
+ *  \param table lookup table
+ *  \param size number of slots
+ *  \param letters letters
+ *  \param nLetters number of letters
+ */
+
+static void fillTable(unsigned char* table, int size, const struct Letter* letters, int nLetters)
+{
+	int total = 0, slot = 0, sum = 0;
+
+	for (int i = 0; i < nLetters; i++)
+		total += letters[i].weight;
+
+	for (int i = 0; i < nLetters; i++)
+	{
+		sum += letters[i].weight;
+		for (int end = (int) ((long) sum * size / total); slot < end; slot++)
+			table[slot] = (unsigned char) i;
+	}
+}
+
+/**
+ *  \brief Parse a size with an optional K, M, G or T suffix.
+ *
+ *  \param text size
+ *
+ *  \return size in bytes, -1 if invalid
+ */
+
+static long long parseSize(const char* text)
+{
+	char* end;
+	long long size = strtoll(text, &end, 10);
+
+	switch (*end)
+	{
+		case 'T': size <<= 10; /* fall through */
+		case 'G': size <<= 10; /* fall through */
+		case 'M': size <<= 10; /* fall through */
+		case 'K': size <<= 10; end++; break;
+		case '\0': break;
+		default: return -1;
+	}
+
+	return (*end == '\0') ? size : -1;
+}
+
+/**
+ *  \brief Append bytes to the output buffer, writing it when full.
+ *
+ *  \param file output file
+ *  \param bytes null terminated bytes
+ */
+
+static void emit(FILE* file, const char* bytes)
+{
+	int size = (int) strlen(bytes);
+
+	if (outSize + size > OUT_BUFFER_SIZE)
+		flushBuffer(file);
+
+	memcpy(outBuffer + outSize, bytes, size);
+	outSize += size;
+	emitted += size;
+}
+
+/**
+ *  \brief Write the output buffer.
+ *
+ *  \param file output file
+ */
+
+static void flushBuffer(FILE* file)
+{
+	if (outSize > 0 && fwrite(outBuffer, 1, outSize, file) != (size_t) outSize)
+	{
+		fprintf(stderr, "error on writing the corpus\n");
+		exit(EXIT_FAILURE);
+	}
+	outSize = 0;
+}
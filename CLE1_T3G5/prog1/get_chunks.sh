@@ -0,0 +1,29 @@
+# throughput across fixed chunk sizes (-c) against the run time chosen, guided chunks
+
+#	compile commands
+# 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c textKernel.c ioRing.c instrument.c resultCache.c wordFreq.c server.c placement.c decompress.c textMetrics.c -lpthread -lm -lz
+# 		gcc -Wall -O3 -o parseTimes parseTimes.c -lm
+
+#	run command
+# 		./get_chunks.sh [corpus_file] [threads] [mode]
+
+corpus=${1:-corpus.txt}
+threads=${2:-4}
+mode=${3:-}
+
+# build a larger corpus out of the sample texts if none was given
+if [ ! -f $corpus ]; then
+	for i in `seq 200`; do cat text0.txt text1.txt text2.txt text3.txt text4.txt; done > $corpus
+fi
+
+bytes=$(stat -c %s $corpus)
+array=()
+
+for chunk in 1024 4096 16384 65536 262144 1048576 4194304 16777216 auto; do
+	option="-c $chunk"
+	[ $chunk == auto ] && option=""
+	echo "chunk size $chunk, mode \"$mode\", $threads threads"
+	for i in `seq 5`; do array[$i]=$(./countWords $mode $option $threads $corpus | sed -n 's/^Elapsed time = \(.*\) s$/\1/p'); done;
+	./parseTimes ${array[1]} ${array[2]} ${array[3]} ${array[4]} ${array[5]} | tee /dev/stderr | \
+		awk -v bytes=$bytes '/^Mean time/ { printf("Throughput = %.1f MB/s\n", bytes / $4 / 1.0e6) }'
+done 2>&1
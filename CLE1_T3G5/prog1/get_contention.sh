@@ -0,0 +1,25 @@
+# contention comparison of the chunk schedulers: stdio monitor, mapped monitor (-m) and atomic index (-a)
+
+#	compile commands
+# 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c textKernel.c ioRing.c instrument.c resultCache.c wordFreq.c server.c placement.c decompress.c textMetrics.c -lpthread -lm -lz
+# 		gcc -Wall -O3 -o parseTimes parseTimes.c -lm
+
+#	run command
+# 		./get_contention.sh [corpus_file]
+
+corpus=${1:-corpus.txt}
+
+# build a larger corpus out of the sample texts if none was given
+if [ ! -f $corpus ]; then
+	for i in `seq 200`; do cat text0.txt text1.txt text2.txt text3.txt text4.txt; done > $corpus
+fi
+
+array=()
+
+for mode in "" "-m" "-a"; do
+	for t in 1 2 4 8 16 32 64; do
+		echo "mode \"$mode\", $t threads"
+		for i in `seq 5`; do array[$i]=$(./countWords $mode $t $corpus | sed -n 's/^Elapsed time = \(.*\) s$/\1/p'); done;
+		./parseTimes ${array[1]} ${array[2]} ${array[3]} ${array[4]} ${array[5]}
+	done
+done
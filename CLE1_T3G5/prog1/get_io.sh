@@ -0,0 +1,30 @@
+# read path comparison on many small files: stdio monitor, memory mapped (-m) and io_uring reader (-u)
+
+#	compile commands
+# 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c textKernel.c ioRing.c instrument.c resultCache.c wordFreq.c server.c placement.c decompress.c textMetrics.c -lpthread -lm -lz
+# 		gcc -Wall -O3 -o parseTimes parseTimes.c -lm
+
+#	run command
+# 		./get_io.sh [corpus_dir] [threads]
+
+corpus=${1:-corpus}
+threads=${2:-4}
+
+# split copies of the sample texts into many small files if no corpus was given
+if [ ! -d $corpus ]; then
+	mkdir -p $corpus
+	for i in `seq 4000`; do cat text$((i % 5)).txt > $corpus/text$i.txt; done
+fi
+
+# drop the page cache between runs when allowed, so the reads hit the storage
+drop_caches() { sync; echo 3 > /proc/sys/vm/drop_caches 2>/dev/null; }
+
+array=()
+
+for mode in "" "-m" "-u"; do
+	echo "mode \"$mode\", $threads threads"
+	drop_caches
+	./countWords -t $mode $threads $corpus/*.txt | grep "^Reads"
+	for i in `seq 5`; do drop_caches; array[$i]=$(./countWords $mode $threads $corpus/*.txt | sed -n 's/^Elapsed time = \(.*\) s$/\1/p'); done;
+	./parseTimes ${array[1]} ${array[2]} ${array[3]} ${array[4]} ${array[5]}
+done
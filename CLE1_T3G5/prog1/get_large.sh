@@ -0,0 +1,34 @@
+# counts of one file over 4 GB against the totals of the generator: stdio monitor, memory mapped (-m) and
+# atomic chunk counter (-a) modes, and the MPI counter
+
+#	compile commands
+# 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c textKernel.c ioRing.c instrument.c resultCache.c wordFreq.c server.c placement.c decompress.c textMetrics.c -lpthread -lm -lz
+# 		gcc -Wall -O3 -o genCorpus genCorpus.c
+# 		mpicc -Wall -O3 -o ../../CLE2_T3G5/prog1/countWords ../../CLE2_T3G5/prog1/countWords.c -lm
+
+#	run command
+# 		./get_large.sh [bytes] [threads] [processes]
+
+bytes=${1:-5G}
+threads=${2:-4}
+processes=${3:-3}
+mpiCounter=../../CLE2_T3G5/prog1/countWords
+
+# generate the file once, with the totals every run is checked against
+if [ ! -f large0.txt ]; then
+	./genCorpus -s 11 -b $bytes -f 1 large > large.expected
+fi
+
+size=$(stat -c %s large0.txt)
+[ $size -le 4294967296 ] && echo "large0.txt has $size bytes, the 32-bit offsets and counters are not crossed"
+
+# the file results of a run, without the messages and times around them
+check() { sed -n '/^File name/,/^$/p' | diff large.expected - && echo "same totals" || echo "wrong totals"; }
+
+for mode in "" "-m" "-a"; do
+	echo "mode \"$mode\", $threads threads"
+	./countWords $mode $threads large0.txt | check
+done
+
+echo "MPI counter, $processes processes"
+mpiexec -n $processes $mpiCounter large0.txt | check
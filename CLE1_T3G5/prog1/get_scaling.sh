@@ -0,0 +1,37 @@
+# strong scaling on a generated corpus, from one thread to every online cpu, with the speedup and efficiency
+
+#	compile commands
+# 		gcc -Wall -O3 -o countWords countWords.c sharedMemory.c textKernel.c ioRing.c instrument.c resultCache.c wordFreq.c server.c placement.c decompress.c textMetrics.c -lpthread -lm -lz
+# 		gcc -Wall -O3 -o genCorpus genCorpus.c
+# 		gcc -Wall -O3 -o parseTimes parseTimes.c -lm
+
+#	run command
+# 		./get_scaling.sh [bytes] [mode]
+
+bytes=${1:-4G}
+mode=${2:-}
+cpus=$(nproc)
+
+# generate the corpus once, with the results every run is checked against
+if [ ! -f scaling0.txt ]; then
+	./genCorpus -s 7 -b $bytes -f 8 scaling > scaling.expected
+fi
+
+# powers of two up to the number of online cpus, and that number itself
+threads=1
+for ((t = 2; t < cpus; t *= 2)); do threads="$threads $t"; done
+[ $cpus -gt 1 ] && threads="$threads $cpus"
+
+array=()
+base=0
+
+for t in $threads; do
+	echo "mode \"$mode\", $t threads"
+	for i in `seq 5`; do
+		array[$i]=$(./countWords $mode $t scaling*.txt | tee scaling.out | sed -n 's/^Elapsed time = \(.*\) s$/\1/p')
+		sed -n '/^File name/,/^$/p' scaling.out | diff -q - scaling.expected > /dev/null || echo "wrong results with $t threads"
+	done
+	mean=$(./parseTimes ${array[1]} ${array[2]} ${array[3]} ${array[4]} ${array[5]} | tee /dev/stderr | awk '/^Mean time/ { print $4 }')
+	[ $t -eq 1 ] && base=$mean
+	awk -v base=$base -v mean=$mean -v t=$t 'BEGIN { printf("Speedup = %.2f, efficiency = %.0f %%\n", base / mean, 100 * base / mean / t) }'
+done 2>&1
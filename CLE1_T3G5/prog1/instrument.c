@@ -0,0 +1,364 @@
+/**
+ *  \file instrument.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Per-phase lock and latency probes.
+ *
+ *  Optional timing of the worker phases (requesting, decoding and posting chunks, waiting for and
+ *  holding the locks), kept per worker and printed by main at exit:
+ *     \li initInstrument
+ *     \li probeTime
+ *     \li recordPhase
+ *     \li probeAcquired
+ *     \li probeReleased
+ *     \li recordChunk
+ *     \li printInstrument.
+ *
+ *  The probes read the time stamp counter on x86 (a few cycles, no system call) and
+ *  CLOCK_MONOTONIC_RAW elsewhere. Each worker only writes its own statistics, kept in separate
+ *  cache lines, so the probes take no lock.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "consts.h"
+#include "instrument.h"
+
+/** \brief main thread return status */
+extern int statusMain;
+
+/** \brief the probes are on */
+static bool instrumentOn = false;
+
+/** \brief per worker statistics */
+static struct PhaseStats* phaseStats = NULL;
+
+/** \brief number of workers */
+static int totalWorkers = 0;
+
+/** \brief nanoseconds per probe clock tick */
+static double nsPerTick = 1.0;
+
+/** \brief phase names, in phase order */
+static const char* phaseNames[PHASES] = { "request", "lock wait", "lock hold", "starved", "read", "decode", "post" };
+
+/** \brief nanoseconds of CLOCK_MONOTONIC_RAW */
+static unsigned long long rawTime(void);
+
+/** \brief add a sample to a phase of a worker */
+static void addSample(int workerId, int phase, unsigned long long ticks);
+
+/** \brief upper edge of the histogram bucket holding a fraction of the samples */
+static long long percentile(long* histogram, long samples, double fraction);
+
+/** \brief print the histogram of a phase */
+static void printHistogram(int phase, long* histogram, long samples, double time);
+
+/**
+ *  \brief Turn the probes on.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  The time stamp counter is calibrated against CLOCK_MONOTONIC_RAW over a few milliseconds.
+ *
+ *  \param nWorkers number of workers
+ */
+
+void initInstrument(int nWorkers)
+{
+	if ((phaseStats = aligned_alloc(CACHE_LINE_SIZE, nWorkers * sizeof(struct PhaseStats))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the phase statistics\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	memset(phaseStats, 0, nWorkers * sizeof(struct PhaseStats));
+	totalWorkers = nWorkers;
+
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned long long ns0 = rawTime();
+	unsigned long long tsc0 = __rdtsc();
+	unsigned long long ns1;
+
+	while ((ns1 = rawTime()) - ns0 < 10000000ULL)
+		;
+	nsPerTick = (double) (ns1 - ns0) / (double) (__rdtsc() - tsc0);
+#endif
+
+	instrumentOn = true;
+}
+
+/**
+ *  \brief Read the probe clock.
+ *
+ *  \return clock ticks (time stamp counter, or CLOCK_MONOTONIC_RAW nanoseconds)
+ */
+
+unsigned long long probeTime(void)
+{
+	if (!instrumentOn)
+		return 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return rawTime();
+#endif
+}
+
+/**
+ *  \brief Charge the time elapsed since a probe to a phase.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param phase phase identifier
+ *  \param t0 probe taken at the start of the phase
+ *
+ *  \return probe taken at the end of the phase
+ */
+
+unsigned long long recordPhase(int workerId, int phase, unsigned long long t0)
+{
+	if (!instrumentOn)
+		return 0;
+
+	unsigned long long t1 = probeTime();
+
+	addSample(workerId, phase, t1 - t0);
+	return t1;
+}
+
+/**
+ *  \brief A lock was acquired, charge the wait to a phase and start timing the hold.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  A worker holds at most one lock at a time, so a single hold start per worker is enough.
+ *
+ *  \param workerId worker id
+ *  \param phase phase the wait is charged to (lock wait, or starved after a condition wait)
+ *  \param t0 probe taken before locking
+ */
+
+void probeAcquired(int workerId, int phase, unsigned long long t0)
+{
+	if (!instrumentOn)
+		return;
+
+	phaseStats[workerId].heldSince = recordPhase(workerId, phase, t0);
+}
+
+/**
+ *  \brief A lock is about to be released, charge the hold.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ */
+
+void probeReleased(int workerId)
+{
+	if (!instrumentOn)
+		return;
+
+	(void) recordPhase(workerId, PHASE_LOCK_HOLD, phaseStats[workerId].heldSince);
+}
+
+/**
+ *  \brief Count a processed chunk.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param chunkSize chunk size
+ */
+
+void recordChunk(int workerId, int chunkSize)
+{
+	if (!instrumentOn)
+		return;
+
+	phaseStats[workerId].chunks++;
+	phaseStats[workerId].bytes += chunkSize;
+}
+
+/**
+ *  \brief Print the per worker and aggregate breakdowns and the latency histograms.
+ *
+ *  Operation carried out by main, after joining the workers.
+ *
+ *  The times are in milliseconds, the percentiles are the upper edges of the log2 buckets. Request,
+ *  decode and post cover the whole worker life, lock wait, lock hold, starved and read are the parts
+ *  of request and post spent on the locks and the reads.
+ */
+
+void printInstrument(void)
+{
+	if (!instrumentOn)
+		return;
+
+	struct PhaseStats all;
+
+	memset(&all, 0, sizeof(all));
+
+#if defined(__x86_64__) || defined(__i386__)
+	printf("\nPhase breakdown (time stamp counter, %.3f GHz)\n", 1.0 / nsPerTick);
+#else
+	printf("\nPhase breakdown (CLOCK_MONOTONIC_RAW)\n");
+#endif
+	printf("%6s %8s %10s", "worker", "chunks", "MB");
+	for (int p = 0; p < PHASES; p++)
+		printf(" %12s", phaseNames[p]);
+	printf(" %12s %12s\n", "decode MB/s", "wait p99 ns");
+
+	for (int i = 0; i <= totalWorkers; i++)
+	{
+		struct PhaseStats* stats = &phaseStats[i];
+
+		/* the last row is the aggregate */
+		if (i == totalWorkers)
+			stats = &all;
+		else
+		{
+			all.chunks += stats->chunks;
+			all.bytes += stats->bytes;
+			for (int p = 0; p < PHASES; p++)
+			{
+				all.samples[p] += stats->samples[p];
+				all.time[p] += stats->time[p];
+				for (int b = 0; b < HISTOGRAM_BINS; b++)
+					all.histogram[p][b] += stats->histogram[p][b];
+			}
+		}
+
+		if (i == totalWorkers)
+			printf("%6s", "all");
+		else
+			printf("%6d", i);
+		printf(" %8ld %10.2f", stats->chunks, stats->bytes / 1.0e6);
+		for (int p = 0; p < PHASES; p++)
+			printf(" %12.3f", stats->time[p] / 1.0e6);
+		printf(" %12.1f %12lld\n", (stats->time[PHASE_DECODE] > 0) ? stats->bytes / stats->time[PHASE_DECODE] * 1.0e3 : 0.0,
+			percentile(stats->histogram[PHASE_LOCK_WAIT], stats->samples[PHASE_LOCK_WAIT], 0.99));
+	}
+
+	for (int p = 0; p < PHASES; p++)
+		if (all.samples[p] > 0)
+			printHistogram(p, all.histogram[p], all.samples[p], all.time[p]);
+}
+
+/**
+ *  \brief Nanoseconds of CLOCK_MONOTONIC_RAW.
+ *
+ *  Auxiliar function.
+ *
+ *  \return nanoseconds
+ */
+
+static unsigned long long rawTime(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+	return (unsigned long long) t.tv_sec * 1000000000ULL + (unsigned long long) t.tv_nsec;
+}
+
+/**
+ *  \brief Add a sample to a phase of a worker.
+ *
+ *  Auxiliar function, carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param phase phase identifier
+ *  \param ticks duration in probe clock ticks
+ */
+
+static void addSample(int workerId, int phase, unsigned long long ticks)
+{
+	struct PhaseStats* stats = &phaseStats[workerId];
+	unsigned long long ns = (unsigned long long) (ticks * nsPerTick);
+	int bin = (ns > 1) ? 63 - __builtin_clzll(ns) : 0;
+
+	if (bin >= HISTOGRAM_BINS)
+		bin = HISTOGRAM_BINS - 1;
+
+	stats->samples[phase]++;
+	stats->time[phase] += (double) ns;
+	stats->histogram[phase][bin]++;
+}
+
+/**
+ *  \brief Upper edge of the histogram bucket holding a fraction of the samples.
+ *
+ *  Auxiliar function.
+ *
+ *  \param histogram log2 buckets
+ *  \param samples number of samples
+ *  \param fraction fraction of the samples
+ *
+ *  \return upper edge in nanoseconds, 0 without samples
+ */
+
+static long long percentile(long* histogram, long samples, double fraction)
+{
+	long seen = 0;
+
+	if (samples == 0)
+		return 0;
+
+	for (int b = 0; b < HISTOGRAM_BINS; b++)
+	{
+		seen += histogram[b];
+		if (seen >= fraction * samples)
+			return 2LL << b;
+	}
+
+	return 2LL << (HISTOGRAM_BINS - 1);
+}
+
+/**
+ *  \brief Print the histogram of a phase.
+ *
+ *  Auxiliar function, carried out by main.
+ *
+ *  \param phase phase identifier
+ *  \param histogram log2 buckets
+ *  \param samples number of samples
+ *  \param time total time in nanoseconds
+ */
+
+static void printHistogram(int phase, long* histogram, long samples, double time)
+{
+	long most = 0;
+
+	for (int b = 0; b < HISTOGRAM_BINS; b++)
+		if (histogram[b] > most)
+			most = histogram[b];
+
+	printf("\n%s: %ld samples, mean %.0f ns, p50 < %lld ns, p99 < %lld ns\n", phaseNames[phase], samples, time / samples,
+		percentile(histogram, samples, 0.50), percentile(histogram, samples, 0.99));
+
+	for (int b = 0; b < HISTOGRAM_BINS; b++)
+	{
+		if (histogram[b] == 0)
+			continue;
+
+		printf("  [%12lld, %12lld) ns %10ld ", (b == 0) ? 0LL : 1LL << b, 2LL << b, histogram[b]);
+		for (int i = 0, bar = (int) (40 * histogram[b] / most); i < bar || i == 0; i++)
+			putchar('#');
+		putchar('\n');
+	}
+}
@@ -0,0 +1,99 @@
+/**
+ *  \file instrument.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Per-phase lock and latency probes.
+ *
+ *  Optional timing of the worker phases (requesting, decoding and posting chunks, waiting for and
+ *  holding the locks), kept per worker and printed by main at exit:
+ *     \li initInstrument
+ *     \li probeTime
+ *     \li recordPhase
+ *     \li probeAcquired
+ *     \li probeReleased
+ *     \li recordChunk
+ *     \li printInstrument.
+ *
+ *  Every probe returns at once when the instrumentation is off.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+/**
+ *  \brief Turn the probes on.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param nWorkers number of workers
+ */
+
+extern void initInstrument(int nWorkers);
+
+/**
+ *  \brief Read the probe clock.
+ *
+ *  \return clock ticks (time stamp counter, or CLOCK_MONOTONIC_RAW nanoseconds)
+ */
+
+extern unsigned long long probeTime(void);
+
+/**
+ *  \brief Charge the time elapsed since a probe to a phase.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param phase phase identifier
+ *  \param t0 probe taken at the start of the phase
+ *
+ *  \return probe taken at the end of the phase
+ */
+
+extern unsigned long long recordPhase(int workerId, int phase, unsigned long long t0);
+
+/**
+ *  \brief A lock was acquired, charge the wait to a phase and start timing the hold.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param phase phase the wait is charged to (lock wait, or starved after a condition wait)
+ *  \param t0 probe taken before locking
+ */
+
+extern void probeAcquired(int workerId, int phase, unsigned long long t0);
+
+/**
+ *  \brief A lock is about to be released, charge the hold.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ */
+
+extern void probeReleased(int workerId);
+
+/**
+ *  \brief Count a processed chunk.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param chunkSize chunk size
+ */
+
+extern void recordChunk(int workerId, int chunkSize);
+
+/**
+ *  \brief Print the per worker and aggregate breakdowns and the latency histograms.
+ *
+ *  Operation carried out by main, after joining the workers.
+ */
+
+extern void printInstrument(void);
+
+#endif /* INSTRUMENT_H */
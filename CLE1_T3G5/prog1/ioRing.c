@@ -0,0 +1,192 @@
+/**
+ *  \file ioRing.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Asynchronous reads through io_uring.
+ *
+ *  Minimal io_uring wrapper over the raw system calls, used by the reader only:
+ *     \li initIoRing
+ *     \li queueRead
+ *     \li waitRead
+ *     \li closeIoRing.
+ *
+ *  Only the reader touches the rings, so they need no locking. The ring heads and tails shared with
+ *  the kernel are accessed with acquire / release atomics.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "ioRing.h"
+
+/** \brief io_uring file descriptor */
+static int ringFd = -1;
+
+/** \brief submission ring head, tail, mask and index array */
+static unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+
+/** \brief completion ring head, tail and mask */
+static unsigned *cqHead, *cqTail, *cqMask;
+
+/** \brief submission queue entries */
+static struct io_uring_sqe* sqes;
+
+/** \brief completion queue entries */
+static struct io_uring_cqe* cqes;
+
+/** \brief mappings of the rings and their sizes */
+static void *sqRing, *cqRing;
+static size_t sqRingSize, cqRingSize, sqesSize;
+
+/** \brief reads queued but not yet submitted */
+static unsigned toSubmit;
+
+/**
+ *  \brief Set up the submission and completion rings.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param entries maximum number of reads in flight
+ *
+ *  \return false if io_uring is not available (the caller falls back to another read path)
+ */
+
+bool initIoRing(int entries)
+{
+	struct io_uring_params params;
+	
+	memset(&params, 0, sizeof(params));
+	if ((ringFd = (int) syscall(__NR_io_uring_setup, entries, &params)) < 0)
+		return false;
+	
+	sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+	
+	/* both rings may share a single mapping */
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sqRingSize = cqRingSize = (sqRingSize > cqRingSize) ? sqRingSize : cqRingSize;
+	
+	sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+	cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? sqRing :
+		mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+	sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+	
+	if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED)
+	{
+		close(ringFd);
+		ringFd = -1;
+		return false;
+	}
+	
+	sqHead = (unsigned*) ((char*) sqRing + params.sq_off.head);
+	sqTail = (unsigned*) ((char*) sqRing + params.sq_off.tail);
+	sqMask = (unsigned*) ((char*) sqRing + params.sq_off.ring_mask);
+	sqArray = (unsigned*) ((char*) sqRing + params.sq_off.array);
+	cqHead = (unsigned*) ((char*) cqRing + params.cq_off.head);
+	cqTail = (unsigned*) ((char*) cqRing + params.cq_off.tail);
+	cqMask = (unsigned*) ((char*) cqRing + params.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe*) ((char*) cqRing + params.cq_off.cqes);
+	toSubmit = 0;
+	
+	return true;
+}
+
+/**
+ *  \brief Queue a read, it is only submitted on the next wait.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  The caller never has more reads in flight than the entries given to initIoRing.
+ *
+ *  \param fd file descriptor
+ *  \param buffer buffer to store the bytes read
+ *  \param size number of bytes to read
+ *  \param offset file offset
+ *  \param tag identifier returned with the completion
+ */
+
+void queueRead(int fd, unsigned char* buffer, int size, long offset, int tag)
+{
+	unsigned tail = *sqTail;
+	unsigned index = tail & *sqMask;
+	struct io_uring_sqe* sqe = &sqes[index];
+	
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long) buffer;
+	sqe->len = size;
+	sqe->off = offset;
+	sqe->user_data = tag;
+	sqArray[index] = index;
+	
+	__atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+	toSubmit++;
+}
+
+/**
+ *  \brief Submit the queued reads and wait for a completion.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param tag identifier given to the completed read
+ *
+ *  \return number of bytes read, or a negative error number
+ */
+
+int waitRead(int* tag)
+{
+	while (true)
+	{
+		unsigned head = *cqHead;
+		
+		/* a completion is already waiting, and nothing is left to submit */
+		if (toSubmit == 0 && head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+		{
+			struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+			int result = cqe->res;
+			
+			*tag = (int) cqe->user_data;
+			__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+			
+			return result;
+		}
+		
+		int submitted = (int) syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		
+		if (submitted < 0 && errno != EINTR)
+			return -errno;
+		if (submitted > 0)
+			toSubmit -= submitted;
+	}
+}
+
+/**
+ *  \brief Release the rings.
+ *
+ *  Operation carried out by the reader, once every read was completed.
+ */
+
+void closeIoRing(void)
+{
+	if (ringFd == -1)
+		return;
+	
+	munmap(sqes, sqesSize);
+	if (cqRing != sqRing)
+		munmap(cqRing, cqRingSize);
+	munmap(sqRing, sqRingSize);
+	close(ringFd);
+	ringFd = -1;
+}
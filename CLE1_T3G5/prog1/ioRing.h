@@ -0,0 +1,66 @@
+/**
+ *  \file ioRing.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Asynchronous reads through io_uring.
+ *
+ *  Minimal io_uring wrapper over the raw system calls, used by the reader only:
+ *     \li initIoRing
+ *     \li queueRead
+ *     \li waitRead
+ *     \li closeIoRing.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef IORING_H
+#define IORING_H
+
+/**
+ *  \brief Set up the submission and completion rings.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param entries maximum number of reads in flight
+ *
+ *  \return false if io_uring is not available (the caller falls back to another read path)
+ */
+
+extern bool initIoRing(int entries);
+
+/**
+ *  \brief Queue a read, it is only submitted on the next wait.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param fd file descriptor
+ *  \param buffer buffer to store the bytes read
+ *  \param size number of bytes to read
+ *  \param offset file offset
+ *  \param tag identifier returned with the completion
+ */
+
+extern void queueRead(int fd, unsigned char* buffer, int size, long offset, int tag);
+
+/**
+ *  \brief Submit the queued reads and wait for a completion.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param tag identifier given to the completed read
+ *
+ *  \return number of bytes read, or a negative error number
+ */
+
+extern int waitRead(int* tag);
+
+/**
+ *  \brief Release the rings.
+ *
+ *  Operation carried out by the reader, once every read was completed.
+ */
+
+extern void closeIoRing(void);
+
+#endif /* IORING_H */
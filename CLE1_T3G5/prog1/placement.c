@@ -0,0 +1,528 @@
+/**
+ *  \file placement.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Topology aware worker placement.
+ *
+ *  Optional pinning of the workers to cores read from /sys/devices/system/cpu, with their buffers on
+ *  the local NUMA node, and per worker throughput printed by main at exit:
+ *     \li initPlacement
+ *     \li workerAttributes
+ *     \li allocLocal
+ *     \li freeLocal
+ *     \li allocShared
+ *     \li beginWork
+ *     \li recordWork
+ *     \li endWork
+ *     \li printPlacement.
+ *
+ *  Only the cpus the process may run on are used. Every physical core gets a worker before any SMT
+ *  sibling does: compact placement fills the cores of a socket before moving to the next one,
+ *  scatter placement takes a core of each socket in turn. With more workers than cpus, the order
+ *  starts over.
+ *
+ *  The buffers are mapped with a preferred policy for the node of the worker cpu, so they are local
+ *  whichever thread touches them first.
+ *
+ *  The sorter of prog2 is built with this file too. Its workers sort a single shared sequence in
+ *  place, so instead of local buffers it is mapped with allocShared, its pages interleaved over the
+ *  nodes of the workers.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "consts.h"
+#include "placement.h"
+
+/** \brief preferred node memory policy of mbind */
+#define MPOL_PREFERRED_NODE 1
+
+/** \brief interleaved memory policy of mbind */
+#define MPOL_INTERLEAVE_NODES 3
+
+/** \brief main thread return status */
+extern int statusMain;
+
+/** \brief the workers are placed and timed */
+static bool placementOn = false;
+
+/** \brief the workers are pinned */
+static bool pinned = false;
+
+/** \brief name of the placement policy */
+static const char* policyName = "none";
+
+/** \brief per worker placement and throughput */
+static struct WorkerPlacement* placements = NULL;
+
+/** \brief per worker thread attributes */
+static pthread_attr_t* attributes = NULL;
+
+/** \brief number of workers */
+static int totalWorkers = 0;
+
+/** \brief read a number from a sysfs file */
+static int readNumber(const char* path, int fallback);
+
+/** \brief NUMA node of a cpu */
+static int cpuNode(int cpu);
+
+/** \brief order the cpus for compact placement */
+static int compareCompact(const void* a, const void* b);
+
+/** \brief order the cpus for scatter placement */
+static int compareScatter(const void* a, const void* b);
+
+/** \brief seconds of a clock */
+static double clockSeconds(clockid_t clock);
+
+/**
+ *  \brief Read the topology and choose the cpu of each worker.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param policy "compact" (fill a socket before the next), "scatter" (spread over the sockets) or
+ *         "none" (no pinning, only the throughput report)
+ *  \param nWorkers number of workers
+ */
+
+void initPlacement(const char* policy, int nWorkers)
+{
+	struct CpuTopology* cpus;
+	cpu_set_t allowed;
+	int nCpus = 0;
+
+	if (strcmp(policy, "compact") != 0 && strcmp(policy, "scatter") != 0 && strcmp(policy, "none") != 0)
+	{
+		fprintf(stderr, "invalid placement \"%s\" (compact, scatter or none)\n", policy);
+		exit(EXIT_FAILURE);
+	}
+
+	if (((placements = aligned_alloc(CACHE_LINE_SIZE, nWorkers * sizeof(struct WorkerPlacement))) == NULL) ||
+		((attributes = malloc(nWorkers * sizeof(pthread_attr_t))) == NULL) ||
+		((cpus = malloc(CPU_SETSIZE * sizeof(struct CpuTopology))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to the worker placement\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	memset(placements, 0, nWorkers * sizeof(struct WorkerPlacement));
+	totalWorkers = nWorkers;
+	policyName = policy;
+	placementOn = true;
+
+	for (int i = 0; i < nWorkers; i++)
+	{
+		placements[i].cpu = -1;
+		placements[i].node = -1;
+	}
+
+	if (strcmp(policy, "none") == 0)
+	{
+		free(cpus);
+		return;
+	}
+
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+	{
+		perror("error on reading the cpu affinity, the workers are not pinned");
+		free(cpus);
+		return;
+	}
+
+	/* package, core and node of every allowed cpu */
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		char path[128];
+
+		if (!CPU_ISSET(cpu, &allowed))
+			continue;
+
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+		cpus[nCpus].package = readNumber(path, 0);
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+		cpus[nCpus].core = readNumber(path, cpu);
+		cpus[nCpus].cpu = cpu;
+		cpus[nCpus].node = cpuNode(cpu);
+		nCpus++;
+	}
+
+	/* SMT sibling index within the core, and rank of the core within its package (cpus are in id order) */
+	for (int i = 0; i < nCpus; i++)
+	{
+		cpus[i].smt = 0;
+		cpus[i].coreRank = 0;
+		for (int j = 0; j < i; j++)
+			if (cpus[j].package == cpus[i].package && cpus[j].core == cpus[i].core)
+				cpus[i].smt++;
+		for (int j = 0; j < nCpus; j++)
+		{
+			bool firstOfCore = true;
+
+			if (cpus[j].package != cpus[i].package || cpus[j].core >= cpus[i].core)
+				continue;
+			for (int k = 0; k < j; k++)
+				if (cpus[k].package == cpus[j].package && cpus[k].core == cpus[j].core)
+					firstOfCore = false;
+			cpus[i].coreRank += firstOfCore;
+		}
+	}
+
+	qsort(cpus, nCpus, sizeof(struct CpuTopology), (strcmp(policy, "compact") == 0) ? compareCompact : compareScatter);
+
+	for (int i = 0; i < nWorkers && nCpus > 0; i++)
+	{
+		cpu_set_t one;
+
+		CPU_ZERO(&one);
+		CPU_SET(cpus[i % nCpus].cpu, &one);
+		if (pthread_attr_init(&attributes[i]) != 0 || pthread_attr_setaffinity_np(&attributes[i], sizeof(one), &one) != 0)
+		{
+			fprintf(stderr, "error on setting the worker affinity, the workers are not pinned\n");
+			free(cpus);
+			return;
+		}
+		placements[i].cpu = cpus[i % nCpus].cpu;
+		placements[i].node = cpus[i % nCpus].node;
+	}
+	pinned = (nCpus > 0);
+
+	free(cpus);
+}
+
+/**
+ *  \brief Thread attributes of a worker.
+ *
+ *  Operation carried out by main, when creating the workers.
+ *
+ *  \param workerId worker id
+ *
+ *  \return attributes pinning the worker to its cpu, NULL for the default ones
+ */
+
+pthread_attr_t* workerAttributes(int workerId)
+{
+	return pinned ? &attributes[workerId] : NULL;
+}
+
+/**
+ *  \brief Allocate a worker buffer on the NUMA node of the worker.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  Unpinned workers just get malloc memory. The node is only preferred, a full node falls back to
+ *  the others.
+ *
+ *  \param workerId worker id
+ *  \param size buffer size
+ *
+ *  \return buffer, NULL on failure
+ */
+
+void* allocLocal(int workerId, size_t size)
+{
+	if (!pinned)
+		return malloc(size);
+
+	void* buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	unsigned long nodeMask[4] = { 0 };
+	int node = placements[workerId].node;
+
+	if (buffer == MAP_FAILED)
+		return NULL;
+
+	if (node >= 0 && node < (int) (8 * sizeof(nodeMask)))
+	{
+		nodeMask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+		/* a kernel without NUMA support leaves the buffer wherever it is first touched */
+		(void) syscall(SYS_mbind, buffer, size, MPOL_PREFERRED_NODE, nodeMask, 8 * sizeof(nodeMask) + 1, 0);
+	}
+
+	return buffer;
+}
+
+/**
+ *  \brief Free a buffer allocated by allocLocal.
+ *
+ *  \param buffer buffer
+ *  \param size buffer size
+ */
+
+void freeLocal(void* buffer, size_t size)
+{
+	if (pinned)
+		munmap(buffer, size);
+	else
+		free(buffer);
+}
+
+/**
+ *  \brief Allocate a buffer shared by the workers, interleaved over their NUMA nodes.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  Without pinned workers, or with all of them on one node, it is plain malloc memory.
+ *
+ *  \param size buffer size
+ *
+ *  \return buffer, NULL on failure
+ */
+
+void* allocShared(size_t size)
+{
+	unsigned long nodeMask[4] = { 0 };
+	int nodes = 0;
+
+	for (int i = 0; pinned && i < totalWorkers; i++)
+	{
+		int node = placements[i].node;
+		unsigned long bit = 1UL << (node % (8 * sizeof(unsigned long)));
+
+		if (node < 0 || node >= (int) (8 * sizeof(nodeMask)) || (nodeMask[node / (8 * sizeof(unsigned long))] & bit))
+			continue;
+		nodeMask[node / (8 * sizeof(unsigned long))] |= bit;
+		nodes++;
+	}
+
+	if (nodes < 2)
+		return malloc(size);
+
+	void* buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (buffer == MAP_FAILED)
+		return NULL;
+
+	/* a kernel without NUMA support leaves the pages wherever they are first touched */
+	(void) syscall(SYS_mbind, buffer, size, MPOL_INTERLEAVE_NODES, nodeMask, 8 * sizeof(nodeMask) + 1, 0);
+
+	return buffer;
+}
+
+/**
+ *  \brief Start timing a worker.
+ *
+ *  Operation carried out by the workers, when they start.
+ *
+ *  \param workerId worker id
+ */
+
+void beginWork(int workerId)
+{
+	if (!placementOn)
+		return;
+
+	placements[workerId].wallTime = -clockSeconds(CLOCK_MONOTONIC);
+	placements[workerId].cpuTime = -clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+	if (placements[workerId].cpu < 0)
+		placements[workerId].cpu = sched_getcpu();
+}
+
+/**
+ *  \brief Count the work done by a worker.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param units work units (bytes, integers swept for the sorter)
+ */
+
+void recordWork(int workerId, long units)
+{
+	if (!placementOn)
+		return;
+
+	placements[workerId].units += units;
+}
+
+/**
+ *  \brief Stop timing a worker.
+ *
+ *  Operation carried out by the workers, when they end.
+ *
+ *  \param workerId worker id
+ */
+
+void endWork(int workerId)
+{
+	if (!placementOn)
+		return;
+
+	placements[workerId].wallTime += clockSeconds(CLOCK_MONOTONIC);
+	placements[workerId].cpuTime += clockSeconds(CLOCK_THREAD_CPUTIME_ID);
+	placements[workerId].lastCpu = sched_getcpu();
+}
+
+/**
+ *  \brief Print the cpu, the node and the throughput of each worker.
+ *
+ *  Operation carried out by main, after joining the workers.
+ *
+ *  The throughput over the wall time shows how long the worker waited or was preempted, the one over
+ *  its cpu time how fast it ran. An unpinned worker shows the cpu it started and ended on.
+ *
+ *  \param unit name of a million work units, "MB" or "Mi" (integers)
+ */
+
+void printPlacement(const char* unit)
+{
+	if (!placementOn)
+		return;
+
+	char wallRate[16], cpuRate[16];
+
+	snprintf(wallRate, sizeof(wallRate), "wall %s/s", unit);
+	snprintf(cpuRate, sizeof(cpuRate), "cpu %s/s", unit);
+	printf("\nWorker placement (%s)\n", policyName);
+	printf("%6s %9s %5s %10s %10s %10s %10s %10s\n", "worker", "cpu", "node", unit, "wall s", "cpu s", wallRate, cpuRate);
+	for (int i = 0; i < totalWorkers; i++)
+	{
+		struct WorkerPlacement* p = &placements[i];
+		char cpu[32];
+
+		if (pinned)
+			snprintf(cpu, sizeof(cpu), "%d", p->cpu);
+		else
+			snprintf(cpu, sizeof(cpu), "%d>%d", p->cpu, p->lastCpu);
+
+		printf("%6d %9s %5d %10.2f %10.4f %10.4f %10.1f %10.1f\n", i, cpu, pinned ? p->node : cpuNode(p->lastCpu), p->units / 1.0e6,
+			p->wallTime, p->cpuTime, (p->wallTime > 0) ? p->units / p->wallTime / 1.0e6 : 0.0,
+			(p->cpuTime > 0) ? p->units / p->cpuTime / 1.0e6 : 0.0);
+	}
+}
+
+/**
+ *  \brief Read a number from a sysfs file.
+ *
+ *  Auxiliar function.
+ *
+ *  \param path file path
+ *  \param fallback value when the file cannot be read
+ *
+ *  \return number
+ */
+
+static int readNumber(const char* path, int fallback)
+{
+	FILE* file = fopen(path, "r");
+	int value;
+
+	if (file == NULL)
+		return fallback;
+	if (fscanf(file, "%d", &value) != 1)
+		value = fallback;
+	fclose(file);
+
+	return value;
+}
+
+/**
+ *  \brief NUMA node of a cpu, from its nodeN link in sysfs.
+ *
+ *  Auxiliar function.
+ *
+ *  \param cpu cpu id
+ *
+ *  \return node id, 0 without NUMA information
+ */
+
+static int cpuNode(int cpu)
+{
+	char path[128];
+	struct dirent* entry;
+	DIR* dir;
+	int node = 0;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+	if (cpu < 0 || (dir = opendir(path)) == NULL)
+		return 0;
+
+	while ((entry = readdir(dir)) != NULL)
+		if (strncmp(entry->d_name, "node", 4) == 0 && sscanf(entry->d_name + 4, "%d", &node) == 1)
+			break;
+	closedir(dir);
+
+	return node;
+}
+
+/**
+ *  \brief Order the cpus for compact placement: physical cores first, a socket after the other.
+ *
+ *  Auxiliar function.
+ *
+ *  \param a first cpu
+ *  \param b second cpu
+ *
+ *  \return negative if the first cpu goes first
+ */
+
+static int compareCompact(const void* a, const void* b)
+{
+	const struct CpuTopology* x = a;
+	const struct CpuTopology* y = b;
+
+	if (x->smt != y->smt)
+		return x->smt - y->smt;
+	if (x->package != y->package)
+		return x->package - y->package;
+	if (x->coreRank != y->coreRank)
+		return x->coreRank - y->coreRank;
+	return x->cpu - y->cpu;
+}
+
+/**
+ *  \brief Order the cpus for scatter placement: physical cores first, a core of each socket in turn.
+ *
+ *  Auxiliar function.
+ *
+ *  \param a first cpu
+ *  \param b second cpu
+ *
+ *  \return negative if the first cpu goes first
+ */
+
+static int compareScatter(const void* a, const void* b)
+{
+	const struct CpuTopology* x = a;
+	const struct CpuTopology* y = b;
+
+	if (x->smt != y->smt)
+		return x->smt - y->smt;
+	if (x->coreRank != y->coreRank)
+		return x->coreRank - y->coreRank;
+	if (x->package != y->package)
+		return x->package - y->package;
+	return x->cpu - y->cpu;
+}
+
+/**
+ *  \brief Seconds of a clock.
+ *
+ *  Auxiliar function.
+ *
+ *  \param clock clock id
+ *
+ *  \return seconds
+ */
+
+static double clockSeconds(clockid_t clock)
+{
+	struct timespec t;
+
+	clock_gettime(clock, &t);
+	return (double) t.tv_sec + 1.0e-9 * (double) t.tv_nsec;
+}
@@ -0,0 +1,125 @@
+/**
+ *  \file placement.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Topology aware worker placement.
+ *
+ *  Optional pinning of the workers to cores read from /sys/devices/system/cpu, with their buffers on
+ *  the local NUMA node, and per worker throughput printed by main at exit:
+ *     \li initPlacement
+ *     \li workerAttributes
+ *     \li allocLocal
+ *     \li freeLocal
+ *     \li allocShared
+ *     \li beginWork
+ *     \li recordWork
+ *     \li endWork
+ *     \li printPlacement.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+/**
+ *  \brief Read the topology and choose the cpu of each worker.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param policy "compact" (fill a socket before the next), "scatter" (spread over the sockets) or
+ *         "none" (no pinning, only the throughput report)
+ *  \param nWorkers number of workers
+ */
+
+extern void initPlacement(const char* policy, int nWorkers);
+
+/**
+ *  \brief Thread attributes of a worker.
+ *
+ *  Operation carried out by main, when creating the workers.
+ *
+ *  \param workerId worker id
+ *
+ *  \return attributes pinning the worker to its cpu, NULL for the default ones
+ */
+
+extern pthread_attr_t* workerAttributes(int workerId);
+
+/**
+ *  \brief Allocate a worker buffer on the NUMA node of the worker.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param size buffer size
+ *
+ *  \return buffer, NULL on failure
+ */
+
+extern void* allocLocal(int workerId, size_t size);
+
+/**
+ *  \brief Free a buffer allocated by allocLocal.
+ *
+ *  \param buffer buffer
+ *  \param size buffer size
+ */
+
+extern void freeLocal(void* buffer, size_t size);
+
+/**
+ *  \brief Allocate a buffer shared by the workers, interleaved over their NUMA nodes.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param size buffer size
+ *
+ *  \return buffer, NULL on failure
+ */
+
+extern void* allocShared(size_t size);
+
+/**
+ *  \brief Start timing a worker.
+ *
+ *  Operation carried out by the workers, when they start.
+ *
+ *  \param workerId worker id
+ */
+
+extern void beginWork(int workerId);
+
+/**
+ *  \brief Count the work done by a worker.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param units work units (bytes, integers swept for the sorter)
+ */
+
+extern void recordWork(int workerId, long units);
+
+/**
+ *  \brief Stop timing a worker.
+ *
+ *  Operation carried out by the workers, when they end.
+ *
+ *  \param workerId worker id
+ */
+
+extern void endWork(int workerId);
+
+/**
+ *  \brief Print the cpu, the node and the throughput of each worker.
+ *
+ *  Operation carried out by main, after joining the workers.
+ *
+ *  \param unit name of a million work units, "MB" or "Mi" (integers)
+ */
+
+extern void printPlacement(const char* unit);
+
+#endif /* PLACEMENT_H */
@@ -0,0 +1,499 @@
+/**
+ *  \file resultCache.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Persistent result cache.
+ *
+ *  File results kept on disk between runs, keyed by the file identity (device, inode, size and
+ *  modification time), used by main only:
+ *     \li loadCache
+ *     \li lookupCache
+ *     \li resumeCache
+ *     \li storeCache
+ *     \li saveCache
+ *     \li hashFile.
+ *
+ *  The cache file is a magic string followed by the entries, it is loaded at once and indexed by
+ *  device and inode in an open addressing table. It is written to a temporary file which then
+ *  replaces the old one, so an interrupted run never leaves a torn cache.
+ *
+ *  A file modified within the timestamp granularity of its counting could change again without its
+ *  modification time changing, such racy entries also keep a content hash which is checked on every
+ *  hit.
+ *
+ *  Each entry also keeps the summary of the whole file with its last run and last char still open,
+ *  and a hash of its last bytes. A file that only grew can then be counted from its cached size on,
+ *  its new chunks being joined to that summary.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "consts.h"
+#include "resultCache.h"
+
+/** \brief main thread return status */
+extern int statusMain;
+
+/** \brief cache file magic string, changed whenever the entry layout changes */
+static const char cacheMagic[8] = "CWCACHE5";
+
+/** \brief entries modified less than these seconds before the run are racy */
+static const int racySeconds = 2;
+
+/** \brief cache file name, NULL if no cache was loaded */
+static const char* cachePath = NULL;
+
+/** \brief cache entries */
+static struct CacheEntry* entries = NULL;
+
+/** \brief number of cache entries */
+static int totalEntries = 0;
+
+/** \brief room for cache entries */
+static int entryCapacity = 0;
+
+/** \brief open addressing table of entry indexes, -1 for empty slots */
+static int* slots = NULL;
+
+/** \brief number of slots minus one, a power of two minus one */
+static int slotMask = -1;
+
+/** \brief start of the run, racy entries were modified close to it */
+static time_t runStart;
+
+/** \brief slot of a device and inode, empty or holding its entry */
+static int findSlot(unsigned long long device, unsigned long long inode);
+
+/** \brief add an entry, replacing the one of the same device and inode */
+static void addEntry(struct CacheEntry* entry);
+
+/** \brief grow the table when more than half full */
+static void growTable(void);
+
+/** \brief hash a range of bytes */
+static unsigned long long hashBytes(const unsigned char* bytes, long size, unsigned long long h);
+
+/** \brief hash of the bytes right before an offset of a file */
+static unsigned long long hashTail(const char* fileName, long offset);
+
+/**
+ *  \brief Load the cache file.
+ *
+ *  Operation carried out by main, before any other cache operation.
+ *
+ *  A missing cache file is an empty cache, an unreadable one is reported and replaced.
+ *
+ *  \param cacheFile cache file name
+ */
+
+void loadCache(const char* cacheFile)
+{
+	FILE* file;
+	char magic[sizeof(cacheMagic)];
+	struct stat fileStat;
+
+	cachePath = cacheFile;
+	runStart = time(NULL);
+	growTable();
+
+	if ((file = fopen(cacheFile, "r")) == NULL)
+		return;
+
+	if (fstat(fileno(file), &fileStat) == -1 || fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+		memcmp(magic, cacheMagic, sizeof(magic)) != 0 || (fileStat.st_size - sizeof(magic)) % sizeof(struct CacheEntry) != 0)
+	{
+		fprintf(stderr, "result cache \"%s\" is not valid, it will be replaced\n", cacheFile);
+		fclose(file);
+		return;
+	}
+
+	int count = (int) ((fileStat.st_size - sizeof(magic)) / sizeof(struct CacheEntry));
+	struct CacheEntry* loaded;
+
+	if ((loaded = malloc((count + 1) * sizeof(struct CacheEntry))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the result cache\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	if (fread(loaded, sizeof(struct CacheEntry), count, file) != (size_t) count)
+	{
+		fprintf(stderr, "result cache \"%s\" is not valid, it will be replaced\n", cacheFile);
+		count = 0;
+	}
+	fclose(file);
+
+	for (int i = 0; i < count; i++)
+		addEntry(&loaded[i]);
+	free(loaded);
+}
+
+/**
+ *  \brief Look up the results of a file.
+ *
+ *  Operation carried out by main.
+ *
+ *  The identity must match exactly. The content hash is checked when asked for and for racy entries,
+ *  it is computed on demand and handed back so that it is not computed twice.
+ *
+ *  \param fileStat file status
+ *  \param fileName file name, read when the content hash has to be checked
+ *  \param verify check the content hash of every hit
+ *  \param hash content hash, computed if still 0 and needed
+ *  \param result file result to fill on a hit
+ *
+ *  \return true on a hit
+ */
+
+bool lookupCache(struct stat* fileStat, const char* fileName, bool verify, unsigned long long* hash, struct FileResult* result)
+{
+	if (cachePath == NULL)
+		return false;
+
+	int slot = findSlot(fileStat->st_dev, fileStat->st_ino);
+
+	if (slots[slot] == -1)
+		return false;
+
+	struct CacheEntry* entry = &entries[slots[slot]];
+
+	if (entry->size != fileStat->st_size || entry->mtimeSec != fileStat->st_mtim.tv_sec ||
+		entry->mtimeNsec != fileStat->st_mtim.tv_nsec)
+		return false;
+
+	if (verify || entry->racy)
+	{
+		if (entry->hash == 0)
+			return false;
+		if (*hash == 0)
+			*hash = hashFile(fileName);
+		if (*hash != entry->hash)
+			return false;
+	}
+
+	result->nWords = entry->nWords;
+	for (int i = 0; i < 6; i++)
+		result->vowels[i] = entry->vowels[i];
+	result->invalid = entry->invalid;
+	for (int i = 0; i < INVALID_OFFSETS; i++)
+		result->invalidAt[i] = entry->invalidAt[i];
+
+	return true;
+}
+
+/**
+ *  \brief Find the state a grown file can be resumed from.
+ *
+ *  Operation carried out by main, for the files missed by lookupCache.
+ *
+ *  The file must be the same one (device and inode), at least as large as when it was cached, and
+ *  the bytes right before the cached size must be unchanged. A rotated or shrunk file is counted
+ *  from the start.
+ *
+ *  \param fileStat file status
+ *  \param fileName file name
+ *  \param offset offset to resume at
+ *  \param carry summary of the bytes before the offset
+ *
+ *  \return true if the file can be resumed
+ */
+
+bool resumeCache(struct stat* fileStat, const char* fileName, long* offset, struct ChunkSummary* carry)
+{
+	if (cachePath == NULL)
+		return false;
+
+	int slot = findSlot(fileStat->st_dev, fileStat->st_ino);
+
+	if (slots[slot] == -1)
+		return false;
+
+	struct CacheEntry* entry = &entries[slots[slot]];
+
+	if (entry->size == 0 || entry->size > fileStat->st_size || hashTail(fileName, entry->size) != entry->tailHash)
+		return false;
+
+	*offset = entry->size;
+	*carry = entry->carry;
+
+	return true;
+}
+
+/**
+ *  \brief Store the results of a file.
+ *
+ *  Operation carried out by main, after the file was counted.
+ *
+ *  \param fileStat file status taken before the file was counted
+ *  \param fileName file name, read when the content hash has to be computed
+ *  \param hash content hash, 0 if not computed
+ *  \param result file result
+ *  \param carry summary of the whole file, its edges still open
+ */
+
+void storeCache(struct stat* fileStat, const char* fileName, unsigned long long hash, struct FileResult* result,
+	struct ChunkSummary* carry)
+{
+	if (cachePath == NULL)
+		return;
+
+	struct CacheEntry entry;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.device = fileStat->st_dev;
+	entry.inode = fileStat->st_ino;
+	entry.size = fileStat->st_size;
+	entry.mtimeSec = fileStat->st_mtim.tv_sec;
+	entry.mtimeNsec = fileStat->st_mtim.tv_nsec;
+	entry.racy = (fileStat->st_mtim.tv_sec >= runStart - racySeconds);
+	entry.hash = (hash == 0 && entry.racy) ? hashFile(fileName) : hash;
+	entry.nWords = result->nWords;
+	for (int i = 0; i < 6; i++)
+		entry.vowels[i] = result->vowels[i];
+	entry.invalid = result->invalid;
+	for (int i = 0; i < INVALID_OFFSETS; i++)
+		entry.invalidAt[i] = result->invalidAt[i];
+	entry.tailHash = hashTail(fileName, fileStat->st_size);
+	entry.carry = *carry;
+
+	addEntry(&entry);
+}
+
+/**
+ *  \brief Write the cache file.
+ *
+ *  Operation carried out by main, once every result was stored.
+ *
+ *  A cache that cannot be written is reported, the results of the run are still valid.
+ */
+
+void saveCache(void)
+{
+	if (cachePath == NULL)
+		return;
+
+	char tmpPath[4096];
+	FILE* file;
+
+	snprintf(tmpPath, sizeof(tmpPath), "%s.%d.tmp", cachePath, (int) getpid());
+	if ((file = fopen(tmpPath, "w")) == NULL)
+	{
+		fprintf(stderr, "error on writing result cache \"%s\"\n", cachePath);
+		return;
+	}
+
+	bool written = fwrite(cacheMagic, 1, sizeof(cacheMagic), file) == sizeof(cacheMagic) &&
+		fwrite(entries, sizeof(struct CacheEntry), totalEntries, file) == (size_t) totalEntries;
+
+	if (fclose(file) == EOF || !written || rename(tmpPath, cachePath) == -1)
+	{
+		fprintf(stderr, "error on writing result cache \"%s\"\n", cachePath);
+		unlink(tmpPath);
+	}
+}
+
+/**
+ *  \brief Fast content hash of a file.
+ *
+ *  Operation carried out by main.
+ *
+ *  The file is mapped and hashed 8 bytes at a time with a multiply and xor shift mix, which runs at
+ *  memory speed, far faster than counting the words.
+ *
+ *  \param fileName file name
+ *
+ *  \return 64 bit hash, never 0
+ */
+
+unsigned long long hashFile(const char* fileName)
+{
+	int fd;
+	struct stat fileStat;
+
+	if ((fd = open(fileName, O_RDONLY)) == -1 || fstat(fd, &fileStat) == -1)
+	{
+		fprintf(stderr, "error on opening text file \"%s\"\n", fileName);
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	unsigned long long h = 0x243F6A8885A308D3ULL ^ (unsigned long long) fileStat.st_size;
+	long size = fileStat.st_size;
+
+	if (size > 0)
+	{
+		unsigned char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (map == MAP_FAILED)
+		{
+			fprintf(stderr, "error on mapping text file \"%s\"\n", fileName);
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		(void) madvise(map, size, MADV_SEQUENTIAL);
+		h = hashBytes(map, size, h);
+		munmap(map, size);
+	}
+	close(fd);
+
+	return (h == 0) ? 1 : h;
+}
+
+/**
+ *  \brief Hash a range of bytes, 8 at a time with a multiply and xor shift mix.
+ *
+ *  Auxiliar function.
+ *
+ *  \param bytes bytes to hash
+ *  \param size number of bytes
+ *  \param h starting hash
+ *
+ *  \return hash
+ */
+
+static unsigned long long hashBytes(const unsigned char* bytes, long size, unsigned long long h)
+{
+	long i;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		unsigned long long w;
+
+		memcpy(&w, bytes + i, 8);
+		h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+		h ^= h >> 32;
+	}
+
+	unsigned long long w = 0;
+	memcpy(&w, bytes + i, size - i);
+	h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+	h ^= h >> 29;
+
+	return h;
+}
+
+/**
+ *  \brief Hash of the bytes right before an offset of a file.
+ *
+ *  Auxiliar function.
+ *
+ *  Up to TAIL_HASH_BYTES are read, a file that cannot be read has no valid tail.
+ *
+ *  \param fileName file name
+ *  \param offset end of the hashed bytes
+ *
+ *  \return hash, 0 if the bytes could not be read
+ */
+
+static unsigned long long hashTail(const char* fileName, long offset)
+{
+	unsigned char bytes[TAIL_HASH_BYTES];
+	long size = (offset < TAIL_HASH_BYTES) ? offset : TAIL_HASH_BYTES;
+	int fd;
+
+	if ((fd = open(fileName, O_RDONLY)) == -1)
+		return 0;
+
+	bool read = (pread(fd, bytes, size, offset - size) == size);
+
+	close(fd);
+	if (!read)
+		return 0;
+
+	unsigned long long h = hashBytes(bytes, size, 0x13198A2E03707344ULL ^ (unsigned long long) offset);
+
+	return (h == 0) ? 1 : h;
+}
+
+/**
+ *  \brief Slot of a device and inode, empty or holding its entry.
+ *
+ *  Auxiliar function.
+ *
+ *  \param device device number
+ *  \param inode inode number
+ *
+ *  \return slot index
+ */
+
+static int findSlot(unsigned long long device, unsigned long long inode)
+{
+	unsigned long long key = (inode * 0x9E3779B97F4A7C15ULL) ^ (device * 0xC2B2AE3D27D4EB4FULL);
+	int slot = (int) ((key ^ (key >> 29)) & slotMask);
+
+	while (slots[slot] != -1 && (entries[slots[slot]].device != device || entries[slots[slot]].inode != inode))
+		slot = (slot + 1) & slotMask;
+
+	return slot;
+}
+
+/**
+ *  \brief Add an entry, replacing the one of the same device and inode.
+ *
+ *  Auxiliar function.
+ *
+ *  \param entry cache entry
+ */
+
+static void addEntry(struct CacheEntry* entry)
+{
+	int slot = findSlot(entry->device, entry->inode);
+
+	if (slots[slot] != -1)
+	{
+		entries[slots[slot]] = *entry;
+		return;
+	}
+
+	if (totalEntries == entryCapacity)
+	{
+		entryCapacity = (entryCapacity == 0) ? 1024 : 2 * entryCapacity;
+		if ((entries = realloc(entries, entryCapacity * sizeof(struct CacheEntry))) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the result cache\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+	}
+	entries[totalEntries] = *entry;
+	slots[slot] = totalEntries++;
+
+	if (2 * totalEntries > slotMask)
+		growTable();
+}
+
+/**
+ *  \brief Grow the table when more than half full (or create it).
+ *
+ *  Auxiliar function.
+ */
+
+static void growTable(void)
+{
+	int nSlots = (slotMask < 0) ? 4096 : 2 * (slotMask + 1);
+
+	free(slots);
+	if ((slots = malloc(nSlots * sizeof(int))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the result cache\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	memset(slots, -1, nSlots * sizeof(int));
+	slotMask = nSlots - 1;
+
+	for (int i = 0; i < totalEntries; i++)
+		slots[findSlot(entries[i].device, entries[i].inode)] = i;
+}
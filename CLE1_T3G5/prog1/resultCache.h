@@ -0,0 +1,101 @@
+/**
+ *  \file resultCache.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Persistent result cache.
+ *
+ *  File results kept on disk between runs, keyed by the file identity (device, inode, size and
+ *  modification time), used by main only:
+ *     \li loadCache
+ *     \li lookupCache
+ *     \li resumeCache
+ *     \li storeCache
+ *     \li saveCache
+ *     \li hashFile.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+/**
+ *  \brief Load the cache file.
+ *
+ *  Operation carried out by main, before any other cache operation.
+ *
+ *  A missing cache file is an empty cache, an unreadable one is reported and replaced.
+ *
+ *  \param cacheFile cache file name
+ */
+
+extern void loadCache(const char* cacheFile);
+
+/**
+ *  \brief Look up the results of a file.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param fileStat file status
+ *  \param fileName file name, read when the content hash has to be checked
+ *  \param verify check the content hash of every hit
+ *  \param hash content hash, computed if still 0 and needed
+ *  \param result file result to fill on a hit
+ *
+ *  \return true on a hit
+ */
+
+extern bool lookupCache(struct stat* fileStat, const char* fileName, bool verify, unsigned long long* hash, struct FileResult* result);
+
+/**
+ *  \brief Find the state a grown file can be resumed from.
+ *
+ *  Operation carried out by main, for the files missed by lookupCache.
+ *
+ *  \param fileStat file status
+ *  \param fileName file name
+ *  \param offset offset to resume at
+ *  \param carry summary of the bytes before the offset
+ *
+ *  \return true if the file can be resumed
+ */
+
+extern bool resumeCache(struct stat* fileStat, const char* fileName, long* offset, struct ChunkSummary* carry);
+
+/**
+ *  \brief Store the results of a file.
+ *
+ *  Operation carried out by main, after the file was counted.
+ *
+ *  \param fileStat file status taken before the file was counted
+ *  \param fileName file name, read when the content hash has to be computed
+ *  \param hash content hash, 0 if not computed
+ *  \param result file result
+ *  \param carry summary of the whole file, its edges still open
+ */
+
+extern void storeCache(struct stat* fileStat, const char* fileName, unsigned long long hash, struct FileResult* result,
+	struct ChunkSummary* carry);
+
+/**
+ *  \brief Write the cache file.
+ *
+ *  Operation carried out by main, once every result was stored.
+ */
+
+extern void saveCache(void);
+
+/**
+ *  \brief Fast content hash of a file.
+ *
+ *  Operation carried out by main.
+ *
+ *  \param fileName file name
+ *
+ *  \return 64 bit hash, never 0
+ */
+
+extern unsigned long long hashFile(const char* fileName);
+
+#endif /* RESULTCACHE_H */
@@ -0,0 +1,897 @@
+/**
+ *  \file server.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Word count server.
+ *
+ *  Jobs (lists of file paths) received over a Unix domain socket and counted by a pool of workers
+ *  kept alive between them, and the client that sends a job:
+ *     \li initServer
+ *     \li acceptJobs
+ *     \li serveChunks
+ *     \li submitJob.
+ *
+ *  Main polls the listening socket together with the clients whose requests are still coming (one
+ *  path per line, up to the end of the client writes), so a slow client holds back no other one.
+ *  Once a request is complete, main opens its files and queues the job. The jobs form a ring, and
+ *  the workers take one chunk from each job in turn, so a large job does not hold back the small
+ *  ones sent after it. The files are read at offsets outside the monitor, and the worker that posts
+ *  the last chunk of a job joins its chunk edges and writes the results back to the client, which
+ *  has JOB_REPLY_TIMEOUT seconds to take them.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "consts.h"
+#include "textKernel.h"
+#include "server.h"
+#include "placement.h"
+
+/** \brief worker threads return status array */
+extern int *statusWorkers;
+
+/** \brief main thread return status */
+extern int statusMain;
+
+/** \brief locking flag which warrants mutual exclusion inside the monitor */
+static pthread_mutex_t accessJobs = PTHREAD_MUTEX_INITIALIZER;
+
+/** \brief workers synchronization point when there is no chunk to count */
+static pthread_cond_t waitJobs = PTHREAD_COND_INITIALIZER;
+
+/** \brief next job a chunk is taken from, NULL when no job has chunks left */
+static struct ServerJob* turn = NULL;
+
+/** \brief the server is closing, the workers leave once the ring is empty */
+static bool closing = false;
+
+/** \brief listening socket */
+static int listener = -1;
+
+/** \brief path of the listening socket */
+static const char* serverPath = NULL;
+
+/** \brief chunk size of the jobs */
+static int jobChunkSize = SERVER_CHUNK_SIZE;
+
+/** \brief the malformed utf-8 sequences of each file are reported */
+static bool reportInvalid = false;
+
+/** \brief SIGINT or SIGTERM was received */
+static volatile sig_atomic_t stopServer = 0;
+
+/** \brief ask the server to stop */
+static void stopHandler(int signal);
+
+/** \brief start the job of a client just accepted */
+static struct ServerJob* createJob(int client);
+
+/** \brief read the request bytes a client has sent */
+static int receiveRequest(struct ServerJob* job);
+
+/** \brief refuse a request that was not received and free its job */
+static void rejectJob(struct ServerJob* job);
+
+/** \brief split the request of a job into paths and open its files */
+static void openJobFiles(struct ServerJob* job);
+
+/** \brief add a job to the ring */
+static void queueJob(struct ServerJob* job);
+
+/** \brief take the next chunk of the ring */
+static bool takeServerChunk(int workerId, struct ServerChunk* chunk);
+
+/** \brief post the edges and results of a chunk */
+static bool postServerChunk(int workerId, struct ServerChunk* chunk, struct ChunkSummary* summary, bool failed);
+
+/** \brief join the chunks of a job, write its results to the client and free it */
+static void finishJob(int workerId, struct ServerJob* job);
+
+/** \brief write the results of a job to its client */
+static void sendReply(int client, char* reply, size_t size);
+
+/** \brief seconds elapsed since an instant */
+static double elapsedSince(struct timespec* t0);
+
+/**
+ *  \brief Open the server socket.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param socketPath path of the Unix domain socket, a stale socket there is replaced
+ *  \param chunkSize chunk size of the jobs, 0 for the default
+ *  \param checkUtf8 report the malformed utf-8 sequences of each file
+ */
+
+void initServer(const char* socketPath, int chunkSize, bool checkUtf8)
+{
+	struct sockaddr_un address;
+	struct sigaction action;
+	struct stat socketStat;
+
+	if (chunkSize > 0)
+		jobChunkSize = chunkSize;
+	reportInvalid = checkUtf8;
+	serverPath = socketPath;
+
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "socket path \"%s\" is too long\n", socketPath);
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+
+	/* a socket left by a server that did not close is replaced, a live one or any other file is kept */
+	if (stat(socketPath, &socketStat) == 0 && S_ISSOCK(socketStat.st_mode))
+	{
+		int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		if (probe >= 0 && connect(probe, (struct sockaddr*) &address, sizeof(address)) == 0)
+		{
+			fprintf(stderr, "a server is already serving jobs on %s\n", socketPath);
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		if (probe >= 0)
+			close(probe);
+		unlink(socketPath);
+	}
+
+	if ((listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 ||
+		bind(listener, (struct sockaddr*) &address, sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+	{
+		perror("error on opening the server socket");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	/* a client that goes away only fails its own writes */
+	signal(SIGPIPE, SIG_IGN);
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopHandler;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	printf("Serving jobs on %s, chunks of %d bytes\n", socketPath, jobChunkSize);
+	fflush(stdout);
+}
+
+/**
+ *  \brief Accept the jobs of the clients and hand them to the workers.
+ *
+ *  Operation carried out by main, until SIGINT or SIGTERM.
+ *
+ *  The listening socket and the clients still sending their requests are polled together, each
+ *  client is only read when it has bytes ready, so a slow or silent client delays no other request,
+ *  and a stop request is noticed between them. On a stop, the jobs already queued are still counted
+ *  and the requests not complete yet are refused.
+ *
+ *  \return number of jobs served
+ */
+
+long acceptJobs(void)
+{
+	struct ServerJob** pending;										/* jobs whose request is still coming */
+	struct pollfd* polled;											/* the listening socket, then the pending clients */
+	int maxPending = 16, nPending = 0;
+	long jobs = 0;
+
+	if ((pending = malloc(maxPending * sizeof(struct ServerJob*))) == NULL ||
+		(polled = malloc((maxPending + 1) * sizeof(struct pollfd))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the pending jobs\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	while (!stopServer)
+	{
+		polled[0].fd = listener;
+		polled[0].events = POLLIN;
+		for (int i = 0; i < nPending; i++)
+		{
+			polled[i + 1].fd = pending[i]->client;
+			polled[i + 1].events = POLLIN;
+		}
+
+		if (poll(polled, nPending + 1, 500) < 0)
+			continue;
+
+		/* the complete requests are queued, the failed or late ones refused, the others keep waiting */
+		int kept = 0;
+
+		for (int i = 0; i < nPending; i++)
+		{
+			struct ServerJob* job = pending[i];
+			int status = (polled[i + 1].revents != 0) ? receiveRequest(job) : 0;
+
+			if (status == 0 && elapsedSince(&job->start) > JOB_REQUEST_TIMEOUT)
+				status = -1;
+
+			if (status == 0)
+				pending[kept++] = job;
+			else if (status < 0)
+				rejectJob(job);
+			else
+			{
+				openJobFiles(job);
+				queueJob(job);
+				jobs++;
+			}
+		}
+		nPending = kept;
+
+		if ((polled[0].revents & POLLIN) == 0)
+			continue;
+
+		int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+		if (client < 0)
+			continue;
+
+		if (nPending == maxPending)
+		{
+			maxPending *= 2;
+			if ((pending = realloc(pending, maxPending * sizeof(struct ServerJob*))) == NULL ||
+				(polled = realloc(polled, (maxPending + 1) * sizeof(struct pollfd))) == NULL)
+			{
+				fprintf(stderr, "error on allocating space to the pending jobs\n");
+				statusMain = EXIT_FAILURE;
+				pthread_exit(&statusMain);
+			}
+		}
+		pending[nPending++] = createJob(client);
+	}
+
+	for (int i = 0; i < nPending; i++)
+		rejectJob(pending[i]);
+	free(polled);
+	free(pending);
+
+	if ((statusMain = pthread_mutex_lock (&accessJobs)) != 0)						/* enter monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	closing = true;
+	if ((statusMain = pthread_cond_broadcast (&waitJobs)) != 0)
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on broadcasting waitJobs");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	if ((statusMain = pthread_mutex_unlock (&accessJobs)) != 0)					/* exit monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	close(listener);
+	unlink(serverPath);
+
+	return jobs;
+}
+
+/**
+ *  \brief Count the chunks of the jobs, sending the results of each job once its last chunk is counted.
+ *
+ *  Operation carried out by the workers, until the server closes and no job is left.
+ *
+ *  \param workerId worker id
+ */
+
+void serveChunks(int workerId)
+{
+	struct ServerChunk chunk;
+	unsigned char* buffer;
+
+	if ((buffer = allocLocal(workerId, jobChunkSize)) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the worker buffer\n");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+
+	while (takeServerChunk(workerId, &chunk))
+	{
+		/* a job without chunks (empty or missing files only) is just answered */
+		if (chunk.chunkId < 0)
+		{
+			finishJob(workerId, chunk.job);
+			continue;
+		}
+
+		struct ChunkSummary summary;
+		int fd = chunk.job->fds[chunk.fileId];
+		int size = 0;
+		ssize_t n = 1;
+
+		/* a file that shrank since it was opened just gives shorter chunks */
+		while (size < chunk.chunkSize && (n = pread(fd, buffer + size, chunk.chunkSize - size, chunk.offset + size)) > 0)
+			size += n;
+
+		summary = processChunk(buffer, size);
+		recordWork(workerId, size);
+
+		if (postServerChunk(workerId, &chunk, &summary, n < 0))
+			finishJob(workerId, chunk.job);
+	}
+
+	freeLocal(buffer, jobChunkSize);
+}
+
+/**
+ *  \brief Send a job to the server and print its results.
+ *
+ *  Operation carried out by main, in client mode.
+ *
+ *  \param socketPath path of the server socket
+ *  \param fileNames null terminated array of file names, sent as absolute paths
+ *
+ *  \return true if the results were received
+ */
+
+bool submitJob(const char* socketPath, char** fileNames)
+{
+	struct sockaddr_un address;
+	char path[PATH_MAX];
+	char response[4096];
+	ssize_t n;
+	int server;
+
+	if (strlen(socketPath) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "socket path \"%s\" is too long\n", socketPath);
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+
+	if ((server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 || connect(server, (struct sockaddr*) &address, sizeof(address)) != 0)
+	{
+		perror("error on connecting to the server");
+		return false;
+	}
+
+	/* the server has its own working directory */
+	for (int i = 0; fileNames[i] != NULL; i++)
+	{
+		const char* name = (realpath(fileNames[i], path) != NULL) ? path : fileNames[i];
+
+		if (dprintf(server, "%s\n", name) < 0)
+		{
+			perror("error on sending the job");
+			close(server);
+			return false;
+		}
+	}
+	shutdown(server, SHUT_WR);
+
+	while ((n = read(server, response, sizeof(response))) > 0)
+		fwrite(response, 1, n, stdout);
+
+	close(server);
+
+	if (n < 0)
+	{
+		perror("error on receiving the job results");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ *  \brief Ask the server to stop.
+ *
+ *  Auxiliar function, the SIGINT and SIGTERM handler.
+ *
+ *  \param signal signal number
+ */
+
+static void stopHandler(int signal)
+{
+	(void) signal;
+	stopServer = 1;
+}
+
+/**
+ *  \brief Start the job of a client just accepted.
+ *
+ *  Auxiliar function, carried out by main.
+ *
+ *  The job time starts here, so the results report the time the client waited for them.
+ *
+ *  \param client client socket, non blocking
+ *
+ *  \return job, with an empty request
+ */
+
+static struct ServerJob* createJob(int client)
+{
+	struct ServerJob* job;
+
+	if ((job = calloc(1, sizeof(struct ServerJob))) == NULL || (job->request = malloc(MAX_JOB_REQUEST + 1)) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to a job\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &job->start);
+	job->client = client;
+
+	return job;
+}
+
+/**
+ *  \brief Read the request bytes a client has sent.
+ *
+ *  Auxiliar function, carried out by main when the client socket is ready.
+ *
+ *  Reads until the socket would block, so no other client waits on this one.
+ *
+ *  \param job job of the client
+ *
+ *  \return 1 if the whole request was received, 0 if more is coming, -1 on an error or a request too large
+ */
+
+static int receiveRequest(struct ServerJob* job)
+{
+	ssize_t n = -1;
+
+	while (job->requestLen < MAX_JOB_REQUEST &&
+		   (n = read(job->client, job->request + job->requestLen, MAX_JOB_REQUEST - job->requestLen)) > 0)
+		job->requestLen += n;
+
+	if (job->requestLen == MAX_JOB_REQUEST)
+		return -1;
+	if (n == 0)
+		return 1;
+
+	return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+}
+
+/**
+ *  \brief Refuse a request that was not received and free its job.
+ *
+ *  Auxiliar function, carried out by main.
+ *
+ *  \param job job whose request failed, was too large or came too late
+ */
+
+static void rejectJob(struct ServerJob* job)
+{
+	/* a single short line, the non blocking socket drops it rather than wait for the client */
+	dprintf(job->client, "error on receiving the job request (at most %d bytes, within %d s)\n", MAX_JOB_REQUEST, JOB_REQUEST_TIMEOUT);
+	close(job->client);
+	free(job->request);
+	free(job);
+}
+
+/**
+ *  \brief Split the request of a job into paths and open its files.
+ *
+ *  Auxiliar function, carried out by main once the client closed its side of the socket.
+ *
+ *  The files that cannot be opened are reported in the results.
+ *
+ *  \param job job whose request was received
+ */
+
+static void openJobFiles(struct ServerJob* job)
+{
+	int len = job->requestLen;
+
+	job->request[len] = '\0';
+
+	/* one path per line, the empty lines are skipped */
+	for (int i = 0; i < len; i++)
+		if (job->request[i] != '\n' && (i == 0 || job->request[i - 1] == '\n'))
+			job->totalFiles++;
+
+	int nFiles = job->totalFiles;
+
+	if (((job->fileNames = malloc((nFiles + 1) * sizeof(char*))) == NULL) ||
+		((job->fds = malloc((nFiles + 1) * sizeof(int))) == NULL) ||
+		((job->fileSizes = calloc(nFiles + 1, sizeof(long))) == NULL) ||
+		((job->failed = calloc(nFiles + 1, sizeof(bool))) == NULL) ||
+		((job->results = calloc(nFiles + 1, sizeof(struct FileResult))) == NULL) ||
+		((job->firstChunk = malloc((nFiles + 1) * sizeof(int))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to a job\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	char* name = strtok(job->request, "\n");
+	int totalChunks = 0;
+
+	for (int i = 0; i < nFiles; i++, name = strtok(NULL, "\n"))
+	{
+		struct stat fileStat;
+
+		job->fileNames[i] = job->results[i].fileName = name;
+		job->firstChunk[i] = totalChunks;
+
+		if ((job->fds[i] = open(name, O_RDONLY | O_CLOEXEC)) >= 0 && (fstat(job->fds[i], &fileStat) != 0 || !S_ISREG(fileStat.st_mode)))
+		{
+			close(job->fds[i]);
+			job->fds[i] = -1;
+		}
+		if (job->fds[i] < 0)
+		{
+			job->failed[i] = true;
+			continue;
+		}
+
+		job->fileSizes[i] = fileStat.st_size;
+		totalChunks += (fileStat.st_size + jobChunkSize - 1) / jobChunkSize;
+	}
+	job->firstChunk[nFiles] = totalChunks;
+	job->pendingChunks = totalChunks;
+
+	if ((job->chunkEdges = malloc((totalChunks + 1) * sizeof(struct ChunkEdges))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the job chunk edges\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Add a job to the ring.
+ *
+ *  Operation carried out by main.
+ *
+ *  The job goes right before the turn, so every other job gets a chunk before it does.
+ *
+ *  \param job job to count, or only to answer when it has no chunks
+ */
+
+static void queueJob(struct ServerJob* job)
+{
+	if ((statusMain = pthread_mutex_lock (&accessJobs)) != 0)						/* enter monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	if (turn == NULL)
+	{
+		job->next = job->prev = job;
+		turn = job;
+	}
+	else
+	{
+		job->next = turn;
+		job->prev = turn->prev;
+		turn->prev->next = job;
+		turn->prev = job;
+	}
+
+	if ((statusMain = pthread_cond_broadcast (&waitJobs)) != 0)
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on broadcasting waitJobs");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+
+	if ((statusMain = pthread_mutex_unlock (&accessJobs)) != 0)					/* exit monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Take the next chunk of the ring.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  Waits until a job is queued. The chunk is taken from the job at the turn, which then passes to
+ *  the next job; a job leaves the ring once its last chunk is taken. A job without chunks leaves it
+ *  right away, handed out as a chunk with a negative id.
+ *
+ *  \param workerId worker id
+ *  \param chunk chunk to count
+ *
+ *  \return false if the server closed and no job is left
+ */
+
+static bool takeServerChunk(int workerId, struct ServerChunk* chunk)
+{
+	if ((statusWorkers[workerId] = pthread_mutex_lock (&accessJobs)) != 0)			/* enter monitor */
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+
+	while (turn == NULL && !closing)
+	{
+		if ((statusWorkers[workerId] = pthread_cond_wait(&waitJobs, &accessJobs)) != 0)
+		{
+			errno = statusWorkers[workerId];										/* save error in errno */
+			perror("error on waiting in waitJobs");
+			statusWorkers[workerId] = EXIT_FAILURE;
+			pthread_exit(&statusWorkers[workerId]);
+		}
+	}
+
+	struct ServerJob* job = turn;
+
+	if (job != NULL)
+	{
+		chunk->job = job;
+		chunk->chunkId = -1;
+
+		if (job->nextChunk < job->firstChunk[job->totalFiles])
+		{
+			while (job->nextChunk >= job->firstChunk[job->chunkFile + 1])
+				job->chunkFile++;
+
+			long fileOffset = (long) (job->nextChunk - job->firstChunk[job->chunkFile]) * jobChunkSize;
+			long fileLeft = job->fileSizes[job->chunkFile] - fileOffset;
+
+			chunk->fileId = job->chunkFile;
+			chunk->chunkId = job->nextChunk++;
+			chunk->offset = fileOffset;
+			chunk->chunkSize = (fileLeft < jobChunkSize) ? (int) fileLeft : jobChunkSize;
+		}
+
+		/* the job leaves the ring with its last chunk */
+		if (job->nextChunk == job->firstChunk[job->totalFiles])
+		{
+			if (job->next == job)
+				turn = NULL;
+			else
+			{
+				job->prev->next = job->next;
+				job->next->prev = job->prev;
+				turn = job->next;
+			}
+		}
+		else
+			turn = job->next;
+	}
+
+	if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessJobs)) != 0)		/* exit monitor */
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+
+	return job != NULL;
+}
+
+/**
+ *  \brief Post the edges and results of a chunk.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  \param workerId worker id
+ *  \param chunk chunk counted
+ *  \param summary chunk summary
+ *  \param failed the chunk could not be read
+ *
+ *  \return true if it was the last chunk of its job, which now belongs to the worker
+ */
+
+static bool postServerChunk(int workerId, struct ServerChunk* chunk, struct ChunkSummary* summary, bool failed)
+{
+	struct ServerJob* job = chunk->job;
+	struct FileResult* result = &job->results[chunk->fileId];
+
+	if ((statusWorkers[workerId] = pthread_mutex_lock (&accessJobs)) != 0)			/* enter monitor */
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+
+	result->nWords += summary->nWords;
+	for (int i = 0; i < 6; i++)
+		result->vowels[i] += summary->vowels[i];
+	job->chunkEdges[chunk->chunkId] = summary->edges;
+	job->failed[chunk->fileId] |= failed;
+
+	bool last = (--job->pendingChunks == 0);
+
+	if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessJobs)) != 0)		/* exit monitor */
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+
+	return last;
+}
+
+/**
+ *  \brief Join the chunks of a job, write its results to the client and free it.
+ *
+ *  Auxiliar function, carried out by the worker that posted the last chunk of the job, or took it
+ *  when it has none.
+ *
+ *  The results have the same layout as the ones printed by main when counting the given files. They
+ *  are put together in memory and sent at once, so a client that does not read them holds the
+ *  worker for JOB_REPLY_TIMEOUT seconds at most.
+ *
+ *  \param workerId worker id
+ *  \param job job whose chunks were all counted
+ */
+
+static void finishJob(int workerId, struct ServerJob* job)
+{
+	long totalBytes = 0;
+	char* reply = NULL;
+	size_t replySize = 0;
+	FILE* out;
+
+	if ((out = open_memstream(&reply, &replySize)) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the job results\n");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+
+	for (int i = 0; i < job->totalFiles; i++)
+	{
+		struct FileResult* result = &job->results[i];
+		struct ChunkSummary summary;
+		long* vowels = result->vowels;
+
+		fprintf(out, "File name: %s\n", result->fileName);
+
+		if (job->fds[i] < 0)
+		{
+			fprintf(out, "error on opening the file (or not a regular file)\n\n");
+			continue;
+		}
+		if (job->failed[i])
+		{
+			fprintf(out, "error on reading the file\n\n");
+			close(job->fds[i]);
+			continue;
+		}
+
+		memset(&summary, 0, sizeof(struct ChunkSummary));
+		for (int j = job->firstChunk[i]; j < job->firstChunk[i + 1]; j++)
+			joinEdges(&summary, &job->chunkEdges[j]);
+		addSummary(result, &summary);
+
+		if (reportInvalid)
+		{
+			fprintf(out, "Malformed utf-8 sequences = %ld", result->invalid);
+			for (int j = 0; j < result->invalid && j < INVALID_OFFSETS; j++)
+				fprintf(out, "%s%ld", (j == 0) ? ", first at bytes " : " ", result->invalidAt[j]);
+			fprintf(out, "\n");
+		}
+		fprintf(out, "Total number of words = %ld\n", result->nWords);
+		fprintf(out, "Number of words with an\n");
+		fprintf(out, "\tA\tE\tI\tO\tU\tY\n");
+		fprintf(out, "\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
+
+		totalBytes += job->fileSizes[i];
+		close(job->fds[i]);
+	}
+
+	fprintf(out, "Job files = %d, %ld bytes, %.6f s\n", job->totalFiles, totalBytes, elapsedSince(&job->start));
+	fclose(out);
+
+	sendReply(job->client, reply, replySize);
+	close(job->client);
+	free(reply);
+
+	free(job->chunkEdges);
+	free(job->firstChunk);
+	free(job->results);
+	free(job->failed);
+	free(job->fileSizes);
+	free(job->fds);
+	free(job->fileNames);
+	free(job->request);
+	free(job);
+}
+
+/**
+ *  \brief Write the results of a job to its client.
+ *
+ *  Auxiliar function.
+ *
+ *  The client socket does not block, whatever does not fit in it is sent as the client makes room,
+ *  until JOB_REPLY_TIMEOUT seconds have passed; the rest is then dropped.
+ *
+ *  \param client client socket, non blocking
+ *  \param reply job results
+ *  \param size bytes of the results
+ */
+
+static void sendReply(int client, char* reply, size_t size)
+{
+	struct pollfd writable = { .fd = client, .events = POLLOUT };
+	struct timespec t0;
+	size_t sent = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	while (sent < size)
+	{
+		ssize_t n = send(client, reply + sent, size - sent, MSG_NOSIGNAL);
+
+		if (n > 0)
+		{
+			sent += n;
+			continue;
+		}
+		if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			return;
+
+		int left = (int) (1000.0 * (JOB_REPLY_TIMEOUT - elapsedSince(&t0)));
+
+		if (left <= 0 || (poll(&writable, 1, left) < 0 && errno != EINTR))
+			return;
+	}
+}
+
+/**
+ *  \brief Seconds elapsed since an instant.
+ *
+ *  Auxiliar function.
+ *
+ *  \param t0 instant (CLOCK_MONOTONIC)
+ *
+ *  \return elapsed seconds
+ */
+
+static double elapsedSince(struct timespec* t0)
+{
+	struct timespec t1;
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (double) (t1.tv_sec - t0->tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0->tv_nsec);
+}
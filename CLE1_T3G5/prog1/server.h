@@ -0,0 +1,66 @@
+/**
+ *  \file server.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Word count server.
+ *
+ *  Jobs (lists of file paths) received over a Unix domain socket and counted by a pool of workers
+ *  kept alive between them, and the client that sends a job:
+ *     \li initServer
+ *     \li acceptJobs
+ *     \li serveChunks
+ *     \li submitJob.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+/**
+ *  \brief Open the server socket.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  \param socketPath path of the Unix domain socket, a stale socket there is replaced
+ *  \param chunkSize chunk size of the jobs, 0 for the default
+ *  \param checkUtf8 report the malformed utf-8 sequences of each file
+ */
+
+extern void initServer(const char* socketPath, int chunkSize, bool checkUtf8);
+
+/**
+ *  \brief Accept the jobs of the clients and hand them to the workers.
+ *
+ *  Operation carried out by main, until SIGINT or SIGTERM.
+ *
+ *  \return number of jobs served
+ */
+
+extern long acceptJobs(void);
+
+/**
+ *  \brief Count the chunks of the jobs, sending the results of each job once its last chunk is counted.
+ *
+ *  Operation carried out by the workers, until the server closes and no job is left.
+ *
+ *  \param workerId worker id
+ */
+
+extern void serveChunks(int workerId);
+
+/**
+ *  \brief Send a job to the server and print its results.
+ *
+ *  Operation carried out by main, in client mode.
+ *
+ *  \param socketPath path of the server socket
+ *  \param fileNames null terminated array of file names, sent as absolute paths
+ *
+ *  \return true if the results were received
+ */
+
+extern bool submitJob(const char* socketPath, char** fileNames);
+
+#endif /* SERVER_H */
@@ -13,7 +13,11 @@
  *     \li fillSharedMem
  *     \li printResults
  *     \li requestChunk
- *     \li postResults.
+ *     \li postResults
+ *     \li mergeResults
+ *     \li joinChunks
+ *     \li cacheResults
+ *     \li streamFiles.
  *
  *  \author Author Name - Month Year
  */
@@ -24,8 +28,21 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <sched.h>
 
 #include "consts.h"
+#include "textKernel.h"
+#include "ioRing.h"
+#include "instrument.h"
+#include "resultCache.h"
+#include "wordFreq.h"
+#include "decompress.h"
+#include "textMetrics.h"
 
 /** \brief worker threads return status array */
 extern int *statusWorkers;
@@ -33,6 +50,9 @@ extern int *statusWorkers;
 /** \brief main thread return status */
 extern int statusMain;
 
+/** \brief reader thread return status */
+extern int statusReader;
+
 /** \brief storage region */
 static struct SharedMemory sharedMemory;
 
@@ -42,8 +62,113 @@ static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
 /** \brief flag which warrants that the data transfer region is initialized exactly once */
 static pthread_once_t init = PTHREAD_ONCE_INIT;
 
-/** \brief check if character is separator */
-static bool isSeparator(int c);
+/** \brief workers synchronization point when waiting for a filled stream buffer */
+static pthread_cond_t waitFilled;
+
+/** \brief reader synchronization point when waiting for a free stream buffer */
+static pthread_cond_t waitFree;
+
+/** \brief hand out the next chunk, from a task, a buffer, a file pack or the current file */
+static bool handOutChunk(int workerId, unsigned char* buffer, struct ChunkData* chunkData);
+
+/** \brief note the instant a worker found no work left */
+static void markIdle(void);
+
+/** \brief order the files largest first */
+static int largerFile(const void* a, const void* b);
+
+/** \brief point to the next file with chunks left */
+static bool currentFile(void);
+
+/** \brief pack the next whole small files with the chunk handed out */
+static void packFiles(int workerId, unsigned char* buffer, struct ChunkData* first);
+
+/** \brief map a text file into memory */
+static void mapFile(int fileId);
+
+/** \brief get the size of a text file */
+static void statFile(int fileId);
+
+/** \brief claim the next bytes of the current file, to be read outside the monitor */
+static void claimFileChunk(int workerId, struct ChunkData* chunkData);
+
+/** \brief read a chunk of text claimed from a file */
+static void readFileChunk(int workerId, struct ChunkData* chunkData);
+
+/** \brief add a time to a total shared by the workers */
+static void addTime(double* total, double seconds);
+
+/** \brief split every mapped file into chunk descriptors */
+static void splitMappedFiles(void);
+
+/** \brief hand out the files to the worker task deques */
+static void distributeTasks(void);
+
+/** \brief take a chunk from the own task deque or steal a task from another worker */
+static bool takeChunk(int workerId, struct ChunkData* chunkData);
+
+/** \brief lock a task deque */
+static void lockDeque(int workerId, struct TaskDeque* deque);
+
+/** \brief unlock a task deque */
+static void unlockDeque(int workerId, struct TaskDeque* deque);
+
+/** \brief allocate the ring of stream buffers */
+static void initStream(void);
+
+/** \brief take the next filled stream buffer */
+static bool takeStreamBuffer(int workerId, struct ChunkData* chunkData);
+
+/** \brief join the edges of the processed stream buffers in order */
+static void joinStreamBuffer(int workerId, int bufferId, struct ChunkEdges* edges, struct WordFragments* fragments);
+
+/** \brief wait for a free stream buffer */
+static unsigned char* requestStreamBuffer(void);
+
+/** \brief hand a filled stream buffer to the workers */
+static void postStreamBuffer(int fileId, int size, bool compressed);
+
+/** \brief mark the end of the stream */
+static void endStream(void);
+
+/** \brief inflate the BGZF blocks of a stream buffer into the worker buffer */
+static void inflateChunk(int workerId, unsigned char* buffer, struct ChunkData* chunkData);
+
+/** \brief allocate the io_uring read buffers */
+static void initReadBuffers(void);
+
+/** \brief read every chunk of the files through io_uring */
+static void ringFiles(void);
+
+/** \brief take free read buffers */
+static int takeFreeBuffers(int* bufferIds, int wanted, bool wait);
+
+/** \brief hand a filled read buffer to the workers */
+static void postReadBuffer(int bufferId);
+
+/** \brief take the next filled read buffer */
+static bool takeReadBuffer(int workerId, struct ChunkData* chunkData);
+
+/** \brief give a processed read buffer back to the reader */
+static void releaseReadBuffer(int workerId, int bufferId);
+
+/** \brief look the files up in the result cache and find the duplicate ones */
+static void lookupFiles(void);
+
+/** \brief compare the bytes of two files of the same size */
+static bool sameBytes(const char* fileName, const char* otherName, long size);
+
+/** \brief the results of a file come from the cache or from a duplicate file */
+static bool countedElsewhere(int fileId);
+
+/** \brief time elapsed since a given instant */
+static double elapsedSince(struct timespec* t0);
+
+/** \brief choose the chunk unit from the measured costs */
+static int calibrateChunkSize(long totalBytes);
+
+/** \brief size of the next chunk handed out */
+static int nextChunkSize(long remaining, long fileLeft);
 
 /**
  *  \brief Initialization of the shared region.
@@ -54,10 +179,81 @@ static bool isSeparator(int c);
 static void initialization(void)
 {
 	sharedMemory.fileId = 0;
-	sharedMemory.chunkSize = MAX_CHUNK_SIZE;
-	sharedMemory.openFile = false;
+	sharedMemory.fileOrder = NULL;
+	sharedMemory.orderPos = 0;
+	sharedMemory.largestFirst = false;
+	sharedMemory.packs = NULL;
+	sharedMemory.firstIdle = 0;
+	sharedMemory.lastIdle = 0;
+	sharedMemory.chunkSize = MIN_CHUNK_SIZE;
+	sharedMemory.guidedChunks = false;
+	sharedMemory.remainingBytes = 0;
 	sharedMemory.totalFiles = 0;
-	sharedMemory.currentFile = NULL;
+	sharedMemory.fileFds = NULL;
+	sharedMemory.pendingReads = NULL;
+	sharedMemory.mapFiles = false;
+	sharedMemory.fileMaps = NULL;
+	sharedMemory.fileSizes = NULL;
+	sharedMemory.filePos = 0;
+	sharedMemory.atomicChunks = false;
+	sharedMemory.chunks = NULL;
+	sharedMemory.totalChunks = 0;
+	sharedMemory.splitChunks = 0;
+	sharedMemory.nextChunk = 0;
+	sharedMemory.workerResults = NULL;
+	sharedMemory.workStealing = false;
+	sharedMemory.totalWorkers = 0;
+	sharedMemory.deques = NULL;
+	sharedMemory.streamInput = false;
+	sharedMemory.streamBuffers = NULL;
+	sharedMemory.totalBuffers = 0;
+	sharedMemory.fillPos = 0;
+	sharedMemory.takePos = 0;
+	sharedMemory.joinPos = 0;
+	sharedMemory.streamEnd = false;
+	sharedMemory.fileSummaries = NULL;
+	sharedMemory.ioUring = false;
+	sharedMemory.readBuffers = NULL;
+	sharedMemory.freeBuffers = NULL;
+	sharedMemory.totalFree = 0;
+	sharedMemory.filledBuffers = NULL;
+	sharedMemory.filledHead = 0;
+	sharedMemory.totalFilled = 0;
+	sharedMemory.ioReads = 0;
+	sharedMemory.ioBytes = 0;
+	sharedMemory.ioTime = 0.0;
+	
+	pthread_cond_init (&waitFilled, NULL);				/* initialize workers synchronization point */
+	pthread_cond_init (&waitFree, NULL);				/* initialize reader synchronization point */
+	sharedMemory.firstChunk = NULL;
+	sharedMemory.chunkEdges = NULL;
+	sharedMemory.chunkUnits = NULL;
+	sharedMemory.lockAcquisitions = 0;
+	sharedMemory.queuedChunks = 0;
+	sharedMemory.cacheResults = false;
+	sharedMemory.verifyHash = false;
+	sharedMemory.fileStats = NULL;
+	sharedMemory.fileHashes = NULL;
+	sharedMemory.cachedFiles = NULL;
+	sharedMemory.duplicateOf = NULL;
+	sharedMemory.cacheHits = 0;
+	sharedMemory.duplicates = 0;
+	sharedMemory.appendOnly = false;
+	sharedMemory.fileStarts = NULL;
+	sharedMemory.resumedFiles = 0;
+	sharedMemory.resumedBytes = 0;
+	sharedMemory.wordFrequency = false;
+	sharedMemory.chunkFragments = NULL;
+	sharedMemory.fileRuns = NULL;
+	sharedMemory.decodeFailed = NULL;
+	sharedMemory.compressedFiles = 0;
+	sharedMemory.compressedBytes = 0;
+	sharedMemory.decodedBytes = 0;
+	sharedMemory.checkUtf8 = false;
+	sharedMemory.instrument = false;
+	sharedMemory.metrics = 0;
+	sharedMemory.workerMetrics = NULL;
+	sharedMemory.fileMetrics = NULL;
 }
 
 /**
@@ -65,10 +261,11 @@ static void initialization(void)
  *
  *  Operation carried out by main.
  *
- *  \param fileNames array of file names to be proceced
+ *  \param fileNames null terminated array of file names to be proceced
+ *  \param options command line options (io_uring is turned off when not available)
  */
 
-void fillSharedMem(char** fileNames)
+void fillSharedMem(char** fileNames, struct Options* options)
 {	
 	if ((statusMain = pthread_mutex_lock (&accessCR)) != 0)							/* enter monitor */
 	{
@@ -78,9 +275,10 @@ void fillSharedMem(char** fileNames)
 		pthread_exit(&statusMain);
 	}
 	pthread_once(&init, initialization);                                       		/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
 	
 	/* initialize files names */
-	int filesNumber = -2;	// do not count the first argument ("./countWords") neither the number of threads
+	int filesNumber = 0;
 	char** ptr = fileNames;
 	while(*ptr != 0)
 	{
@@ -105,7 +303,7 @@ void fillSharedMem(char** fileNames)
 	}
 	
 	ptr = fileNames;
-	int filesOffset = 2;
+	int filesOffset = 0;
 	for (int i = filesOffset; ptr[i] != 0; i++)
 	{
 		char* subptr = ptr[i];
@@ -139,6 +337,240 @@ void fillSharedMem(char** fileNames)
 		sharedMemory.fileResults[i - filesOffset].nWords = 0;
 		for (int j = 0; j < 6; j++)
 			sharedMemory.fileResults[i - filesOffset].vowels[j] = 0;
+		sharedMemory.fileResults[i - filesOffset].invalid = 0;
+		sharedMemory.fileResults[i - filesOffset].metrics = NULL;
+	}
+	
+	/* alocate worker private results memory, each array on its own cache lines */
+	if ((sharedMemory.workerResults = malloc(options->nThreads * sizeof(struct FileResult*))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the worker results\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	size_t resultsSize = (filesNumber * sizeof(struct FileResult) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+	for (int i = 0; i < options->nThreads; i++)
+	{
+		if ((sharedMemory.workerResults[i] = aligned_alloc(CACHE_LINE_SIZE, resultsSize)) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the worker results\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		memset(sharedMemory.workerResults[i], 0, resultsSize);
+	}
+	
+	/* text metrics of each file, and the private ones of each worker apart like its results */
+	sharedMemory.metrics = options->metrics;
+	if (sharedMemory.metrics != 0)
+	{
+		size_t metricsSize = (filesNumber * sizeof(struct TextMetrics) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+		
+		if (((sharedMemory.fileMetrics = calloc(filesNumber, sizeof(struct TextMetrics))) == NULL) ||
+			((sharedMemory.workerMetrics = malloc(options->nThreads * sizeof(struct TextMetrics*))) == NULL))
+		{
+			fprintf(stderr, "error on allocating space to the text metrics\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		for (int i = 0; i < options->nThreads; i++)
+		{
+			if ((sharedMemory.workerMetrics[i] = aligned_alloc(CACHE_LINE_SIZE, metricsSize)) == NULL)
+			{
+				fprintf(stderr, "error on allocating space to the text metrics\n");
+				statusMain = EXIT_FAILURE;
+				pthread_exit(&statusMain);
+			}
+			memset(sharedMemory.workerMetrics[i], 0, metricsSize);
+		}
+		for (int i = 0; i < filesNumber; i++)
+			sharedMemory.fileResults[i].metrics = &sharedMemory.fileMetrics[i];
+	}
+	
+	/* alocate file sizes memory */
+	if ((sharedMemory.fileSizes = malloc((filesNumber) * sizeof(long))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the file sizes\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	/* cached and duplicate files are left empty, they are never opened (streamed input is not cached,
+	   and the word frequencies and text metrics need every file to be read) */
+	if (options->cacheFile != NULL && options->streamInput)
+		fprintf(stderr, "streamed input is not cached\n");
+	else if (options->cacheFile != NULL && options->topWords > 0)
+		fprintf(stderr, "word frequencies need every file to be read, the result cache is not used\n");
+	else if (options->cacheFile != NULL && options->metrics != 0)
+		fprintf(stderr, "text metrics need every file to be read, the result cache is not used\n");
+	sharedMemory.cacheResults = (options->cacheFile != NULL && !options->streamInput && options->topWords == 0 &&
+		options->metrics == 0);
+	sharedMemory.verifyHash = options->verifyHash;
+	sharedMemory.appendOnly = options->appendOnly;
+	sharedMemory.checkUtf8 = options->checkUtf8;
+	sharedMemory.instrument = options->instrument;
+	if (sharedMemory.cacheResults)
+	{
+		loadCache(options->cacheFile);
+		lookupFiles();
+	}
+	
+	/* map every file once, workers will then only get views of the mappings */
+	sharedMemory.mapFiles = options->mapFiles;
+	if (sharedMemory.mapFiles)
+	{
+		if ((sharedMemory.fileMaps = malloc((filesNumber) * sizeof(unsigned char*))) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the file mappings\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		
+		for (int i = 0; i < filesNumber; i++)
+		{
+			sharedMemory.fileSizes[i] = 0;
+			sharedMemory.fileMaps[i] = NULL;
+			if (!countedElsewhere(i))
+				mapFile(i);
+			
+			/* only what was stat'ed is counted, from the resume offset on */
+			if (sharedMemory.cacheResults && sharedMemory.fileSizes[i] > 0)
+			{
+				long size = sharedMemory.fileSizes[i];
+				
+				if (size > sharedMemory.fileStats[i].st_size)
+					size = sharedMemory.fileStats[i].st_size;
+				sharedMemory.fileSizes[i] = (size > sharedMemory.fileStarts[i]) ? size - sharedMemory.fileStarts[i] : 0;
+				sharedMemory.fileMaps[i] += sharedMemory.fileStarts[i];
+			}
+		}
+	}
+	/* streamed files have no known size, they are cut as the reader fills the buffers */
+	else if (options->streamInput)
+		memset(sharedMemory.fileSizes, 0, filesNumber * sizeof(long));
+	else
+	{
+		/* files are opened when their first chunk is handed out and closed once all of them were read */
+		if (((sharedMemory.fileFds = malloc(filesNumber * sizeof(int))) == NULL) ||
+			((sharedMemory.pendingReads = calloc(filesNumber, sizeof(int))) == NULL))
+		{
+			fprintf(stderr, "error on allocating space to the file descriptors\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		for (int i = 0; i < filesNumber; i++)
+		{
+			sharedMemory.fileFds[i] = -1;
+			sharedMemory.fileSizes[i] = 0;
+			if (sharedMemory.cacheResults && !countedElsewhere(i))
+				sharedMemory.fileSizes[i] = sharedMemory.fileStats[i].st_size - sharedMemory.fileStarts[i];
+			else if (!sharedMemory.cacheResults)
+				statFile(i);
+		}
+	}
+	
+	/* chunk unit, fixed by the command line or chosen from the input size and the measured costs */
+	long totalBytes = 0;
+	for (int i = 0; i < filesNumber; i++)
+		totalBytes += sharedMemory.fileSizes[i];
+	
+	sharedMemory.totalWorkers = options->nThreads;
+	sharedMemory.guidedChunks = (options->chunkSize == 0);
+	sharedMemory.chunkSize = sharedMemory.guidedChunks ? calibrateChunkSize(totalBytes) : options->chunkSize;
+	sharedMemory.remainingBytes = totalBytes;
+	
+	/* largest files first (but streamed ones, whose sizes are not known), the small ones fill the gaps
+	   left at the end; the units are still numbered and the results printed in command line order */
+	if ((sharedMemory.fileOrder = malloc(filesNumber * sizeof(int))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the file order\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	for (int i = 0; i < filesNumber; i++)
+		sharedMemory.fileOrder[i] = i;
+	sharedMemory.largestFirst = !options->keepOrder && !options->streamInput;
+	if (sharedMemory.largestFirst)
+		qsort(sharedMemory.fileOrder, filesNumber, sizeof(int), largerFile);
+	
+	/* files are cut at multiples of the chunk unit, number the units of every file in order */
+	if ((sharedMemory.firstChunk = malloc((filesNumber + 1) * sizeof(int))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the chunk numbers\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	sharedMemory.totalChunks = 0;
+	for (int i = 0; i < filesNumber; i++)
+	{
+		sharedMemory.firstChunk[i] = sharedMemory.totalChunks;
+		sharedMemory.totalChunks += (sharedMemory.fileSizes[i] + sharedMemory.chunkSize - 1) / sharedMemory.chunkSize;
+	}
+	sharedMemory.firstChunk[filesNumber] = sharedMemory.totalChunks;
+	
+	/* alocate chunk edges memory, each chunk leaves its edges to be joined in order at the end */
+	if ((sharedMemory.chunkEdges = malloc((sharedMemory.totalChunks + 1) * sizeof(struct ChunkEdges))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the chunk edges\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	/* each file keeps the run open at the end of its joined chunks, each chunk leaves the runs cut by its
+	   edges in its fragments */
+	sharedMemory.wordFrequency = (options->topWords > 0);
+	if (sharedMemory.wordFrequency &&
+		(((sharedMemory.fileRuns = calloc(filesNumber, sizeof(struct WordRun))) == NULL) ||
+		((sharedMemory.chunkFragments = malloc((sharedMemory.totalChunks + 1) * sizeof(struct WordFragments))) == NULL)))
+	{
+		fprintf(stderr, "error on allocating space to the chunk fragments\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	/* a chunk of several units leaves its edges in its first unit, and its length in units */
+	if ((sharedMemory.chunkUnits = calloc(sharedMemory.totalChunks + 1, sizeof(int))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the chunk units\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	/* pre-split the files so that the workers can claim chunks without entering the monitor */
+	sharedMemory.atomicChunks = options->mapFiles && options->atomicChunks && !options->workStealing;
+	if (sharedMemory.atomicChunks)
+		splitMappedFiles();
+	
+	/* hand out the files to the workers, they are then split and stolen on demand */
+	sharedMemory.workStealing = options->mapFiles && options->workStealing;
+	if (sharedMemory.workStealing)
+		distributeTasks();
+	
+	/* the reader fills a fixed ring of buffers, twice as many as the workers */
+	sharedMemory.streamInput = options->streamInput;
+	if (sharedMemory.streamInput)
+		initStream();
+	
+	/* the reader keeps many reads in flight, the stdio path is used when io_uring is not available */
+	if (options->ioUring && !initIoRing(IO_RING_DEPTH))
+	{
+		fprintf(stderr, "io_uring is not available, reading the files with stdio\n");
+		options->ioUring = false;
+	}
+	sharedMemory.ioUring = options->ioUring;
+	if (sharedMemory.ioUring)
+		initReadBuffers();
+	
+	/* the monitor hands whole small files out together, the descriptors and tasks are already cheap to take */
+	if (sharedMemory.largestFirst && !sharedMemory.atomicChunks && !sharedMemory.workStealing && !sharedMemory.ioUring)
+	{
+		if ((sharedMemory.packs = aligned_alloc(CACHE_LINE_SIZE, sharedMemory.totalWorkers * sizeof(struct FilePack))) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the file packs\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		memset(sharedMemory.packs, 0, sharedMemory.totalWorkers * sizeof(struct FilePack));
 	}
 	
 	printf("Shared memory filled!\n");
@@ -168,17 +600,81 @@ void printResults(void)
 		pthread_exit(&statusMain);
 	}
 	pthread_once(&init, initialization);                                       		/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
 	
 	/* print results */
 	for (int i = 0; i < sharedMemory.totalFiles; i++)
 	{
-		int* vowels = sharedMemory.fileResults[i].vowels;
+		long* vowels = sharedMemory.fileResults[i].vowels;
 		
 		printf("File name: %s\n", sharedMemory.fileResults[i].fileName);
-		printf("Total number of words = %d\n", sharedMemory.fileResults[i].nWords);
+		if (sharedMemory.decodeFailed != NULL && sharedMemory.decodeFailed[i])
+			printf("(incomplete, some of its blocks could not be decompressed)\n");
+		if (sharedMemory.checkUtf8)
+		{
+			struct FileResult* result = &sharedMemory.fileResults[i];
+			
+			printf("Malformed utf-8 sequences = %ld", result->invalid);
+			for (int j = 0; j < result->invalid && j < INVALID_OFFSETS; j++)
+				printf("%s%ld", (j == 0) ? ", first at bytes " : " ", result->invalidAt[j]);
+			printf("\n");
+		}
+		printf("Total number of words = %ld\n", sharedMemory.fileResults[i].nWords);
 		printf("Number of words with an\n");
 		printf("\tA\tE\tI\tO\tU\tY\n");
-		printf("\t%d\t%d\t%d\t%d\t%d\t%d\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
+		printf("\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
+		if (sharedMemory.metrics != 0)
+			printMetrics(sharedMemory.fileResults[i].metrics, sharedMemory.metrics);
+		printf("\n");
+	}
+	
+	/* the cache, resume, decompression, monitor, scheduling and read diagnostics are printed with the phase times only */
+	if (sharedMemory.instrument)
+	{
+		if (sharedMemory.cacheResults)
+			printf("Result cache hits = %d of %d files, %d duplicates\n", sharedMemory.cacheHits, sharedMemory.totalFiles,
+				sharedMemory.duplicates);
+		
+		if (sharedMemory.resumedFiles > 0)
+			printf("Resumed files = %d, %ld bytes not read again\n", sharedMemory.resumedFiles, sharedMemory.resumedBytes);
+		
+		if (sharedMemory.compressedFiles > 0)
+			printf("Compressed files = %d, %ld bytes decompressed to %ld (%.2fx)\n", sharedMemory.compressedFiles,
+				sharedMemory.compressedBytes, sharedMemory.decodedBytes, (double) sharedMemory.decodedBytes / sharedMemory.compressedBytes);
+		
+		printf("Monitor lock acquisitions = %ld\n", sharedMemory.lockAcquisitions);
+		
+		if (sharedMemory.lastIdle > 0)
+			printf("Tail = %.6f s from the first idle worker to the last one%s\n", (sharedMemory.lastIdle - sharedMemory.firstIdle) / 1.0e9,
+				sharedMemory.largestFirst ? " (largest files first)" : "");
+		
+		if (!sharedMemory.streamInput)
+			printf("Chunk unit = %d bytes%s\n", sharedMemory.chunkSize, sharedMemory.guidedChunks ? " (guided chunks)" : "");
+		
+		/* the workers read on their own (stdio path), their read times overlap and are summed */
+		bool summed = !sharedMemory.ioUring && !sharedMemory.streamInput;
+		if (sharedMemory.ioReads > 0)
+		{
+			double seconds = (sharedMemory.ioTime > 0) ? sharedMemory.ioTime : 1.0e-9;
+		
+			printf("Reads = %ld in %.6f s%s, %.0f IOPS, %.1f MB/s%s\n", sharedMemory.ioReads, sharedMemory.ioTime,
+				summed ? " summed over the workers" : "", sharedMemory.ioReads / seconds,
+				sharedMemory.ioBytes / seconds / 1.0e6, summed ? " per worker" : "");
+		}
+		
+		if (sharedMemory.workStealing)
+		{
+			long dequeLocks = 0;
+			long steals = 0;
+		
+			for (int i = 0; i < sharedMemory.totalWorkers; i++)
+			{
+				dequeLocks += sharedMemory.deques[i].lockAcquisitions;
+				steals += sharedMemory.deques[i].steals;
+			}
+			printf("Task deque lock acquisitions = %ld\n", dequeLocks);
+			printf("Stolen tasks = %ld\n", steals);
+		}
 	}
 	
 	if ((statusMain = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
@@ -195,16 +691,64 @@ void printResults(void)
  *
  *  Operation carried out by the worker.
  *
+ *  When the files are memory mapped the chunk points straight into the mapping and the worker
+ *  buffer is left untouched.
+ *
  *  \param workerId woker id
  *  \param buffer buffer to store the text chunk
- *  \param fileId file identifier
- *  \param chunkSize size of the requested chunk
+ *  \param chunkData chunk data structure (file identifier, chunk text and its size)
+ *
+ *	\return false if all files were parsed
+ */
+
+bool requestChunk(int workerId, unsigned char* buffer, struct ChunkData* chunkData)
+{
+	if (handOutChunk(workerId, buffer, chunkData))
+		return true;
+	
+	markIdle();
+	return false;
+}
+
+/**
+ *  \brief Hand out the next chunk, from a task, a buffer, a file pack or the current file.
+ *
+ *  Auxiliar function, carried out by the worker.
+ *
+ *  \param workerId woker id
+ *  \param buffer buffer to store the text chunk
+ *  \param chunkData chunk data structure (file identifier, chunk text and its size)
  *
  *	\return false if all files were parsed
  */
 
-bool requestChunk(int workerId, unsigned char* buffer, int* fileId, int* chunkSize)
+static bool handOutChunk(int workerId, unsigned char* buffer, struct ChunkData* chunkData)
 {	
+	/* small files packed with the previous chunk, taken without entering the monitor */
+	if (sharedMemory.packs != NULL && sharedMemory.packs[workerId].next < sharedMemory.packs[workerId].count)
+	{
+		*chunkData = sharedMemory.packs[workerId].chunks[sharedMemory.packs[workerId].next++];
+		return true;
+	}
+	
+	/* pre-split files, claim the next chunk descriptor with a single atomic increment */
+	if (sharedMemory.atomicChunks)
+	{
+		int chunkId = __atomic_fetch_add(&sharedMemory.nextChunk, 1, __ATOMIC_RELAXED);
+		
+		if (chunkId >= sharedMemory.splitChunks)
+			return false;
+		
+		*chunkData = sharedMemory.chunks[chunkId];
+		return true;
+	}
+	
+	/* work stealing, only the task deques are locked */
+	if (sharedMemory.workStealing)
+		return takeChunk(workerId, chunkData);
+	
+	unsigned long long t0 = probeTime();
+	
 	if ((statusWorkers[workerId] = pthread_mutex_lock (&accessCR)) != 0)			/* enter monitor */
 	{
 		errno = statusWorkers[workerId];											/* save error in errno */
@@ -213,10 +757,16 @@ bool requestChunk(int workerId, unsigned char* buffer, int* fileId, int* chunkSi
 		pthread_exit(&statusWorkers[workerId]);
 	}
 	pthread_once(&init, initialization);											/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
+	probeAcquired(workerId, PHASE_LOCK_WAIT, t0);
 	
-	/* all files were processed, return false to end worker threads */
-	if (sharedMemory.fileId >= sharedMemory.totalFiles)
+	/* streamed files, take the next buffer filled by the reader */
+	if (sharedMemory.streamInput)
 	{
+		bool filled = takeStreamBuffer(workerId, chunkData);
+		bool compressed = filled && sharedMemory.streamBuffers[chunkData->chunkId].compressed;
+		
+		probeReleased(workerId);
 		if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessCR)) != 0)		/* exit monitor */
 		{
 			errno = statusWorkers[workerId];										/* save error in errno */
@@ -225,155 +775,77 @@ bool requestChunk(int workerId, unsigned char* buffer, int* fileId, int* chunkSi
 			pthread_exit(&statusWorkers[workerId]);
 		}
 		
-		return false;
+		/* BGZF blocks are inflated outside the monitor, by every worker at once */
+		if (compressed)
+			inflateChunk(workerId, buffer, chunkData);
+		
+		return filled;
 	}
 	
-	/* request chunk of text */
-	*fileId = sharedMemory.fileId;
-	
-	/* open file if not opened yet */
-	if (sharedMemory.openFile == false)
+	/* files read through io_uring, take the next buffer completed by the reader */
+	if (sharedMemory.ioUring)
 	{
-		if ((sharedMemory.currentFile = fopen(sharedMemory.fileNames[sharedMemory.fileId], "r")) == NULL)
+		bool filled = takeReadBuffer(workerId, chunkData);
+		
+		probeReleased(workerId);
+		if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessCR)) != 0)		/* exit monitor */
 		{
-			fprintf(stderr, "error on opening text file \"%s\"\n", sharedMemory.fileNames[sharedMemory.fileId]);
+			errno = statusWorkers[workerId];										/* save error in errno */
+			perror("error on exiting monitor(CF)");
 			statusWorkers[workerId] = EXIT_FAILURE;
 			pthread_exit(&statusWorkers[workerId]);
 		}
-		sharedMemory.openFile = true;
+		
+		return filled;
 	}
 	
-	//char chunkBuffer[MAX_CHUNK_SIZE] = "";
-    if ((*chunkSize = fread(buffer, 1, MAX_CHUNK_SIZE - 1, sharedMemory.currentFile)) == EOF)
+	/* all files were processed, return false to end worker threads */
+	if (!currentFile())
 	{
-		fprintf(stderr, "error on getting file chunk\n");
-		statusWorkers[workerId] = EXIT_FAILURE;
-		pthread_exit(&statusWorkers[workerId]);
-	}
-	buffer[(*chunkSize - 1)] = '\0';
-	
-	/* the file was completely read, point to the next one */
-	if (*chunkSize < MAX_CHUNK_SIZE - 1) {
-		if (fclose(sharedMemory.currentFile) == EOF)
+		probeReleased(workerId);
+		if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessCR)) != 0)		/* exit monitor */
 		{
-			fprintf(stderr, "error on closing text file \"%s\"\n", sharedMemory.fileNames[sharedMemory.fileId]);
+			errno = statusWorkers[workerId];										/* save error in errno */
+			perror("error on exiting monitor(CF)");
 			statusWorkers[workerId] = EXIT_FAILURE;
 			pthread_exit(&statusWorkers[workerId]);
 		}
-		sharedMemory.openFile = false;
-		sharedMemory.fileId++;
+		
+		return false;
 	}
-	/* the file still has content, check if we are in the middle of a word */
+	
+	/* request chunk of text, the next one of the current file */
+	long fileSize = sharedMemory.fileSizes[sharedMemory.fileId];
+	long left = fileSize - sharedMemory.filePos;
+	
+	chunkData->fileId = sharedMemory.fileId;
+	chunkData->chunkId = sharedMemory.firstChunk[sharedMemory.fileId] + (int) (sharedMemory.filePos / sharedMemory.chunkSize);
+	chunkData->chunkSize = nextChunkSize(sharedMemory.remainingBytes, left);
+	sharedMemory.remainingBytes -= chunkData->chunkSize;
+	
+	if (sharedMemory.mapFiles)
+		chunkData->buffer = sharedMemory.fileMaps[sharedMemory.fileId] + sharedMemory.filePos;
 	else
 	{
-		long currentFilePos;
-		int c = 0, j = 0, k = 0;
-		char cbuffer[4] = "";
-		
-		// check for uncomplete utf8 character
-		for (int i = *chunkSize - 1; i >= 0; i--)
-		{
-			// if the character is ascii, we can continue
-			if (j == 0 && (buffer[i] & 0x80) == 0)
-			{
-				//printf("ascii char, all good\n");
-				break;
-			}
-			
-			// get how many bytes the utf-8 char occupies
-			int bytes;
-			for (bytes = 1; buffer[i] & (0x80 >> bytes); bytes++);
-			
-			// first utf8 byte, check if the buffer has all its content
-			if (bytes > 1)
-			{
-				//printf("utf-8 char, checking!\n");
-				
-				// uncomplete utf-8 char, backtrack the buffer
-				if (bytes > j)
-				{
-					printf("uncomplete utf-8 char, backtracking buffer");
-					if ((currentFilePos = ftell(sharedMemory.currentFile)) == -1L)
-					{
-						fprintf(stderr, "error on telling text file \"%s\"\n", sharedMemory.fileNames[sharedMemory.fileId]);
-						statusWorkers[workerId] = EXIT_FAILURE;
-						pthread_exit(&statusWorkers[workerId]);
-					}
-					if (fseek(sharedMemory.currentFile, currentFilePos - (j + 1), SEEK_SET) != 0)
-					{
-						fprintf(stderr, "error on seeking text file \"%s\"\n", sharedMemory.fileNames[sharedMemory.fileId]);
-						statusWorkers[workerId] = EXIT_FAILURE;
-						pthread_exit(&statusWorkers[workerId]);
-					}
-					*chunkSize -= (j + 1);
-				}
-				break;
-			}
-			j++;
-		}
-		
-		// check for separation character
-		j = 0;
-		for (int i = *chunkSize - 1; i >= 0; i--)
-		{
-			cbuffer[j++] = buffer[i];
-			
-			// character is ascii, check if it is separator
-			if ((buffer[i] & 0x80) == 0)
-			{
-				j = 0;
-				if (isSeparator(buffer[i]))
-				{
-					//printf("ascci char is separator\n");
-					buffer[i] = '\0';
-					break;
-				}
-			}
-			
-			// get how many bytes the current utf-8 char occupies
-			int bytes;
-			for (bytes = 1; buffer[i] & (0x80 >> bytes); bytes++);
-			
-			// utf8 char first byte
-			if (bytes > 1)
-			{
-				//printf("checking utf-8 character\n");
-				for (int l = bytes - 1; l >= 0; l--)
-					c = (c << 8) | cbuffer[l];
-				
-				if (isSeparator(buffer[i]))
-				{
-					//printf("utf-8 char is separator\n");
-					buffer[i] = '\0';
-					break;
-				}
-				
-				c = 0;
-			}
-			k++;
-		}
-		
-		//printf("1 chunkSize = %d\n", *chunkSize);
-		
-		if ((currentFilePos = ftell(sharedMemory.currentFile)) == -1L)
-		{
-			fprintf(stderr, "error on telling text file \"%s\"\n", sharedMemory.fileNames[sharedMemory.fileId]);
-			statusWorkers[workerId] = EXIT_FAILURE;
-			pthread_exit(&statusWorkers[workerId]);
-		}
-		if (fseek(sharedMemory.currentFile, currentFilePos - (k + 1), SEEK_SET) != 0)
-		{
-			fprintf(stderr, "error on seeking text file \"%s\"\n", sharedMemory.fileNames[sharedMemory.fileId]);
-			statusWorkers[workerId] = EXIT_FAILURE;
-			pthread_exit(&statusWorkers[workerId]);
-		}
-		*chunkSize -= (k + 1);
-		
-		//printf("2 chunkSize = %d\n", *chunkSize);
+		chunkData->buffer = buffer;
+		claimFileChunk(workerId, chunkData);
+	}
+	
+	/* the file was completely handed out, point to the next one */
+	bool wholeFile = (sharedMemory.filePos == 0 && chunkData->chunkSize == fileSize);
+	
+	sharedMemory.filePos += chunkData->chunkSize;
+	if (sharedMemory.filePos >= fileSize)
+	{
+		sharedMemory.filePos = 0;
+		sharedMemory.orderPos++;
 	}
 	
-	//printf("%s\n=========================================\n", buffer);
+	/* a whole small file takes the next small files along */
+	if (wholeFile && sharedMemory.packs != NULL)
+		packFiles(workerId, buffer, chunkData);
 	
+	probeReleased(workerId);
 	if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessCR)) != 0)			/* exit monitor */
 	{
 		errno = statusWorkers[workerId];											/* save error in errno */
@@ -382,39 +854,1654 @@ bool requestChunk(int workerId, unsigned char* buffer, int* fileId, int* chunkSi
 		pthread_exit(&statusWorkers[workerId]);
 	}
 	
+	/* the bytes claimed are read outside the monitor, so the reads of the workers overlap */
+	if (!sharedMemory.mapFiles)
+	{
+		readFileChunk(workerId, chunkData);
+		if (wholeFile && sharedMemory.packs != NULL)
+			for (int i = 0; i < sharedMemory.packs[workerId].count; i++)
+				readFileChunk(workerId, &sharedMemory.packs[workerId].chunks[i]);
+	}
+	
 	return true;
 }
 
 /**
- *  \brief Check if character is seperator.
- *
- *  Auxilar function.
+ *  \brief Note the instant a worker found no work left.
  *
- *  \param c character
+ *  Auxiliar function, carried out by the worker.
  *
- *	\return true if character is separator
+ *  The first and the last instants bound the tail of the run, when some workers are already idle.
  */
 
-static bool isSeparator(int c)
+static void markIdle(void)
 {
-	if ((c == 0x20 || c == 0x9 || c == 0xA || c == 0xD) || (c == '-' || c == 0x22 || c == 0xE2809C || c == 0xE2809D || c == '[' || c == ']' || c == '(' || c == ')') || (c == '.' || c == ',' || c == ':' || c == ';' || c == '?' || c == '!' || c == 0xE28093 || c == 0xE280A6))
-		return true;
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
 	
-	return false;
+	long long now = t.tv_sec * 1000000000LL + t.tv_nsec;
+	long long unset = 0;
+	long long last = __atomic_load_n(&sharedMemory.lastIdle, __ATOMIC_RELAXED);
+	
+	__atomic_compare_exchange_n(&sharedMemory.firstIdle, &unset, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+	while (last < now && !__atomic_compare_exchange_n(&sharedMemory.lastIdle, &last, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 }
 
 /**
- *  \brief Save processed results in shared memory.
+ *  \brief Order the files largest first.
  *
- *  Operation carried by the worker.
+ *  Auxiliar function, qsort comparator of file identifiers. Files of the same size keep the command
+ *  line order.
  *
- *  \param workerId worker id
- *  \param fileResult file result structure
- *  \param fileId file identifier
+ *  \param a first file identifier
+ *  \param b second file identifier
+ *
+ *  \return negative if the first file is handed out before the second
+ */
+
+static int largerFile(const void* a, const void* b)
+{
+	int fileA = *(const int*) a;
+	int fileB = *(const int*) b;
+	
+	if (sharedMemory.fileSizes[fileA] != sharedMemory.fileSizes[fileB])
+		return (sharedMemory.fileSizes[fileA] > sharedMemory.fileSizes[fileB]) ? -1 : 1;
+	
+	return fileA - fileB;
+}
+
+/**
+ *  \brief Point to the next file with chunks left.
+ *
+ *  Internal monitor operation.
+ *
+ *  Empty files are skipped, they have no chunks.
+ *
+ *  \return false if all files were handed out
+ */
+
+static bool currentFile(void)
+{
+	while (sharedMemory.orderPos < sharedMemory.totalFiles && sharedMemory.fileSizes[sharedMemory.fileOrder[sharedMemory.orderPos]] == 0)
+		sharedMemory.orderPos++;
+	
+	if (sharedMemory.orderPos >= sharedMemory.totalFiles)
+		return false;
+	
+	sharedMemory.fileId = sharedMemory.fileOrder[sharedMemory.orderPos];
+	return true;
+}
+
+/**
+ *  \brief Pack the next whole small files with the chunk handed out.
+ *
+ *  Internal monitor operation.
+ *
+ *  The files are read (or pointed to, when mapped) right after the first chunk, while they fit in the
+ *  size the monitor would hand out as a single chunk now. The worker then takes them one by one
+ *  without entering the monitor, each with its own file identifier and edges.
+ *
+ *  \param workerId woker id
+ *  \param buffer buffer holding the chunk handed out
+ *  \param first chunk handed out, a whole file
+ */
+
+static void packFiles(int workerId, unsigned char* buffer, struct ChunkData* first)
+{
+	struct FilePack* pack = &sharedMemory.packs[workerId];
+	long budget = nextChunkSize(sharedMemory.remainingBytes + first->chunkSize, MAX_CHUNK_SIZE);
+	long used = first->chunkSize;
+	
+	pack->count = 0;
+	pack->next = 0;
+	while (pack->count < PACKED_FILES && currentFile() && used + sharedMemory.fileSizes[sharedMemory.fileId] <= budget)
+	{
+		struct ChunkData* chunk = &pack->chunks[pack->count++];
+		int size = (int) sharedMemory.fileSizes[sharedMemory.fileId];
+		
+		chunk->fileId = sharedMemory.fileId;
+		chunk->chunkId = sharedMemory.firstChunk[sharedMemory.fileId];
+		chunk->chunkSize = size;
+		if (sharedMemory.mapFiles)
+			chunk->buffer = sharedMemory.fileMaps[sharedMemory.fileId];
+		else
+		{
+			chunk->buffer = buffer + used;
+			claimFileChunk(workerId, chunk);
+		}
+		
+		sharedMemory.remainingBytes -= size;
+		used += size;
+		sharedMemory.orderPos++;
+	}
+}
+
+/**
+ *  \brief Map a text file into memory.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  Empty files are not mapped, they are simply marked with size 0.
+ *
+ *  \param fileId file identifier
+ */
+
+static void mapFile(int fileId)
+{
+	int fd;
+	struct stat fileStat;
+	
+	if ((fd = open(sharedMemory.fileNames[fileId], O_RDONLY)) == -1)
+	{
+		fprintf(stderr, "error on opening text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	if (fstat(fd, &fileStat) == -1)
+	{
+		fprintf(stderr, "error on getting the size of text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	sharedMemory.fileSizes[fileId] = fileStat.st_size;
+	sharedMemory.fileMaps[fileId] = NULL;
+	
+	if (fileStat.st_size > 0)
+	{
+		void* map = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			fprintf(stderr, "error on mapping text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		(void) madvise(map, fileStat.st_size, MADV_SEQUENTIAL);
+		sharedMemory.fileMaps[fileId] = map;
+	}
+	
+	/* the mapping stays valid after closing the descriptor */
+	if (close(fd) == -1)
+	{
+		fprintf(stderr, "error on closing text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Get the size of a text file.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  \param fileId file identifier
+ */
+
+static void statFile(int fileId)
+{
+	struct stat fileStat;
+	
+	if (stat(sharedMemory.fileNames[fileId], &fileStat) == -1)
+	{
+		fprintf(stderr, "error on getting the size of text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	sharedMemory.fileSizes[fileId] = fileStat.st_size;
+}
+
+/**
+ *  \brief Look the files up in the result cache and find the duplicate ones.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  Every file is stat'ed once, the hits get their results from the cache. With append only files,
+ *  a file that grew since it was cached is resumed from its cached size. A file that is not a hit
+ *  is a duplicate of an earlier one with the same device and inode, or with the same size and
+ *  content. Duplicates are found through an open addressing table of the files that will be
+ *  counted, keyed by their size, so only the files whose size collides with another one are hashed,
+ *  and only the ones whose hash also matches are compared byte for byte (the hash is not collision
+ *  resistant).
+ */
+
+static void lookupFiles(void)
+{
+	int nFiles = sharedMemory.totalFiles;
+	int nSlots = 16;
+	int* slots;
+	
+	while (nSlots < 2 * nFiles)
+		nSlots *= 2;
+	
+	if (((sharedMemory.fileStats = malloc(nFiles * sizeof(struct stat))) == NULL) ||
+		((sharedMemory.fileHashes = calloc(nFiles, sizeof(unsigned long long))) == NULL) ||
+		((sharedMemory.cachedFiles = calloc(nFiles, sizeof(bool))) == NULL) ||
+		((sharedMemory.duplicateOf = malloc(nFiles * sizeof(int))) == NULL) ||
+		((sharedMemory.fileStarts = calloc(nFiles, sizeof(long))) == NULL) ||
+		((sharedMemory.fileSummaries = calloc(nFiles, sizeof(struct ChunkSummary))) == NULL) ||
+		((slots = malloc(nSlots * sizeof(int))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to the file identities\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	memset(slots, -1, nSlots * sizeof(int));
+	
+	for (int i = 0; i < nFiles; i++)
+	{
+		struct stat* fileStat = &sharedMemory.fileStats[i];
+		
+		sharedMemory.duplicateOf[i] = -1;
+		if (stat(sharedMemory.fileNames[i], fileStat) == -1)
+		{
+			fprintf(stderr, "error on getting the size of text file \"%s\"\n", sharedMemory.fileNames[i]);
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		if (!S_ISREG(fileStat->st_mode))
+			continue;
+		
+		if (lookupCache(fileStat, sharedMemory.fileNames[i], sharedMemory.verifyHash, &sharedMemory.fileHashes[i],
+			&sharedMemory.fileResults[i]))
+		{
+			sharedMemory.cachedFiles[i] = true;
+			sharedMemory.cacheHits++;
+			continue;
+		}
+		
+		/* a file that only grew is counted from its cached size on */
+		if (sharedMemory.appendOnly && resumeCache(fileStat, sharedMemory.fileNames[i], &sharedMemory.fileStarts[i],
+			&sharedMemory.fileSummaries[i]))
+		{
+			sharedMemory.resumedFiles++;
+			sharedMemory.resumedBytes += sharedMemory.fileStarts[i];
+		}
+		
+		if (sharedMemory.verifyHash && sharedMemory.fileHashes[i] == 0)
+			sharedMemory.fileHashes[i] = hashFile(sharedMemory.fileNames[i]);
+		
+		/* same identity, or same size and content */
+		unsigned long long key = (unsigned long long) fileStat->st_size * 0x9E3779B97F4A7C15ULL;
+		int slot = (int) ((key ^ (key >> 29)) & (nSlots - 1));
+		
+		for (; slots[slot] != -1; slot = (slot + 1) & (nSlots - 1))
+		{
+			int j = slots[slot];
+			struct stat* other = &sharedMemory.fileStats[j];
+			
+			if (other->st_size != fileStat->st_size)
+				continue;
+			
+			bool same = (other->st_dev == fileStat->st_dev && other->st_ino == fileStat->st_ino);
+			
+			/* both files are hashed once, the first time their size collides */
+			if (!same)
+			{
+				if (sharedMemory.fileHashes[j] == 0)
+					sharedMemory.fileHashes[j] = hashFile(sharedMemory.fileNames[j]);
+				if (sharedMemory.fileHashes[i] == 0)
+					sharedMemory.fileHashes[i] = hashFile(sharedMemory.fileNames[i]);
+				same = (sharedMemory.fileHashes[j] == sharedMemory.fileHashes[i]) &&
+					sameBytes(sharedMemory.fileNames[i], sharedMemory.fileNames[j], fileStat->st_size);
+			}
+			
+			if (same)
+			{
+				sharedMemory.duplicateOf[i] = slots[slot];
+				sharedMemory.duplicates++;
+				break;
+			}
+		}
+		if (sharedMemory.duplicateOf[i] == -1)
+			slots[slot] = i;
+	}
+	
+	free(slots);
+}
+
+/**
+ *  \brief Compare the bytes of two files of the same size.
+ *
+ *  Auxiliar function, carried out by main once the hashes of the files match.
+ *
+ *  \param fileName file name
+ *  \param otherName name of the other file
+ *  \param size size of both files
+ *
+ *  \return true if the files have the same bytes
+ */
+
+static bool sameBytes(const char* fileName, const char* otherName, long size)
+{
+	const char* names[2] = { fileName, otherName };
+	unsigned char* maps[2];
+	int fds[2];
+
+	if (size == 0)
+		return true;
+
+	for (int k = 0; k < 2; k++)
+	{
+		if ((fds[k] = open(names[k], O_RDONLY)) == -1 ||
+			(maps[k] = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fds[k], 0)) == MAP_FAILED)
+		{
+			fprintf(stderr, "error on mapping text file \"%s\"\n", names[k]);
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		(void) madvise(maps[k], size, MADV_SEQUENTIAL);
+	}
+
+	bool same = (memcmp(maps[0], maps[1], size) == 0);
+
+	for (int k = 0; k < 2; k++)
+	{
+		munmap(maps[k], size);
+		close(fds[k]);
+	}
+
+	return same;
+}
+
+/**
+ *  \brief The results of a file come from the cache or from a duplicate file.
+ *
+ *  Auxiliar function.
+ *
+ *  \param fileId file identifier
+ *
+ *  \return true if the file is not counted
+ */
+
+static bool countedElsewhere(int fileId)
+{
+	return sharedMemory.cacheResults && (sharedMemory.cachedFiles[fileId] || sharedMemory.duplicateOf[fileId] >= 0);
+}
+
+/**
+ *  \brief Split every mapped file into chunk descriptors.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  The descriptors are later claimed by the workers without entering the monitor.
+ */
+
+static void splitMappedFiles(void)
+{
+	if ((sharedMemory.chunks = malloc((sharedMemory.totalChunks + 1) * sizeof(struct ChunkData))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the chunk descriptors\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	/* same sizes as the monitor would hand out, in the order the chunks are claimed */
+	long remaining = sharedMemory.remainingBytes;
+	int n = 0;
+	
+	for (int k = 0; k < sharedMemory.totalFiles; k++)
+	{
+		int i = sharedMemory.fileOrder[k];
+		
+		for (long start = 0, size; start < sharedMemory.fileSizes[i]; start += size, n++)
+		{
+			size = nextChunkSize(remaining, sharedMemory.fileSizes[i] - start);
+			remaining -= size;
+			
+			sharedMemory.chunks[n].fileId = i;
+			sharedMemory.chunks[n].chunkId = sharedMemory.firstChunk[i] + (int) (start / sharedMemory.chunkSize);
+			sharedMemory.chunks[n].buffer = sharedMemory.fileMaps[i] + start;
+			sharedMemory.chunks[n].chunkSize = (int) size;
+		}
+	}
+	
+	sharedMemory.splitChunks = n;
+	sharedMemory.nextChunk = 0;
+}
+
+/**
+ *  \brief Hand out the files to the worker task deques.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  Each non empty file becomes a task with all its chunks. Largest first, each file goes to the worker
+ *  with the fewest bytes so far (LPT), or to the workers in turn when keeping the command line order.
+ *  The largest tasks are then at the top of the deques, where they are stolen from. Each deque also
+ *  leaves room for the halves pushed while splitting a task. Every chunk starts out queued.
+ */
+
+static void distributeTasks(void)
+{
+	int nWorkers = sharedMemory.totalWorkers;
+	int* owners;
+	int* counts;
+	long* loads;
+	
+	if (((sharedMemory.deques = aligned_alloc(CACHE_LINE_SIZE, nWorkers * sizeof(struct TaskDeque))) == NULL) ||
+		((owners = malloc(sharedMemory.totalFiles * sizeof(int))) == NULL) ||
+		((counts = calloc(nWorkers, sizeof(int))) == NULL) ||
+		((loads = calloc(nWorkers, sizeof(long))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to the task deques\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	for (int k = 0, turn = 0; k < sharedMemory.totalFiles; k++)
+	{
+		int i = sharedMemory.fileOrder[k];
+		int worker = turn;
+		
+		if (sharedMemory.firstChunk[i] == sharedMemory.firstChunk[i + 1])
+			continue;
+		
+		if (sharedMemory.largestFirst)
+			for (int j = 0; j < nWorkers; j++)
+				worker = (loads[j] < loads[worker]) ? j : worker;
+		else
+			turn = (turn + 1) % nWorkers;
+		
+		owners[i] = worker;
+		loads[worker] += sharedMemory.fileSizes[i];
+		counts[worker]++;
+	}
+	
+	for (int i = 0; i < nWorkers; i++)
+	{
+		struct TaskDeque* deque = &sharedMemory.deques[i];
+		int capacity = counts[i] + SPLIT_TASKS;
+		
+		if ((deque->tasks = malloc(capacity * sizeof(struct Task))) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the task deques\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		if ((statusMain = pthread_mutex_init(&deque->access, NULL)) != 0)
+		{
+			errno = statusMain;														/* save error in errno */
+			perror("error on initializing the task deque lock");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		deque->capacity = capacity;
+		deque->top = 0;
+		__atomic_store_n(&deque->count, 0, __ATOMIC_RELAXED);
+		deque->lockAcquisitions = 0;
+		deque->steals = 0;
+	}
+	
+	for (int k = 0; k < sharedMemory.totalFiles; k++)
+	{
+		int i = sharedMemory.fileOrder[k];
+		
+		if (sharedMemory.firstChunk[i] == sharedMemory.firstChunk[i + 1])
+			continue;
+		
+		struct TaskDeque* deque = &sharedMemory.deques[owners[i]];
+		
+		deque->tasks[deque->count].fileId = i;
+		deque->tasks[deque->count].firstChunk = sharedMemory.firstChunk[i];
+		deque->tasks[deque->count].lastChunk = sharedMemory.firstChunk[i + 1];
+		__atomic_fetch_add(&deque->count, 1, __ATOMIC_RELAXED);
+		sharedMemory.queuedChunks += sharedMemory.firstChunk[i + 1] - sharedMemory.firstChunk[i];
+	}
+	
+	free(owners);
+	free(counts);
+	free(loads);
+}
+
+/**
+ *  \brief Take a chunk from the own task deque or steal a task from another worker.
+ *
+ *  Operation carried out by the worker, only the task deques are locked.
+ *
+ *  The newest task of the own deque is taken first. When it is empty, the oldest (and largest) task
+ *  of the other deques is stolen, starting at the next worker. The task is then split in halves
+ *  down to its first chunk, each upper half is pushed to the own deque, where it can be stolen
+ *  in turn.
+ *
+ *  A task being split is in no deque until its halves are pushed, so a worker that finds every deque
+ *  empty scans them again while chunks are still queued, and only stops once every chunk was taken.
+ *
+ *  \param workerId woker id
+ *  \param chunkData chunk data structure (file identifier, chunk text and its size)
+ *
+ *	\return false if every chunk was already taken
+ */
+
+static bool takeChunk(int workerId, struct ChunkData* chunkData)
+{
+	struct TaskDeque* own = &sharedMemory.deques[workerId];
+	struct Task task = { 0 };
+	bool found = false;
+	
+	lockDeque(workerId, own);
+	if (own->count > 0)
+	{
+		__atomic_fetch_sub(&own->count, 1, __ATOMIC_RELAXED);
+		task = own->tasks[(own->top + own->count) % own->capacity];
+		found = true;
+	}
+	unlockDeque(workerId, own);
+	
+	while (!found)
+	{
+		for (int i = 1; i < sharedMemory.totalWorkers && !found; i++)
+		{
+			struct TaskDeque* victim = &sharedMemory.deques[(workerId + i) % sharedMemory.totalWorkers];
+			
+			/* empty deques are passed by without taking their lock */
+			if (__atomic_load_n(&victim->count, __ATOMIC_RELAXED) == 0)
+				continue;
+			
+			lockDeque(workerId, victim);
+			if (victim->count > 0)
+			{
+				task = victim->tasks[victim->top];
+				victim->top = (victim->top + 1) % victim->capacity;
+				__atomic_fetch_sub(&victim->count, 1, __ATOMIC_RELAXED);
+				found = true;
+			}
+			unlockDeque(workerId, victim);
+			
+			if (found)
+				own->steals++;
+		}
+		
+		/* the chunks left are in the task another worker is splitting */
+		if (!found && __atomic_load_n(&sharedMemory.queuedChunks, __ATOMIC_ACQUIRE) == 0)
+			return false;
+		if (!found)
+			sched_yield();
+	}
+	
+	/* split the task on demand, keeping its first chunk */
+	if (task.lastChunk - task.firstChunk > 1)
+	{
+		lockDeque(workerId, own);
+		while (task.lastChunk - task.firstChunk > 1)
+		{
+			int mid = task.firstChunk + (task.lastChunk - task.firstChunk) / 2;
+			struct Task* half = &own->tasks[(own->top + own->count) % own->capacity];
+			
+			half->fileId = task.fileId;
+			half->firstChunk = mid;
+			half->lastChunk = task.lastChunk;
+			__atomic_fetch_add(&own->count, 1, __ATOMIC_RELAXED);
+			task.lastChunk = mid;
+		}
+		unlockDeque(workerId, own);
+	}
+	
+	/* the halves are queued again before the chunk taken leaves the count */
+	__atomic_fetch_sub(&sharedMemory.queuedChunks, 1, __ATOMIC_RELEASE);
+	
+	long start = (long) (task.firstChunk - sharedMemory.firstChunk[task.fileId]) * sharedMemory.chunkSize;
+	long left = sharedMemory.fileSizes[task.fileId] - start;
+	
+	chunkData->fileId = task.fileId;
+	chunkData->chunkId = task.firstChunk;
+	chunkData->buffer = sharedMemory.fileMaps[task.fileId] + start;
+	chunkData->chunkSize = (left < sharedMemory.chunkSize) ? (int) left : sharedMemory.chunkSize;
+	
+	return true;
+}
+
+/**
+ *  \brief Lock a task deque.
+ *
+ *  Auxiliar function, carried out by the worker.
+ *
+ *  \param workerId woker id
+ *  \param deque task deque
+ */
+
+static void lockDeque(int workerId, struct TaskDeque* deque)
+{
+	unsigned long long t0 = probeTime();
+	
+	if ((statusWorkers[workerId] = pthread_mutex_lock (&deque->access)) != 0)
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on locking task deque");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+	deque->lockAcquisitions++;
+	probeAcquired(workerId, PHASE_LOCK_WAIT, t0);
+}
+
+/**
+ *  \brief Unlock a task deque.
+ *
+ *  Auxiliar function, carried out by the worker.
+ *
+ *  \param workerId woker id
+ *  \param deque task deque
+ */
+
+static void unlockDeque(int workerId, struct TaskDeque* deque)
+{
+	probeReleased(workerId);
+	if ((statusWorkers[workerId] = pthread_mutex_unlock (&deque->access)) != 0)
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on unlocking task deque");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+}
+
+/**
+ *  \brief Claim the next bytes of the current file, to be read outside the monitor.
+ *
+ *  Internal monitor operation.
+ *
+ *  The file is opened with its first chunk. Every chunk handed out but the last one of the file holds
+ *  a pending read, the last one takes over the read held since the file was opened, so the file is
+ *  closed by whichever worker reads the last bytes of it.
+ *
+ *  \param workerId woker id
+ *  \param chunkData chunk handed out, the next chunkSize bytes of the current file
+ */
+
+static void claimFileChunk(int workerId, struct ChunkData* chunkData)
+{
+	int fileId = sharedMemory.fileId;
+	
+	/* open file if not opened yet */
+	if (sharedMemory.fileFds[fileId] == -1)
+	{
+		if ((sharedMemory.fileFds[fileId] = open(sharedMemory.fileNames[fileId], O_RDONLY)) == -1)
+		{
+			fprintf(stderr, "error on opening text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+			statusWorkers[workerId] = EXIT_FAILURE;
+			pthread_exit(&statusWorkers[workerId]);
+		}
+		sharedMemory.pendingReads[fileId] = 1;
+	}
+	
+	/* resumed file, only its new bytes are read */
+	chunkData->offset = sharedMemory.filePos + (sharedMemory.cacheResults ? sharedMemory.fileStarts[fileId] : 0);
+	
+	if (sharedMemory.filePos + chunkData->chunkSize < sharedMemory.fileSizes[fileId])
+		__atomic_fetch_add(&sharedMemory.pendingReads[fileId], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ *  \brief Read a chunk of text claimed from a file.
+ *
+ *  Auxiliar function, carried out by the worker outside the monitor.
+ *
+ *  \param workerId woker id
+ *  \param chunkData chunk claimed, its buffer is filled
+ */
+
+static void readFileChunk(int workerId, struct ChunkData* chunkData)
+{
+	struct timespec t0;
+	unsigned long long probe = probeTime();
+	int fd = sharedMemory.fileFds[chunkData->fileId];
+	int done = 0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	
+	while (done < chunkData->chunkSize)
+	{
+		ssize_t n = pread(fd, chunkData->buffer + done, chunkData->chunkSize - done, chunkData->offset + done);
+		if (n <= 0)
+		{
+			fprintf(stderr, "error on getting file chunk\n");
+			statusWorkers[workerId] = EXIT_FAILURE;
+			pthread_exit(&statusWorkers[workerId]);
+		}
+		done += n;
+	}
+	
+	/* the file was completely read */
+	if (__atomic_sub_fetch(&sharedMemory.pendingReads[chunkData->fileId], 1, __ATOMIC_ACQ_REL) == 0 && close(fd) == -1)
+	{
+		fprintf(stderr, "error on closing text file \"%s\"\n", sharedMemory.fileNames[chunkData->fileId]);
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+	
+	/* time spent reading, summed over the workers */
+	addTime(&sharedMemory.ioTime, elapsedSince(&t0));
+	__atomic_fetch_add(&sharedMemory.ioReads, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&sharedMemory.ioBytes, chunkData->chunkSize, __ATOMIC_RELAXED);
+	(void) recordPhase(workerId, PHASE_READ, probe);
+}
+
+/**
+ *  \brief Add a time to a total shared by the workers.
+ *
+ *  Auxiliar function.
+ *
+ *  \param total shared total, in seconds
+ *  \param seconds time to add
+ */
+
+static void addTime(double* total, double seconds)
+{
+	double old, new;
+	
+	__atomic_load(total, &old, __ATOMIC_RELAXED);
+	do
+		new = old + seconds;
+	while (!__atomic_compare_exchange(total, &old, &new, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ *  \brief Save processed results in the worker private results.
+ *
+ *  Operation carried by the worker.
+ *
+ *  The results are only merged into the shared region once the worker is joined by main. The chunk
+ *  edges are saved in the chunk slot, which no other worker writes, to be joined by main as well.
+ *
+ *  \param workerId worker id
+ *  \param chunkSummary chunk summary structure
+ *  \param fragments runs cut by the chunk edges, NULL if the word frequencies are not counted
+ *  \param chunkData chunk data structure
+ */
+
+void postResults(int workerId, struct ChunkSummary chunkSummary, struct WordFragments* fragments, struct ChunkData* chunkData)
+{
+	struct FileResult* result = &sharedMemory.workerResults[workerId][chunkData->fileId];
+	
+	/* post obtained results, no need to enter the monitor since only this worker accesses them */
+	result->nWords += chunkSummary.nWords;
+	for (int i = 0; i < 6; i++)
+		result->vowels[i] += chunkSummary.vowels[i];
+	if (sharedMemory.metrics != 0)
+		addMetrics(&sharedMemory.workerMetrics[workerId][chunkData->fileId], &chunkSummary.metrics);
+	
+	/* streamed buffers are reused, their edges are joined as soon as the previous ones were */
+	if (sharedMemory.streamInput)
+		joinStreamBuffer(workerId, chunkData->chunkId, &chunkSummary.edges, fragments);
+	else
+	{
+		sharedMemory.chunkEdges[chunkData->chunkId] = chunkSummary.edges;
+		if (fragments != NULL)
+			sharedMemory.chunkFragments[chunkData->chunkId] = *fragments;
+		sharedMemory.chunkUnits[chunkData->chunkId] = (chunkData->chunkSize + sharedMemory.chunkSize - 1) / sharedMemory.chunkSize;
+	}
+	
+	/* the io_uring read buffer can be filled again */
+	if (sharedMemory.ioUring)
+		releaseReadBuffer(workerId, chunkData->bufferId);
+}
+
+/**
+ *  \brief Merge the private results of a worker into the file results.
+ *
+ *  Operation carried out by main, after joining the worker.
+ *
+ *  \param workerId worker id
+ */
+
+void mergeResults(int workerId)
+{
+	if ((statusMain = pthread_mutex_lock (&accessCR)) != 0)							/* enter monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	pthread_once(&init, initialization);                                       		/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
+	
+	for (int i = 0; i < sharedMemory.totalFiles; i++)
+	{
+		struct FileResult* result = &sharedMemory.workerResults[workerId][i];
+		
+		sharedMemory.fileResults[i].nWords += result->nWords;
+		for (int j = 0; j < 6; j++)
+			sharedMemory.fileResults[i].vowels[j] += result->vowels[j];
+		if (sharedMemory.metrics != 0)
+			addMetrics(&sharedMemory.fileMetrics[i], &sharedMemory.workerMetrics[workerId][i]);
+	}
+	
+	if ((statusMain = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Join the edges of the chunks of every file.
+ *
+ *  Operation carried out by main, after joining all the workers.
+ *
+ *  Counts the words (and their vowels) cut by the chunk edges, going through the chunks of each file
+ *  in order.
+ */
+
+void joinChunks(void)
+{
+	if ((statusMain = pthread_mutex_lock (&accessCR)) != 0)							/* enter monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	pthread_once(&init, initialization);                                       		/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
+	
+	for (int i = 0; i < sharedMemory.totalFiles; i++)
+	{
+		struct ChunkSummary summary;
+		
+		/* streamed files were already joined buffer by buffer, resumed files start from their cached summary */
+		if (sharedMemory.fileSummaries != NULL)
+			summary = sharedMemory.fileSummaries[i];
+		else
+			memset(&summary, 0, sizeof(struct ChunkSummary));
+		for (int j = sharedMemory.firstChunk[i]; j < sharedMemory.firstChunk[i + 1]; j += sharedMemory.chunkUnits[j])
+		{
+			joinEdges(&summary, &sharedMemory.chunkEdges[j]);
+			if (sharedMemory.wordFrequency)
+				joinFragments(&sharedMemory.fileRuns[i], &sharedMemory.chunkFragments[j], sharedMemory.totalWorkers);
+		}
+		
+		/* the words cut by the chunk edges go to the table of main */
+		if (sharedMemory.wordFrequency)
+			closeFragments(&sharedMemory.fileRuns[i], sharedMemory.totalWorkers);
+		
+		/* keep the summary of the whole file with its edges still open, a later run can resume from it */
+		if (sharedMemory.cacheResults)
+		{
+			sharedMemory.fileSummaries[i] = summary;
+			sharedMemory.fileSummaries[i].nWords += sharedMemory.fileResults[i].nWords;
+			for (int j = 0; j < 6; j++)
+				sharedMemory.fileSummaries[i].vowels[j] += sharedMemory.fileResults[i].vowels[j];
+		}
+		
+		addSummary(&sharedMemory.fileResults[i], &summary);
+	}
+	
+	if ((statusMain = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Complete the results of the duplicate files and store the counted ones in the cache.
+ *
+ *  Operation carried out by main, after joining the chunks.
+ */
+
+void cacheResults(void)
+{
+	if ((statusMain = pthread_mutex_lock (&accessCR)) != 0)							/* enter monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	pthread_once(&init, initialization);                                       		/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
+	
+	if (sharedMemory.cacheResults)
+	{
+		for (int i = 0; i < sharedMemory.totalFiles; i++)
+		{
+			struct FileResult* result = &sharedMemory.fileResults[i];
+			
+			if (sharedMemory.duplicateOf[i] >= 0)
+			{
+				struct FileResult* original = &sharedMemory.fileResults[sharedMemory.duplicateOf[i]];
+				
+				result->nWords = original->nWords;
+				for (int j = 0; j < 6; j++)
+					result->vowels[j] = original->vowels[j];
+				result->invalid = original->invalid;
+				for (int j = 0; j < INVALID_OFFSETS; j++)
+					result->invalidAt[j] = original->invalidAt[j];
+				sharedMemory.fileSummaries[i] = sharedMemory.fileSummaries[sharedMemory.duplicateOf[i]];
+			}
+			
+			/* only regular files keep their identity between runs */
+			if (!sharedMemory.cachedFiles[i] && S_ISREG(sharedMemory.fileStats[i].st_mode))
+				storeCache(&sharedMemory.fileStats[i], sharedMemory.fileNames[i], sharedMemory.fileHashes[i], result,
+					&sharedMemory.fileSummaries[i]);
+		}
+		
+		saveCache();
+	}
+	
+	if ((statusMain = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusMain;															/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Read the files through the ring of stream buffers.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  Every file (stdin when its name is "-") is read sequentially, with no seeking, into the next free
+ *  buffer of the ring, which is then handed to the workers. The files are only read outside the
+ *  monitor, so the workers keep processing the filled buffers meanwhile.
+ *
+ *  gzip and zstd files are decompressed here, while the workers count the buffers already decoded.
+ *  BGZF files are only cut into whole blocks, which the workers inflate themselves.
+ */
+
+void streamFiles(void)
+{
+	if (sharedMemory.ioUring)
+	{
+		ringFiles();
+		return;
+	}
+	
+	struct timespec t0;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	
+	for (int i = 0; i < sharedMemory.totalFiles; i++)
+	{
+		bool standardInput = (strcmp(sharedMemory.fileNames[i], "-") == 0);
+		int fd = standardInput ? STDIN_FILENO : open(sharedMemory.fileNames[i], O_RDONLY);
+		struct Decoder decoder;
+		int size;
+		
+		if (fd == -1 || !openDecoder(&decoder, fd))
+		{
+			fprintf(stderr, "error on opening text file \"%s\"\n", sharedMemory.fileNames[i]);
+			endStream();
+			statusReader = EXIT_FAILURE;
+			pthread_exit(&statusReader);
+		}
+		
+		bool blocks = (decoder.format == FORMAT_BGZF);
+		
+		do
+		{
+			unsigned char* buffer = requestStreamBuffer();
+			
+			/* the blocks held by a buffer never decode to more than a worker buffer */
+			if (blocks)
+				size = readBlocks(&decoder, buffer, STREAM_BUFFER_SIZE, MAX_CHUNK_SIZE);
+			else
+				size = decodeBuffer(&decoder, buffer, STREAM_BUFFER_SIZE);
+			
+			if (size == -1)
+			{
+				fprintf(stderr, "error on %s text file \"%s\"\n", (decoder.format == FORMAT_PLAIN) ? "reading" : "decompressing",
+					sharedMemory.fileNames[i]);
+				endStream();
+				statusReader = EXIT_FAILURE;
+				pthread_exit(&statusReader);
+			}
+			
+			sharedMemory.ioReads++;
+			if (size > 0)
+				postStreamBuffer(i, size, blocks);
+		} while (blocks ? (size > 0) : (size == STREAM_BUFFER_SIZE));
+		
+		sharedMemory.ioBytes += decoder.inputBytes;
+		if (decoder.format != FORMAT_PLAIN)
+		{
+			sharedMemory.compressedFiles++;
+			sharedMemory.compressedBytes += decoder.inputBytes;
+			sharedMemory.decodedBytes += decoder.outputBytes;
+		}
+		closeDecoder(&decoder);
+		
+		if (!standardInput && close(fd) == -1)
+		{
+			fprintf(stderr, "error on closing text file \"%s\"\n", sharedMemory.fileNames[i]);
+			endStream();
+			statusReader = EXIT_FAILURE;
+			pthread_exit(&statusReader);
+		}
+	}
+	
+	sharedMemory.ioTime = elapsedSince(&t0);
+	endStream();
+}
+
+/**
+ *  \brief Allocate the ring of stream buffers.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ */
+
+static void initStream(void)
+{
+	sharedMemory.totalBuffers = 2 * sharedMemory.totalWorkers;
+	
+	if ((sharedMemory.streamBuffers = malloc(sharedMemory.totalBuffers * sizeof(struct StreamBuffer))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the stream buffers\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	for (int i = 0; i < sharedMemory.totalBuffers; i++)
+	{
+		if ((sharedMemory.streamBuffers[i].data = malloc(STREAM_BUFFER_SIZE)) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the stream buffers\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		sharedMemory.streamBuffers[i].done = false;
+		sharedMemory.streamBuffers[i].compressed = false;
+	}
+	
+	/* the BGZF blocks are inflated by the workers, a corrupt one only marks its file */
+	if (!initInflaters(sharedMemory.totalWorkers) ||
+		((sharedMemory.decodeFailed = calloc(sharedMemory.totalFiles, sizeof(bool))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to the inflate streams\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	
+	/* running summary of each file, the buffer edges are joined to it in order */
+	if ((sharedMemory.fileSummaries = calloc(sharedMemory.totalFiles, sizeof(struct ChunkSummary))) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the file summaries\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+}
+
+/**
+ *  \brief Take the next filled stream buffer.
+ *
+ *  Internal monitor operation.
+ *
+ *  Waits until the reader fills a buffer or ends the stream.
+ *
+ *  \param workerId woker id
+ *  \param chunkData chunk data structure (file identifier, buffer identifier, text and its size)
+ *
+ *	\return false if the stream ended and every buffer was taken
+ */
+
+static bool takeStreamBuffer(int workerId, struct ChunkData* chunkData)
+{
+	while (sharedMemory.takePos == sharedMemory.fillPos && !sharedMemory.streamEnd)
+	{
+		probeReleased(workerId);
+		unsigned long long t0 = probeTime();
+		
+		if ((statusWorkers[workerId] = pthread_cond_wait(&waitFilled, &accessCR)) != 0)
+		{
+			errno = statusWorkers[workerId];										/* save error in errno */
+			perror("error on waiting in waitFilled");
+			statusWorkers[workerId] = EXIT_FAILURE;
+			pthread_exit(&statusWorkers[workerId]);
+		}
+		probeAcquired(workerId, PHASE_STARVED, t0);
+	}
+	
+	if (sharedMemory.takePos == sharedMemory.fillPos)
+		return false;
+	
+	int bufferId = (int) (sharedMemory.takePos % sharedMemory.totalBuffers);
+	
+	chunkData->fileId = sharedMemory.streamBuffers[bufferId].fileId;
+	chunkData->chunkId = bufferId;
+	chunkData->chunkSize = sharedMemory.streamBuffers[bufferId].size;
+	chunkData->buffer = sharedMemory.streamBuffers[bufferId].data;
+	sharedMemory.takePos++;
+	
+	return true;
+}
+
+/**
+ *  \brief Join the edges of the processed stream buffers in order.
+ *
+ *  Operation carried out by the worker.
+ *
+ *  The edges of the buffer are saved, then every processed buffer from the oldest one on is joined
+ *  to the summary of its file and given back to the reader.
+ *
+ *  \param workerId woker id
+ *  \param bufferId buffer identifier
+ *  \param edges edges of the processed buffer
+ *  \param fragments runs cut by the buffer edges, NULL if the word frequencies are not counted
+ */
+
+static void joinStreamBuffer(int workerId, int bufferId, struct ChunkEdges* edges, struct WordFragments* fragments)
+{
+	unsigned long long t0 = probeTime();
+	
+	if ((statusWorkers[workerId] = pthread_mutex_lock (&accessCR)) != 0)			/* enter monitor */
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+	sharedMemory.lockAcquisitions++;
+	probeAcquired(workerId, PHASE_LOCK_WAIT, t0);
+	
+	sharedMemory.streamBuffers[bufferId].edges = *edges;
+	if (fragments != NULL)
+		sharedMemory.streamBuffers[bufferId].fragments = *fragments;
+	sharedMemory.streamBuffers[bufferId].done = true;
+	
+	bool freed = false;
+	while (sharedMemory.joinPos < sharedMemory.takePos)
+	{
+		struct StreamBuffer* oldest = &sharedMemory.streamBuffers[sharedMemory.joinPos % sharedMemory.totalBuffers];
+		
+		if (!oldest->done)
+			break;
+		
+		joinEdges(&sharedMemory.fileSummaries[oldest->fileId], &oldest->edges);
+		/* the words completed by the join go to the table of this worker */
+		if (sharedMemory.wordFrequency)
+			joinFragments(&sharedMemory.fileRuns[oldest->fileId], &oldest->fragments, workerId);
+		oldest->done = false;
+		sharedMemory.joinPos++;
+		freed = true;
+	}
+	
+	if (freed && (statusWorkers[workerId] = pthread_cond_signal(&waitFree)) != 0)
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on signaling waitFree");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+	
+	probeReleased(workerId);
+	if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessCR)) != 0)			/* exit monitor */
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
+}
+
+/**
+ *  \brief Wait for a free stream buffer.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  The buffer belongs to the reader until it is posted.
+ *
+ *  \return buffer data
+ */
+
+static unsigned char* requestStreamBuffer(void)
+{
+	if ((statusReader = pthread_mutex_lock (&accessCR)) != 0)						/* enter monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	sharedMemory.lockAcquisitions++;
+	
+	while (sharedMemory.fillPos - sharedMemory.joinPos == sharedMemory.totalBuffers)
+	{
+		if ((statusReader = pthread_cond_wait(&waitFree, &accessCR)) != 0)
+		{
+			errno = statusReader;													/* save error in errno */
+			perror("error on waiting in waitFree");
+			statusReader = EXIT_FAILURE;
+			pthread_exit(&statusReader);
+		}
+	}
+	
+	unsigned char* buffer = sharedMemory.streamBuffers[sharedMemory.fillPos % sharedMemory.totalBuffers].data;
+	
+	if ((statusReader = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	
+	return buffer;
+}
+
+/**
+ *  \brief Hand a filled stream buffer to the workers.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param fileId file identifier
+ *  \param size number of bytes read into the buffer
+ *  \param compressed the buffer holds BGZF blocks
+ */
+
+static void postStreamBuffer(int fileId, int size, bool compressed)
+{
+	if ((statusReader = pthread_mutex_lock (&accessCR)) != 0)						/* enter monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	sharedMemory.lockAcquisitions++;
+	
+	struct StreamBuffer* filled = &sharedMemory.streamBuffers[sharedMemory.fillPos % sharedMemory.totalBuffers];
+	
+	filled->fileId = fileId;
+	filled->size = size;
+	filled->compressed = compressed;
+	sharedMemory.fillPos++;
+	
+	if ((statusReader = pthread_cond_signal(&waitFilled)) != 0)
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on signaling waitFilled");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	
+	if ((statusReader = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+}
+
+/**
+ *  \brief Mark the end of the stream.
+ *
+ *  Operation carried out by the reader, after the last file (or on a read error).
+ *
+ *  Wakes up every waiting worker, they leave once all the filled buffers were taken.
+ */
+
+static void endStream(void)
+{
+	if ((statusReader = pthread_mutex_lock (&accessCR)) != 0)						/* enter monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	sharedMemory.lockAcquisitions++;
+	
+	sharedMemory.streamEnd = true;
+	
+	if ((statusReader = pthread_cond_broadcast(&waitFilled)) != 0)
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on broadcasting waitFilled");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	
+	if ((statusReader = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+}
+
+/**
+ *  \brief Inflate the BGZF blocks of a stream buffer into the worker buffer.
+ *
+ *  Auxiliar function, carried out by the worker outside the monitor.
+ *
+ *  The stream buffer stays taken until its edges are joined, only the chunk now points to the text.
+ *  A corrupt block is left out and its file marked as incomplete.
+ *
+ *  \param workerId woker id
+ *  \param buffer worker buffer
+ *  \param chunkData chunk data structure, the buffer and size of the decoded text on return
+ */
+
+static void inflateChunk(int workerId, unsigned char* buffer, struct ChunkData* chunkData)
+{
+	int corruptBlocks;
+	int size = inflateBlocks(workerId, chunkData->buffer, chunkData->chunkSize, buffer, MAX_CHUNK_SIZE, &corruptBlocks);
+	
+	if (corruptBlocks > 0)
+	{
+		fprintf(stderr, "error on decompressing %d block(s) of text file \"%s\"\n", corruptBlocks, sharedMemory.fileNames[chunkData->fileId]);
+		__atomic_store_n(&sharedMemory.decodeFailed[chunkData->fileId], true, __ATOMIC_RELAXED);
+	}
+	
+	chunkData->buffer = buffer;
+	chunkData->chunkSize = size;
+}
+
+/**
+ *  \brief Allocate the io_uring read buffers.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  Besides the reads in flight, each worker can hold a buffer while processing it and another one
+ *  can wait for it already filled.
+ */
+
+static void initReadBuffers(void)
+{
+	sharedMemory.totalBuffers = IO_RING_DEPTH + 2 * sharedMemory.totalWorkers;
+	
+	if (((sharedMemory.readBuffers = malloc(sharedMemory.totalBuffers * sizeof(struct ReadBuffer))) == NULL) ||
+		((sharedMemory.freeBuffers = malloc(sharedMemory.totalBuffers * sizeof(int))) == NULL) ||
+		((sharedMemory.filledBuffers = malloc(sharedMemory.totalBuffers * sizeof(int))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to the read buffers\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	for (int i = 0; i < sharedMemory.totalBuffers; i++)
+	{
+		if ((sharedMemory.readBuffers[i].data = malloc(sharedMemory.chunkSize)) == NULL)
+		{
+			fprintf(stderr, "error on allocating space to the read buffers\n");
+			statusMain = EXIT_FAILURE;
+			pthread_exit(&statusMain);
+		}
+		sharedMemory.freeBuffers[i] = i;
+	}
+	sharedMemory.totalFree = sharedMemory.totalBuffers;
+	sharedMemory.filledHead = 0;
+	sharedMemory.totalFilled = 0;
+}
+
+/**
+ *  \brief Read every chunk of the files through io_uring.
+ *
+ *  Auxiliar function, carried out by the reader.
+ *
+ *  Every free buffer gets a read of the next chunk, going through the files in order, so the reads
+ *  in flight span as many files as needed. A file is opened with its first read and closed when its
+ *  last read completes. Completed buffers are handed to the workers in completion order, their
+ *  edges are joined by chunk identifier in the end.
+ */
+
+static void ringFiles(void)
+{
+	int* fds;
+	int* pendingReads;
+	int bufferIds[IO_RING_DEPTH];
+	int orderPos = 0;
+	long offset = 0;
+	int inFlight = 0;
+	int remaining = sharedMemory.totalChunks;
+	struct timespec t0;
+	
+	if (((fds = malloc(sharedMemory.totalFiles * sizeof(int))) == NULL) ||
+		((pendingReads = calloc(sharedMemory.totalFiles, sizeof(int))) == NULL))
+	{
+		fprintf(stderr, "error on allocating space to the file descriptors\n");
+		endStream();
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	
+	while (remaining > 0 || inFlight > 0)
+	{
+		/* keep the ring full, waiting for a buffer only when nothing is in flight */
+		int wanted = IO_RING_DEPTH - inFlight;
+		int taken = takeFreeBuffers(bufferIds, (remaining < wanted) ? remaining : wanted, inFlight == 0);
+		
+		for (int i = 0; i < taken; i++)
+		{
+			struct ReadBuffer* buffer = &sharedMemory.readBuffers[bufferIds[i]];
+			
+			/* skip empty files, they have no chunks */
+			while (sharedMemory.fileSizes[sharedMemory.fileOrder[orderPos]] == 0)
+				orderPos++;
+			
+			int fileId = sharedMemory.fileOrder[orderPos];
+			
+			if (offset == 0 && (fds[fileId] = open(sharedMemory.fileNames[fileId], O_RDONLY)) == -1)
+			{
+				fprintf(stderr, "error on opening text file \"%s\"\n", sharedMemory.fileNames[fileId]);
+				endStream();
+				statusReader = EXIT_FAILURE;
+				pthread_exit(&statusReader);
+			}
+			
+			/* the file is held open by a pending count of one until its last read is queued */
+			if (offset == 0)
+				pendingReads[fileId] = 1;
+			
+			long left = sharedMemory.fileSizes[fileId] - offset;
+			
+			buffer->fileId = fileId;
+			buffer->chunkId = sharedMemory.firstChunk[fileId] + (int) (offset / sharedMemory.chunkSize);
+			buffer->size = (left < sharedMemory.chunkSize) ? (int) left : sharedMemory.chunkSize;
+			buffer->read = 0;
+			buffer->offset = offset + (sharedMemory.cacheResults ? sharedMemory.fileStarts[fileId] : 0);
+			queueRead(fds[fileId], buffer->data, buffer->size, buffer->offset, bufferIds[i]);
+			pendingReads[fileId]++;
+			inFlight++;
+			remaining--;
+			
+			offset += buffer->size;
+			if (offset >= sharedMemory.fileSizes[fileId])
+			{
+				offset = 0;
+				orderPos++;
+				pendingReads[fileId]--;
+			}
+		}
+		
+		int bufferId;
+		int result = waitRead(&bufferId);
+		struct ReadBuffer* buffer = &sharedMemory.readBuffers[bufferId];
+		
+		/* the file shrank or could not be read */
+		if (result <= 0)
+		{
+			fprintf(stderr, "error on reading text file \"%s\"\n", sharedMemory.fileNames[buffer->fileId]);
+			endStream();
+			statusReader = EXIT_FAILURE;
+			pthread_exit(&statusReader);
+		}
+		
+		/* short read, read the rest of the chunk */
+		buffer->read += result;
+		if (buffer->read < buffer->size)
+		{
+			queueRead(fds[buffer->fileId], buffer->data + buffer->read, buffer->size - buffer->read,
+				buffer->offset + buffer->read, bufferId);
+			continue;
+		}
+		
+		inFlight--;
+		/* last read of a file whose reads were all queued */
+		if (--pendingReads[buffer->fileId] == 0)
+			close(fds[buffer->fileId]);
+		
+		sharedMemory.ioReads++;
+		sharedMemory.ioBytes += buffer->size;
+		postReadBuffer(bufferId);
+	}
+	
+	sharedMemory.ioTime = elapsedSince(&t0);
+	closeIoRing();
+	free(fds);
+	free(pendingReads);
+	endStream();
+}
+
+/**
+ *  \brief Take free read buffers.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param bufferIds identifiers of the buffers taken
+ *  \param wanted maximum number of buffers to take
+ *  \param wait wait for at least one buffer
+ *
+ *  \return number of buffers taken
  */
 
-void postResults(int workerId, struct FileResult fileResult, int* fileId)
+static int takeFreeBuffers(int* bufferIds, int wanted, bool wait)
 {
+	int taken = 0;
+	
+	if ((statusReader = pthread_mutex_lock (&accessCR)) != 0)						/* enter monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	sharedMemory.lockAcquisitions++;
+	
+	while (wait && wanted > 0 && sharedMemory.totalFree == 0)
+	{
+		if ((statusReader = pthread_cond_wait(&waitFree, &accessCR)) != 0)
+		{
+			errno = statusReader;													/* save error in errno */
+			perror("error on waiting in waitFree");
+			statusReader = EXIT_FAILURE;
+			pthread_exit(&statusReader);
+		}
+	}
+	
+	while (taken < wanted && sharedMemory.totalFree > 0)
+		bufferIds[taken++] = sharedMemory.freeBuffers[--sharedMemory.totalFree];
+	
+	if ((statusReader = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	
+	return taken;
+}
+
+/**
+ *  \brief Hand a filled read buffer to the workers.
+ *
+ *  Operation carried out by the reader.
+ *
+ *  \param bufferId buffer identifier
+ */
+
+static void postReadBuffer(int bufferId)
+{
+	if ((statusReader = pthread_mutex_lock (&accessCR)) != 0)						/* enter monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on entering monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	sharedMemory.lockAcquisitions++;
+	
+	int last = (sharedMemory.filledHead + sharedMemory.totalFilled) % sharedMemory.totalBuffers;
+	
+	sharedMemory.filledBuffers[last] = bufferId;
+	sharedMemory.totalFilled++;
+	
+	if ((statusReader = pthread_cond_signal(&waitFilled)) != 0)
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on signaling waitFilled");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+	
+	if ((statusReader = pthread_mutex_unlock (&accessCR)) != 0)						/* exit monitor */
+	{
+		errno = statusReader;														/* save error in errno */
+		perror("error on exiting monitor(CF)");
+		statusReader = EXIT_FAILURE;
+		pthread_exit(&statusReader);
+	}
+}
+
+/**
+ *  \brief Take the next filled read buffer.
+ *
+ *  Internal monitor operation.
+ *
+ *  Waits until the reader completes a read or ends.
+ *
+ *  \param workerId woker id
+ *  \param chunkData chunk data structure (file identifier, chunk identifier, text and its size)
+ *
+ *	\return false if the reader ended and every buffer was taken
+ */
+
+static bool takeReadBuffer(int workerId, struct ChunkData* chunkData)
+{
+	while (sharedMemory.totalFilled == 0 && !sharedMemory.streamEnd)
+	{
+		probeReleased(workerId);
+		unsigned long long t0 = probeTime();
+		
+		if ((statusWorkers[workerId] = pthread_cond_wait(&waitFilled, &accessCR)) != 0)
+		{
+			errno = statusWorkers[workerId];										/* save error in errno */
+			perror("error on waiting in waitFilled");
+			statusWorkers[workerId] = EXIT_FAILURE;
+			pthread_exit(&statusWorkers[workerId]);
+		}
+		probeAcquired(workerId, PHASE_STARVED, t0);
+	}
+	
+	if (sharedMemory.totalFilled == 0)
+		return false;
+	
+	int bufferId = sharedMemory.filledBuffers[sharedMemory.filledHead];
+	struct ReadBuffer* buffer = &sharedMemory.readBuffers[bufferId];
+	
+	sharedMemory.filledHead = (sharedMemory.filledHead + 1) % sharedMemory.totalBuffers;
+	sharedMemory.totalFilled--;
+	
+	chunkData->fileId = buffer->fileId;
+	chunkData->chunkId = buffer->chunkId;
+	chunkData->chunkSize = buffer->size;
+	chunkData->bufferId = bufferId;
+	chunkData->buffer = buffer->data;
+	
+	return true;
+}
+
+/**
+ *  \brief Give a processed read buffer back to the reader.
+ *
+ *  Operation carried out by the worker.
+ *
+ *  \param workerId woker id
+ *  \param bufferId buffer identifier
+ */
+
+static void releaseReadBuffer(int workerId, int bufferId)
+{
+	unsigned long long t0 = probeTime();
+	
 	if ((statusWorkers[workerId] = pthread_mutex_lock (&accessCR)) != 0)			/* enter monitor */
 	{
 		errno = statusWorkers[workerId];											/* save error in errno */
@@ -422,13 +2509,20 @@ void postResults(int workerId, struct FileResult fileResult, int* fileId)
 		statusWorkers[workerId] = EXIT_FAILURE;
 		pthread_exit(&statusWorkers[workerId]);
 	}
-	pthread_once(&init, initialization);                                           	/* internal data initialization */
+	sharedMemory.lockAcquisitions++;
+	probeAcquired(workerId, PHASE_LOCK_WAIT, t0);
 	
-	/* post obtained results */
-	sharedMemory.fileResults[*fileId].nWords += fileResult.nWords;
-	for (int i = 0; i < 6; i++)
-		sharedMemory.fileResults[*fileId].vowels[i] += fileResult.vowels[i];
+	sharedMemory.freeBuffers[sharedMemory.totalFree++] = bufferId;
+	
+	if ((statusWorkers[workerId] = pthread_cond_signal(&waitFree)) != 0)
+	{
+		errno = statusWorkers[workerId];											/* save error in errno */
+		perror("error on signaling waitFree");
+		statusWorkers[workerId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[workerId]);
+	}
 	
+	probeReleased(workerId);
 	if ((statusWorkers[workerId] = pthread_mutex_unlock (&accessCR)) != 0)			/* exit monitor */
 	{
 		errno = statusWorkers[workerId];											/* save error in errno */
@@ -437,3 +2531,118 @@ void postResults(int workerId, struct FileResult fileResult, int* fileId)
 		pthread_exit(&statusWorkers[workerId]);
 	}
 }
+
+/**
+ *  \brief Time elapsed since a given instant.
+ *
+ *  Auxiliar function.
+ *
+ *  \param t0 starting instant
+ *
+ *  \return elapsed time in seconds
+ */
+
+static double elapsedSince(struct timespec* t0)
+{
+	struct timespec t1;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return (double) (t1.tv_sec - t0->tv_sec) + 1.0e-9 * (double) (t1.tv_nsec - t0->tv_nsec);
+}
+
+/**
+ *  \brief Choose the chunk unit from the measured costs.
+ *
+ *  Auxiliar function, carried out by main while filling the shared region.
+ *
+ *  The decode time per byte and the fixed cost of a chunk (a monitor round trip, a system call and
+ *  the kernel call on an empty chunk) are measured on a sample text. The unit is the smallest power
+ *  of two that takes CHUNK_OVERHEAD times the fixed cost to decode, but small inputs get smaller
+ *  units so that every worker still gets some chunks.
+ *
+ *  \param totalBytes total size of the files
+ *
+ *  \return chunk unit size
+ */
+
+static int calibrateChunkSize(long totalBytes)
+{
+	static const char sample[] = "Não há machado que corte a raiz ao pensamento, “disse” ele – e calou-se… ";
+	static const int sampleSize = 1 << 16;
+	static const int probes = 1000;
+	pthread_mutex_t probe = PTHREAD_MUTEX_INITIALIZER;
+	unsigned char* buffer;
+	struct timespec t0;
+	
+	if ((buffer = malloc(sampleSize)) == NULL)
+	{
+		fprintf(stderr, "error on allocating space to the calibration sample\n");
+		statusMain = EXIT_FAILURE;
+		pthread_exit(&statusMain);
+	}
+	for (int i = 0; i < sampleSize; i++)
+		buffer[i] = sample[i % (sizeof(sample) - 1)];
+	
+	/* decode time per byte, best of a few runs */
+	double byteTime = 1.0;
+	for (int i = 0; i < 4; i++)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		(void) processChunk(buffer, sampleSize);
+		double t = elapsedSince(&t0) / sampleSize;
+		if (t < byteTime)
+			byteTime = t;
+	}
+	
+	/* fixed cost of a chunk */
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < probes; i++)
+	{
+		pthread_mutex_lock(&probe);
+		pthread_mutex_unlock(&probe);
+		(void) getppid();
+		(void) processChunk(buffer, 0);
+	}
+	double chunkTime = elapsedSince(&t0) / probes;
+	
+	free(buffer);
+	
+	int chunkSize = MIN_CHUNK_SIZE;
+	while (chunkSize < MAX_CHUNK_SIZE && chunkSize * byteTime < CHUNK_OVERHEAD * chunkTime)
+		chunkSize *= 2;
+	while (chunkSize > MIN_CHUNK_SIZE && (long) chunkSize * GUIDED_FACTOR * sharedMemory.totalWorkers > totalBytes)
+		chunkSize /= 2;
+	
+	return chunkSize;
+}
+
+/**
+ *  \brief Size of the next chunk handed out.
+ *
+ *  Auxiliar function.
+ *
+ *  Guided chunks are a share of the bytes not yet handed out, so they are large at the start of
+ *  the run and shrink down to the chunk unit toward its end. They are always a multiple of the unit,
+ *  but for the last chunk of a file.
+ *
+ *  \param remaining bytes of all the files not yet handed out
+ *  \param fileLeft bytes of the current file not yet handed out
+ *
+ *  \return chunk size
+ */
+
+static int nextChunkSize(long remaining, long fileLeft)
+{
+	long size = sharedMemory.chunkSize;
+	
+	if (sharedMemory.guidedChunks)
+	{
+		size = remaining / (GUIDED_FACTOR * sharedMemory.totalWorkers) / sharedMemory.chunkSize * sharedMemory.chunkSize;
+		if (size > MAX_CHUNK_SIZE)
+			size = MAX_CHUNK_SIZE / sharedMemory.chunkSize * sharedMemory.chunkSize;
+		if (size < sharedMemory.chunkSize)
+			size = sharedMemory.chunkSize;
+	}
+	
+	return (fileLeft < size) ? (int) fileLeft : (int) size;
+}
@@ -13,7 +13,11 @@
  *     \li fillSharedMem
  *     \li printResults
  *     \li requestChunk
- *     \li postResults.
+ *     \li postResults
+ *     \li mergeResults
+ *     \li joinChunks
+ *     \li cacheResults
+ *     \li streamFiles.
  *
  *  \author Author Name - Month Year
  */
@@ -26,10 +30,11 @@
  *
  *  Operation carried out by main.
  *
- *  \param fileNames array of file names to be proceced
+ *  \param fileNames null terminated array of file names to be proceced
+ *  \param options command line options (io_uring is turned off when not available)
  */
 
-extern void fillSharedMem(char** fileNames);
+extern void fillSharedMem(char** fileNames, struct Options* options);
 
 /**
  *  \brief Print file results.
@@ -44,26 +49,63 @@ extern void printResults(void);
  *
  *  Operation carried out by the worker.
  *
+ *  When the files are memory mapped the chunk points straight into the mapping and the worker
+ *  buffer is left untouched.
+ *
  *  \param workerId woker id
  *  \param buffer buffer to store the text chunk
- *  \param fileId file identifier
- *  \param chunkSize size of the requested chunk
+ *  \param chunkData chunk data structure (file identifier, chunk text and its size)
  *
  *	\return false if all files were parsed
  */
 
-extern bool requestChunk(int workerId, unsigned char* buffer, int* fileId, int* chunkSize);
+extern bool requestChunk(int workerId, unsigned char* buffer, struct ChunkData* chunkData);
 
 /**
- *  \brief Save processed results in shared memory.
+ *  \brief Save processed results in the worker private results.
  *
  *  Operation carried by the worker.
  *
  *  \param workerId worker id
- *  \param fileResult file result structure
- *  \param fileId file identifier
+ *  \param chunkSummary chunk summary structure
+ *  \param fragments runs cut by the chunk edges, NULL if the word frequencies are not counted
+ *  \param chunkData chunk data structure
+ */
+
+extern void postResults(int workerId, struct ChunkSummary chunkSummary, struct WordFragments* fragments, struct ChunkData* chunkData);
+
+/**
+ *  \brief Merge the private results of a worker into the file results.
+ *
+ *  Operation carried out by main, after joining the worker.
+ *
+ *  \param workerId worker id
+ */
+
+extern void mergeResults(int workerId);
+
+/**
+ *  \brief Join the edges of the chunks of every file.
+ *
+ *  Operation carried out by main, after joining all the workers.
+ */
+
+extern void joinChunks(void);
+
+/**
+ *  \brief Complete the results of the duplicate files and store the counted ones in the cache.
+ *
+ *  Operation carried out by main, after joining the chunks.
+ */
+
+extern void cacheResults(void);
+
+/**
+ *  \brief Read the files through the ring of stream buffers, or through io_uring.
+ *
+ *  Operation carried out by the reader.
  */
 
-extern void postResults(int workerId, struct FileResult fileResult, int* fileId);
+extern void streamFiles(void);
 
-#endif /* SHAREDMEMORY_H */
+#endif /* SHAREDMEMORY_H */
\ No newline at end of file
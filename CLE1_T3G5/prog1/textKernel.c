@@ -0,0 +1,1302 @@
+/**
+ *  \file textKernel.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Text processing kernel.
+ *
+ *  Byte level utf-8 decoder, which also finds the malformed sequences, and character classifier
+ *  driven by precomputed tables, used by the workers (chunk processing) and main (joining the chunks
+ *  of a file):
+ *     \li initDecoder
+ *     \li processChunk
+ *     \li processChunkMetrics
+ *     \li processChunkWords
+ *     \li countWordRuns
+ *     \li joinEdges
+ *     \li addSummary.
+ *
+ *  Each table entry holds the next decoder state (low nibble), whether the byte ends a malformed
+ *  sequence (next two bits) and the class of the char completed by the byte (high byte). Bytes in
+ *  the middle of a multi-byte char complete nothing and are classified as CHAR_OTHER, which leaves
+ *  the word state untouched, so every byte goes through the very same steps.
+ *
+ *  The decoder also validates the utf-8 text: overlong chars, surrogates and chars past U+10FFFF are
+ *  rejected at their second byte, so the malformed sequences are found by the very same table
+ *  lookup, without a pass of their own (the ascii fast path only takes ascii bytes, which are always
+ *  valid). Each maximal malformed sequence, the longest start of a valid char or else a single byte,
+ *  counts once and stands for a char that is neither a word character nor a separator, as U+FFFD
+ *  would. The decoder then goes on with the next byte, so a truncated char never swallows the bytes
+ *  that follow it.
+ *
+ *  A chunk can start at any offset, the words and chars cut by its edges are kept apart in its
+ *  summary and completed when the summaries of a file are joined in order.
+ *
+ *  The text metrics are counted from the same table entries: a byte completes a char when it takes
+ *  the decoder back to the ground state, and a malformed sequence ended by it is one more char. Only
+ *  the chosen ones are counted: the bytes and the newlines need no decoding and keep the ascii fast
+ *  path, the word lengths and the accented letters are only looked at when chosen.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "consts.h"
+#include "textKernel.h"
+#include "wordFreq.h"
+
+/* Char classes */
+
+/** \brief neither a word character nor a separator */
+#define CHAR_OTHER          0
+
+/** \brief separator (space, punctuation or separation symbol) */
+#define CHAR_SEPARATOR      1
+
+/** \brief alpha numeric character or underscore which is not a vowel */
+#define CHAR_WORD           2
+
+/** \brief first vowel class, followed by the remaining ones in the A to Y offset order */
+#define CHAR_VOWEL          3
+
+/* Decoder states */
+
+/** \brief waiting for the first byte of a char */
+#define STATE_GROUND        0
+
+/** \brief waiting for the second byte of a 0xC3 char (accented latin letters) */
+#define STATE_C3            1
+
+/** \brief waiting for the second byte of a 0xE2 char (typographic punctuation) */
+#define STATE_E2            2
+
+/** \brief waiting for the third byte of a 0xE2 0x80 char */
+#define STATE_E280          3
+
+/** \brief skipping the remaining byte of a char, followed by the states skipping 2 and 3 bytes */
+#define STATE_SKIP          4
+
+/** \brief waiting for the second byte of a 0xE0 char (0xA0 to 0xBF, shorter forms are overlong) */
+#define STATE_E0            7
+
+/** \brief waiting for the second byte of a 0xED char (0x80 to 0x9F, higher ones are surrogates) */
+#define STATE_ED            8
+
+/** \brief waiting for the second byte of a 0xF0 char (0x90 to 0xBF, shorter forms are overlong) */
+#define STATE_F0            9
+
+/** \brief waiting for the second byte of a 0xF4 char (0x80 to 0x8F, higher ones are past U+10FFFF) */
+#define STATE_F4            10
+
+/** \brief number of decoder states */
+#define DECODER_STATES      11
+
+/* Decoder entry flags */
+
+/** \brief the byte cannot continue the uncomplete char, which is malformed, and starts a new one */
+#define ENTRY_CUT_CHAR      0x10
+
+/** \brief the byte cannot start a char either, it is malformed by itself */
+#define ENTRY_BAD_BYTE      0x20
+
+/** \brief the byte ends one or two malformed sequences */
+#define ENTRY_INVALID       (ENTRY_CUT_CHAR | ENTRY_BAD_BYTE)
+
+#if defined(__AVX2__) || defined(__SSE2__)
+/** \brief ascii fast path is available */
+#define SIMD_ASCII
+
+#if defined(__AVX2__)
+/** \brief bytes classified at once by the ascii fast path */
+#define SIMD_WIDTH 32
+#else
+/** \brief bytes classified at once by the ascii fast path */
+#define SIMD_WIDTH 16
+#endif
+
+/** \brief bit masks of a classified block of bytes (bit i refers to byte i) */
+struct AsciiMasks {
+	uint64_t high;
+	uint64_t word;
+	uint64_t separator;
+	uint64_t vowels[6];
+};
+#endif
+
+/** \brief ascii separators */
+static const char separators[] = " \t\n\r-\"[]().,:;?!";
+
+/** \brief base letter of the 0xC3 0x80 to 0xBF chars (same layout for upper and lower case) */
+static const char foldedLatin1[32] = {
+	'A', 'A', 'A', 'A',  0,   0,   0,  'C', 'E', 'E', 'E',  0,  'I', 'I',  0,   0,
+	 0,   0,  'O', 'O', 'O', 'O',  0,   0,   0,  'U', 'U',  0,   0,   0,   0,   0
+};
+
+/** \brief accent offset of the 0xC3 0x80 to 0xBF chars, -1 for the letters not counted (same layout
+    for upper and lower case) */
+static const signed char accentOffset[32] = {
+	 0,  1,  2,  3, -1, -1, -1,  4, -1,  5,  6, -1, -1,  7, -1, -1,
+	-1, -1, -1,  8,  9, 10, -1, -1, -1, -1, 11, -1, -1, -1, -1, -1
+};
+
+/** \brief decoder transition table (next state, malformed sequences and completed char class) */
+static unsigned short decoderTable[DECODER_STATES][256];
+
+/** \brief class is a word character */
+static const unsigned int classWord[16] = { 0, 0, 1, 1, 1, 1, 1, 1, 1 };
+
+/** \brief class is a separator */
+static const unsigned int classSeparator[16] = { 0, 1 };
+
+/** \brief vowel bit of the class */
+static const unsigned int classVowelBit[16] = { 0, 0, 0, 1 << A, 1 << E, 1 << I, 1 << O, 1 << U, 1 << Y };
+
+/** \brief vowel offset of the class (non vowels are counted in a spare offset) */
+static const unsigned int classVowel[16] = { 6, 6, 6, A, E, I, O, U, Y, 6, 6, 6, 6, 6, 6, 6 };
+
+/** \brief class of an ascii char */
+static int asciiClass(int c);
+
+/** \brief leave the word and the char open at the end of a chunk in its summary */
+static void endChunk(struct ChunkSummary* summary, unsigned char* buffer, int chunkSize, unsigned int state, unsigned int inWord,
+	unsigned int vowelMask, int nWords, int vowels[7]);
+
+/** \brief fold a complete char of a word */
+static int foldChar(unsigned char* folded, unsigned char* bytes, int len);
+
+/** \brief fold the malformed sequences ended by a byte of a word */
+static int foldInvalid(int tableId, int wordLen, unsigned int entry);
+
+/** \brief close a run of chars ended by a separator */
+static void closeRun(struct ChunkSummary* summary, bool word, unsigned int vowelMask, long chars);
+
+/** \brief process a text chunk, counting the chosen text metrics that need the chars decoded */
+static inline struct ChunkSummary decodeMetrics(unsigned char* buffer, int chunkSize, unsigned int selected);
+
+/** \brief count the newlines of a chunk */
+static long countLines(unsigned char* buffer, int chunkSize);
+
+/** \brief count the chosen text metrics of a decoded byte */
+static inline long countMetrics(struct TextMetrics* metrics, unsigned int selected, unsigned char byte, unsigned int state, unsigned int entry);
+
+/** \brief count a word in the word length metric */
+static void countLength(struct TextMetrics* metrics, long chars);
+
+/** \brief keep the malformed sequences ended by a byte */
+static void keepInvalid(struct ChunkEdges* edges, unsigned char* bytes, int pos, unsigned int entry, long base);
+
+/** \brief add malformed sequences after the ones already kept */
+static void addInvalid(long* invalid, long invalidAt[INVALID_OFFSETS], long count, long* offsets, long base);
+
+#ifdef SIMD_ASCII
+/** \brief classify a block of bytes */
+static void classifyBlock(unsigned char* block, struct AsciiMasks* masks);
+
+/** \brief process a run of ascii characters */
+static void processAsciiRun(struct AsciiMasks* masks, int runLen, unsigned int* inWord, int* nWords, int vowels[7], unsigned int* vowelMask);
+#endif
+
+/**
+ *  \brief Fill the decoder tables.
+ *
+ *  Operation carried out by main, before any other kernel operation.
+ */
+
+void initDecoder(void)
+{
+	for (int b = 0; b < 256; b++)
+	{
+		int state = STATE_GROUND;
+		int class = CHAR_OTHER;
+		int flags = 0;
+		
+		// ascii char
+		if ((b & 0x80) == 0)
+			class = asciiClass(b);
+		// stray continuation byte, overlong two byte char or char past U+10FFFF
+		else if (b < 0xC2 || b > 0xF4)
+			flags = ENTRY_BAD_BYTE;
+		else if (b == 0xC3)
+			state = STATE_C3;
+		else if (b == 0xE2)
+			state = STATE_E2;
+		else if (b == 0xE0)
+			state = STATE_E0;
+		else if (b == 0xED)
+			state = STATE_ED;
+		else if (b == 0xF0)
+			state = STATE_F0;
+		else if (b == 0xF4)
+			state = STATE_F4;
+		// any other leading byte, skip its remaining bytes
+		else
+			state = (b < 0xE0) ? STATE_SKIP : (b < 0xF0) ? STATE_SKIP + 1 : STATE_SKIP + 2;
+		decoderTable[STATE_GROUND][b] = state | flags | (class << 8);
+		
+		// a byte the uncomplete char cannot go on with ends it as malformed and starts a new one
+		for (state = STATE_C3; state < DECODER_STATES; state++)
+			decoderTable[state][b] = decoderTable[STATE_GROUND][b] | ENTRY_CUT_CHAR;
+		if ((b & 0xC0) != 0x80)
+			continue;
+		
+		// accented latin letters are folded to their base letter
+		class = CHAR_OTHER;
+		if (foldedLatin1[b & 0x1F] != 0)
+			class = asciiClass(foldedLatin1[b & 0x1F]);
+		decoderTable[STATE_C3][b] = STATE_GROUND | (class << 8);
+		
+		decoderTable[STATE_E2][b] = (b == 0x80) ? STATE_E280 : STATE_SKIP;
+		
+		// left and right double quotation marks, en dash and horizontal ellipsis
+		class = (b == 0x9C || b == 0x9D || b == 0x93 || b == 0xA6) ? CHAR_SEPARATOR : CHAR_OTHER;
+		decoderTable[STATE_E280][b] = STATE_GROUND | (class << 8);
+		
+		decoderTable[STATE_SKIP][b] = STATE_GROUND;
+		for (int i = 1; i < 3; i++)
+			decoderTable[STATE_SKIP + i][b] = STATE_SKIP + i - 1;
+		
+		// second bytes of the leading bytes whose range is narrower
+		if (b >= 0xA0)
+			decoderTable[STATE_E0][b] = STATE_SKIP;
+		if (b < 0xA0)
+			decoderTable[STATE_ED][b] = STATE_SKIP;
+		if (b >= 0x90)
+			decoderTable[STATE_F0][b] = STATE_SKIP + 1;
+		if (b < 0x90)
+			decoderTable[STATE_F4][b] = STATE_SKIP + 1;
+	}
+}
+
+/**
+ *  \brief Class of an ascii char.
+ *
+ *	\param c character
+ *
+ *	\return char class
+ */
+
+static int asciiClass(int c)
+{
+	static const char vowels[6] = { 'A', 'E', 'I', 'O', 'U', 'Y' };
+	
+	c = toupper(c);
+	
+	for (int i = 0; i < 6; i++)
+		if (c == vowels[i])
+			return CHAR_VOWEL + i;
+	
+	if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')
+		return CHAR_WORD;
+	
+	if (c != '\0' && strchr(separators, c) != NULL)
+		return CHAR_SEPARATOR;
+	
+	return CHAR_OTHER;
+}
+
+/**
+ *  \brief Process a text chunk.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  Each byte goes through the decoder table and the completed char class updates the word state
+ *  without branching: a word character outside a word starts a new one (clearing its vowel mask),
+ *  a vowel not yet in the mask is counted and a separator ends the word.
+ *
+ *  When SSE2 or AVX2 is available, the chunk is classified SIMD_WIDTH bytes at a time and runs of
+ *  ascii characters are processed in bulk. The tables are only used for the bytes with the most
+ *  significant bit set and for the chunk tail.
+ *
+ *  Only the words between the first and the last separators are counted, the chars before the
+ *  first one and after the last one (and the bytes of utf-8 chars cut by the chunk edges) are left
+ *  in the summary edges, to be joined with the neighbour chunks.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *
+ *  \return chunk summary
+ */
+
+struct ChunkSummary processChunk(unsigned char* buffer, int chunkSize)
+{
+	struct ChunkSummary summary;
+	struct ChunkEdges* edges = &summary.edges;
+	unsigned int state = STATE_GROUND;
+	unsigned int inWord = 0;
+	unsigned int vowelMask = 0;
+	int nWords = 0;
+	int vowels[7] = { 0 };
+	int curPos = 0;
+	
+	memset(edges, 0, sizeof(struct ChunkEdges));
+	memset(&summary.metrics, 0, sizeof(struct TextMetrics));
+	edges->size = chunkSize;
+	
+	/* leading continuation bytes, they may complete the last char of the previous chunk */
+	while (curPos < chunkSize && edges->headLen < MAX_CHAR_BYTES - 1 && (buffer[curPos] & 0xC0) == 0x80)
+		edges->headBytes[edges->headLen++] = buffer[curPos++];
+	
+	/* the whole chunk is in the middle of a char, it is completed when joining the chunks */
+	edges->headOnly = (curPos == chunkSize);
+	
+	/* chars before the first separator, they may continue the last word of the previous chunk */
+	while (curPos < chunkSize && !edges->separator)
+	{
+		unsigned int entry = decoderTable[state][buffer[curPos++]];
+		unsigned int class = entry >> 8;
+		
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, buffer, curPos - 1, entry, 0);
+		edges->separator = classSeparator[class];
+		edges->headWord |= classWord[class];
+		edges->headVowels |= classVowelBit[class];
+	}
+	
+	while (curPos < chunkSize)
+	{
+#ifdef SIMD_ASCII
+		if (state == STATE_GROUND && chunkSize - curPos >= SIMD_WIDTH)
+		{
+			struct AsciiMasks masks;
+			
+			classifyBlock(buffer + curPos, &masks);
+			
+			/* ascii run ends at the first byte with the most significant bit set */
+			int runLen = (masks.high == 0) ? SIMD_WIDTH : __builtin_ctzll(masks.high);
+			
+			processAsciiRun(&masks, runLen, &inWord, &nWords, vowels, &vowelMask);
+			curPos += runLen;
+			
+			if (runLen == SIMD_WIDTH)
+				continue;
+		}
+#endif
+		
+		unsigned int entry = decoderTable[state][buffer[curPos++]];
+		unsigned int class = entry >> 8;
+		unsigned int start = classWord[class] & ~inWord;
+		
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, buffer, curPos - 1, entry, 0);
+		nWords += start;
+		vowelMask &= start - 1;
+		vowels[classVowel[class]] += (classVowelBit[class] & ~vowelMask) != 0;
+		vowelMask |= classVowelBit[class];
+		inWord = (inWord | classWord[class]) & ~classSeparator[class];
+	}
+	
+	endChunk(&summary, buffer, chunkSize, state, inWord, vowelMask, nWords, vowels);
+	
+	return summary;
+}
+
+/**
+ *  \brief Process a text chunk, counting its text metrics.
+ *
+ *  Operation carried out by the workers, when text metrics are counted.
+ *
+ *  Same summary as processChunk, with the chosen metrics of the chunk. The bytes and the newlines
+ *  keep the ascii fast path of processChunk, the newlines are then counted in a pass of their own
+ *  over the chunk still in the cache. The chars, the word lengths and the accented letters need
+ *  every char decoded, each choice of the newlines, the lengths and the accents gets its own copy of
+ *  the decoding loop, without the steps of the metrics not chosen.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *	\param selected metric flags
+ *
+ *  \return chunk summary
+ */
+
+struct ChunkSummary processChunkMetrics(unsigned char* buffer, int chunkSize, unsigned int selected)
+{
+	if ((selected & (METRIC_CHARS | METRIC_LENGTHS | METRIC_ACCENTS)) == 0)
+	{
+		struct ChunkSummary summary = processChunk(buffer, chunkSize);
+		
+		summary.metrics.bytes = chunkSize;
+		if (selected & METRIC_LINES)
+			summary.metrics.lines = countLines(buffer, chunkSize);
+		return summary;
+	}
+	
+	switch (selected & (METRIC_LINES | METRIC_LENGTHS | METRIC_ACCENTS))
+	{
+		case 0:
+			return decodeMetrics(buffer, chunkSize, 0);
+		case METRIC_LINES:
+			return decodeMetrics(buffer, chunkSize, METRIC_LINES);
+		case METRIC_LENGTHS:
+			return decodeMetrics(buffer, chunkSize, METRIC_LENGTHS);
+		case METRIC_LINES | METRIC_LENGTHS:
+			return decodeMetrics(buffer, chunkSize, METRIC_LINES | METRIC_LENGTHS);
+		case METRIC_ACCENTS:
+			return decodeMetrics(buffer, chunkSize, METRIC_ACCENTS);
+		case METRIC_LINES | METRIC_ACCENTS:
+			return decodeMetrics(buffer, chunkSize, METRIC_LINES | METRIC_ACCENTS);
+		case METRIC_LENGTHS | METRIC_ACCENTS:
+			return decodeMetrics(buffer, chunkSize, METRIC_LENGTHS | METRIC_ACCENTS);
+		default:
+			return decodeMetrics(buffer, chunkSize, METRIC_LINES | METRIC_LENGTHS | METRIC_ACCENTS);
+	}
+}
+
+/**
+ *  \brief Process a text chunk, counting the chosen text metrics that need the chars decoded.
+ *
+ *  Auxiliar function, inlined by processChunkMetrics with constant metric flags.
+ *
+ *  Same summary as processChunk, from the same table driven steps but without the ascii fast path,
+ *  with the metrics of the chunk counted in the same pass: its bytes, the chars completed by its
+ *  bytes and, when chosen, its newlines, its accented letters and the length of the words between
+ *  its first and last separators. The chars of the runs before the first separator and after the
+ *  last one are left in the summary edges, the words they belong to are measured when joining the
+ *  chunks.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *	\param selected metric flags
+ *
+ *  \return chunk summary
+ */
+
+static inline __attribute__((always_inline)) struct ChunkSummary decodeMetrics(unsigned char* buffer, int chunkSize, unsigned int selected)
+{
+	struct ChunkSummary summary;
+	struct ChunkEdges* edges = &summary.edges;
+	struct TextMetrics* metrics = &summary.metrics;
+	unsigned int state = STATE_GROUND;
+	unsigned int inWord = 0;
+	unsigned int vowelMask = 0;
+	int nWords = 0;
+	int vowels[7] = { 0 };
+	int curPos = 0;
+	long runChars = 0;
+	
+	memset(edges, 0, sizeof(struct ChunkEdges));
+	memset(metrics, 0, sizeof(struct TextMetrics));
+	edges->size = metrics->bytes = chunkSize;
+	
+	/* leading continuation bytes, they may complete the last char of the previous chunk */
+	while (curPos < chunkSize && edges->headLen < MAX_CHAR_BYTES - 1 && (buffer[curPos] & 0xC0) == 0x80)
+		edges->headBytes[edges->headLen++] = buffer[curPos++];
+	
+	edges->headOnly = (curPos == chunkSize);
+	
+	/* chars before the first separator */
+	while (curPos < chunkSize && !edges->separator)
+	{
+		unsigned int entry = decoderTable[state][buffer[curPos]];
+		unsigned int class = entry >> 8;
+		
+		runChars += countMetrics(metrics, selected, buffer[curPos++], state, entry) - classSeparator[class];
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, buffer, curPos - 1, entry, 0);
+		edges->separator = classSeparator[class];
+		edges->headWord |= classWord[class];
+		edges->headVowels |= classVowelBit[class];
+	}
+	
+	edges->headChars = runChars;
+	runChars = 0;
+	
+	while (curPos < chunkSize)
+	{
+		unsigned int entry = decoderTable[state][buffer[curPos]];
+		unsigned int class = entry >> 8;
+		unsigned int start = classWord[class] & ~inWord;
+		
+		runChars += countMetrics(metrics, selected, buffer[curPos++], state, entry) - classSeparator[class];
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, buffer, curPos - 1, entry, 0);
+		nWords += start;
+		vowelMask &= start - 1;
+		vowels[classVowel[class]] += (classVowelBit[class] & ~vowelMask) != 0;
+		vowelMask |= classVowelBit[class];
+		if (classSeparator[class])
+		{
+			if ((selected & METRIC_LENGTHS) && inWord)
+				countLength(metrics, runChars);
+			runChars = 0;
+		}
+		inWord = (inWord | classWord[class]) & ~classSeparator[class];
+	}
+	
+	endChunk(&summary, buffer, chunkSize, state, inWord, vowelMask, nWords, vowels);
+	edges->tailChars = runChars;
+	
+	return summary;
+}
+
+/**
+ *  \brief Process a text chunk, counting every word in the word table of the worker.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  Same summary as processChunk, from the same table driven steps but without the ascii fast path,
+ *  since every char of a word has to be folded anyway. The chars of each word are folded into the
+ *  arena of the table as they are decoded, and the word is inserted when its separator is found.
+ *
+ *  The runs before the first separator and after the last one are left as raw bytes in the chunk
+ *  fragments, to be joined with the neighbour chunks like the summary edges. The chosen text metrics
+ *  are counted as in processChunkMetrics, from the chars already decoded.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *	\param tableId word table of the worker
+ *	\param fragments raw bytes of the runs cut by the chunk edges, kept in the arena
+ *	\param selected metric flags, 0 when no text metric is counted
+ *
+ *  \return chunk summary
+ */
+
+struct ChunkSummary processChunkWords(unsigned char* buffer, int chunkSize, int tableId, struct WordFragments* fragments, unsigned int selected)
+{
+	struct ChunkSummary summary;
+	struct ChunkEdges* edges = &summary.edges;
+	struct TextMetrics* metrics = &summary.metrics;
+	struct WordArena* arena = &wordTable(tableId)->arena;
+	unsigned int state = STATE_GROUND;
+	unsigned int inWord = 0;
+	unsigned int vowelMask = 0;
+	int nWords = 0;
+	int vowels[7] = { 0 };
+	int curPos = 0;
+	int charStart = 0;
+	int wordLen = 0;
+	long runChars = 0;
+	
+	memset(edges, 0, sizeof(struct ChunkEdges));
+	memset(metrics, 0, sizeof(struct TextMetrics));
+	edges->size = metrics->bytes = chunkSize;
+	
+	/* leading continuation bytes, they may complete the last char of the previous chunk */
+	while (curPos < chunkSize && edges->headLen < MAX_CHAR_BYTES - 1 && (buffer[curPos] & 0xC0) == 0x80)
+		edges->headBytes[edges->headLen++] = buffer[curPos++];
+	
+	edges->headOnly = (curPos == chunkSize);
+	
+	/* chars before the first separator */
+	while (curPos < chunkSize && !edges->separator)
+	{
+		if (state == STATE_GROUND || (buffer[curPos] & 0xC0) != 0x80)
+			charStart = curPos;
+		
+		unsigned int entry = decoderTable[state][buffer[curPos]];
+		unsigned int class = entry >> 8;
+		
+		runChars += countMetrics(metrics, selected, buffer[curPos++], state, entry) - classSeparator[class];
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, buffer, curPos - 1, entry, 0);
+		edges->separator = classSeparator[class];
+		edges->headWord |= classWord[class];
+		edges->headVowels |= classVowelBit[class];
+	}
+	
+	fragments->separator = edges->separator;
+	fragments->head = keepBytes(tableId, buffer, edges->separator ? charStart : chunkSize);
+	fragments->headLen = edges->separator ? charStart : chunkSize;
+	edges->headChars = runChars;
+	runChars = 0;
+	
+	int runStart = curPos;
+	
+	while (curPos < chunkSize)
+	{
+		if (state == STATE_GROUND || (buffer[curPos] & 0xC0) != 0x80)
+			charStart = curPos;
+		
+		unsigned int entry = decoderTable[state][buffer[curPos]];
+		unsigned int class = entry >> 8;
+		unsigned int start = classWord[class] & ~inWord;
+		
+		runChars += countMetrics(metrics, selected, buffer[curPos++], state, entry) - classSeparator[class];
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, buffer, curPos - 1, entry, 0);
+		nWords += start;
+		vowelMask &= start - 1;
+		vowels[classVowel[class]] += (classVowelBit[class] & ~vowelMask) != 0;
+		vowelMask |= classVowelBit[class];
+		
+		/* the chars of a run are folded once complete, the run is inserted if it was a word (malformed
+		   sequences are folded as U+FFFD) */
+		if (entry & ENTRY_INVALID)
+			wordLen += foldInvalid(tableId, wordLen, entry);
+		if (state == STATE_GROUND)
+		{
+			if (classSeparator[class])
+			{
+				if (inWord)
+				{
+					insertWord(tableId, wordLen);
+					if (selected & METRIC_LENGTHS)
+						countLength(metrics, runChars);
+				}
+				wordLen = 0;
+				runChars = 0;
+				runStart = curPos;
+			}
+			else if ((entry & ENTRY_BAD_BYTE) == 0)
+			{
+				if (arena->end - arena->top - wordLen < MAX_CHAR_BYTES)
+					growArena(tableId, wordLen);
+				wordLen += foldChar(arena->top + wordLen, buffer + charStart, curPos - charStart);
+			}
+		}
+		
+		inWord = (inWord | classWord[class]) & ~classSeparator[class];
+	}
+	
+	/* the run still open at the end is left to the join, the chars folded are dropped */
+	if (edges->separator)
+	{
+		fragments->tail = keepBytes(tableId, buffer + runStart, chunkSize - runStart);
+		fragments->tailLen = chunkSize - runStart;
+	}
+	else
+	{
+		fragments->tail = NULL;
+		fragments->tailLen = 0;
+	}
+	
+	endChunk(&summary, buffer, chunkSize, state, inWord, vowelMask, nWords, vowels);
+	edges->tailChars = runChars;
+	
+	return summary;
+}
+
+/**
+ *  \brief Count the words of runs of complete chars in a word table.
+ *
+ *  Operation carried out by the threads joining the chunk fragments of a file.
+ *
+ *  The bytes start right after a separator (or at the start of the file) and end right before one
+ *  (or at the end of the file), so they are decoded from the ground state and their last run is a
+ *  complete word. The chars are folded as in processChunkWords.
+ *
+ *	\param bytes bytes of the runs
+ *	\param len number of bytes
+ *	\param tableId word table of the thread
+ */
+
+void countWordRuns(unsigned char* bytes, int len, int tableId)
+{
+	struct WordArena* arena = &wordTable(tableId)->arena;
+	unsigned int state = STATE_GROUND;
+	unsigned int inWord = 0;
+	int charStart = 0;
+	int wordLen = 0;
+	
+	for (int curPos = 0; curPos < len; )
+	{
+		if (state == STATE_GROUND || (bytes[curPos] & 0xC0) != 0x80)
+			charStart = curPos;
+		
+		unsigned int entry = decoderTable[state][bytes[curPos++]];
+		unsigned int class = entry >> 8;
+		
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			wordLen += foldInvalid(tableId, wordLen, entry);
+		if (state != STATE_GROUND)
+			continue;
+		
+		if (classSeparator[class])
+		{
+			if (inWord)
+				insertWord(tableId, wordLen);
+			wordLen = 0;
+			inWord = 0;
+			continue;
+		}
+		if (entry & ENTRY_BAD_BYTE)
+			continue;
+		
+		if (arena->end - arena->top - wordLen < MAX_CHAR_BYTES)
+			growArena(tableId, wordLen);
+		wordLen += foldChar(arena->top + wordLen, bytes + charStart, curPos - charStart);
+		inWord |= classWord[class];
+	}
+	
+	/* a char still uncomplete is cut by the separator after the runs (or by the end of the file) */
+	if (state != STATE_GROUND)
+		wordLen += foldInvalid(tableId, wordLen, ENTRY_CUT_CHAR);
+	if (inWord)
+		insertWord(tableId, wordLen);
+}
+
+/**
+ *  \brief Leave the word and the char open at the end of a chunk in its summary.
+ *
+ *  Auxiliar function.
+ *
+ *	\param summary chunk summary, its edges filled up to the first separator
+ *	\param buffer buffer parsed
+ *	\param chunkSize valid size of the buffer
+ *	\param state decoder state at the end
+ *	\param inWord inWord flag at the end
+ *	\param vowelMask vowels of the last word
+ *	\param nWords words started after the first separator
+ *	\param vowels number of words with each vowel
+ */
+
+static void endChunk(struct ChunkSummary* summary, unsigned char* buffer, int chunkSize, unsigned int state, unsigned int inWord,
+	unsigned int vowelMask, int nWords, int vowels[7])
+{
+	struct ChunkEdges* edges = &summary->edges;
+	
+	/* word still open at the end, it may go on in the next chunk */
+	if (edges->separator && inWord)
+	{
+		edges->tailWord = true;
+		edges->tailVowels = vowelMask;
+		nWords--;
+		for (int i = 0; i < 6; i++)
+			vowels[i] -= (vowelMask >> i) & 1;
+	}
+	
+	/* uncomplete char at the end, from its leading byte on */
+	if (state != STATE_GROUND)
+	{
+		int lead = chunkSize - 1;
+		
+		while ((buffer[lead] & 0xC0) == 0x80)
+			lead--;
+		while (lead < chunkSize)
+			edges->tailBytes[edges->tailLen++] = buffer[lead++];
+	}
+	
+	summary->nWords = nWords;
+	for (int i = 0; i < 6; i++)
+		summary->vowels[i] = vowels[i];
+}
+
+/**
+ *  \brief Fold a complete char of a word.
+ *
+ *  Auxiliar function.
+ *
+ *  Ascii and latin letters are lower cased and the accented vowels and c cedilla lose their accent,
+ *  the right single quotation mark becomes an apostrophe and any other char is kept as it is.
+ *
+ *	\param folded where the folded char is written (MAX_CHAR_BYTES bytes at most)
+ *	\param bytes bytes of the char
+ *	\param len number of bytes
+ *
+ *  \return number of bytes written
+ */
+
+static int foldChar(unsigned char* folded, unsigned char* bytes, int len)
+{
+	if (len == 1)
+	{
+		folded[0] = (bytes[0] >= 'A' && bytes[0] <= 'Z') ? bytes[0] + ('a' - 'A') : bytes[0];
+		return 1;
+	}
+	
+	if (len == 2 && bytes[0] == 0xC3)
+	{
+		if (foldedLatin1[bytes[1] & 0x1F] != 0)
+		{
+			folded[0] = foldedLatin1[bytes[1] & 0x1F] + ('a' - 'A');
+			return 1;
+		}
+		
+		/* upper case latin letters are 0x20 below the lower case ones, but for the multiplication sign */
+		folded[0] = 0xC3;
+		folded[1] = (bytes[1] < 0xA0 && bytes[1] != 0x97 && bytes[1] != 0x9F) ? bytes[1] + 0x20 : bytes[1];
+		return 2;
+	}
+	
+	if (len == 3 && bytes[0] == 0xE2 && bytes[1] == 0x80 && bytes[2] == 0x99)
+	{
+		folded[0] = '\'';
+		return 1;
+	}
+	
+	memcpy(folded, bytes, len);
+	return len;
+}
+
+/**
+ *  \brief Fold the malformed sequences ended by a byte of a word.
+ *
+ *  Auxiliar function.
+ *
+ *  Each one is folded as U+FFFD, whatever its bytes, so a word keeps the place of the bytes lost.
+ *
+ *	\param tableId word table of the thread
+ *	\param wordLen bytes of the word folded so far, at the top of the arena
+ *	\param entry decoder entry of the byte
+ *
+ *  \return number of bytes written
+ */
+
+static int foldInvalid(int tableId, int wordLen, unsigned int entry)
+{
+	static const unsigned char replacement[3] = { 0xEF, 0xBF, 0xBD };
+	struct WordArena* arena = &wordTable(tableId)->arena;
+	int len = 0;
+	
+	if (arena->end - arena->top - wordLen < MAX_CHAR_BYTES)
+		growArena(tableId, wordLen);
+	if (entry & ENTRY_CUT_CHAR)
+	{
+		memcpy(arena->top + wordLen, replacement, sizeof(replacement));
+		len += sizeof(replacement);
+	}
+	if (entry & ENTRY_BAD_BYTE)
+	{
+		memcpy(arena->top + wordLen + len, replacement, sizeof(replacement));
+		len += sizeof(replacement);
+	}
+	return len;
+}
+
+/**
+ *  \brief Join the edges of the next chunk of a file to the summary of the previous ones.
+ *
+ *  Operation carried out by main, for the chunks of each file in order (starting from a zeroed
+ *  summary).
+ *
+ *  The char cut between the chunks is decoded from the bytes at both sides of the cut, then the
+ *  open run of the summary goes on through the head of the next chunk. Every run closed by a
+ *  separator is counted if it has word characters.
+ *
+ *  The malformed sequences at the cut come before the ones of the next chunk, whose offsets are then
+ *  moved past the bytes of the previous chunks. The text metrics of the chars at the cut, and the
+ *  length of the words closed, are counted in the summary.
+ *
+ *	\param summary summary of the previous chunks
+ *	\param next edges of the next chunk
+ */
+
+void joinEdges(struct ChunkSummary* summary, struct ChunkEdges* next)
+{
+	struct ChunkEdges* edges = &summary->edges;
+	unsigned char bytes[2 * (MAX_CHAR_BYTES - 1)];
+	unsigned int state = STATE_GROUND;
+	int nBytes = 0;
+	long cut = edges->size - edges->tailLen;		/* offset of the first byte at the cut */
+	
+	/* open run, after the last separator (or the whole text if there is none) */
+	bool word = edges->separator ? edges->tailWord : edges->headWord;
+	unsigned int vowelMask = edges->separator ? edges->tailVowels : edges->headVowels;
+	long runChars = edges->separator ? edges->tailChars : edges->headChars;
+	
+	for (int i = 0; i < edges->tailLen; i++)
+		bytes[nBytes++] = edges->tailBytes[i];
+	for (int i = 0; i < next->headLen; i++)
+		bytes[nBytes++] = next->headBytes[i];
+	
+	/* chars at the cut, a char still uncomplete after them is cut by the end of the file (or goes on
+	   in the next chunks if this one only had its bytes) */
+	for (int i = 0; i < nBytes; i++)
+	{
+		unsigned int entry = decoderTable[state][bytes[i]];
+		unsigned int class = entry >> 8;
+		
+		runChars += countMetrics(&summary->metrics, METRIC_LINES | METRIC_ACCENTS, bytes[i], state, entry) - classSeparator[class];
+		state = entry & 0x0F;
+		if (entry & ENTRY_INVALID)
+			keepInvalid(edges, bytes, i, entry, cut);
+		if (classSeparator[class])
+		{
+			closeRun(summary, word, vowelMask, runChars);
+			word = false;
+			vowelMask = 0;
+			runChars = 0;
+		}
+		word |= classWord[class];
+		vowelMask |= classVowelBit[class];
+	}
+	
+	/* the next chunk goes on with a byte that cannot continue the char at the cut */
+	if (state != STATE_GROUND && !next->headOnly)
+	{
+		keepInvalid(edges, bytes, nBytes, ENTRY_CUT_CHAR, cut);
+		summary->metrics.chars++;
+		runChars++;
+	}
+	
+	addInvalid(&edges->invalid, edges->invalidAt, next->invalid, next->invalidAt, edges->size);
+	edges->size += next->size;
+	
+	/* head of the next chunk */
+	word |= next->headWord;
+	vowelMask |= next->headVowels;
+	runChars += next->headChars;
+	if (next->separator)
+	{
+		closeRun(summary, word, vowelMask, runChars);
+		word = next->tailWord;
+		vowelMask = next->tailVowels;
+		runChars = next->tailChars;
+	}
+	
+	if (edges->separator)
+	{
+		edges->tailWord = word;
+		edges->tailVowels = vowelMask;
+		edges->tailChars = runChars;
+	}
+	else
+	{
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
+		edges->headChars = runChars;
+	}
+	
+	/* the next chunk only had bytes of the char at the cut, which is still uncomplete */
+	if (next->headOnly && state != STATE_GROUND)
+	{
+		int lead = nBytes - 1;
+		
+		while ((bytes[lead] & 0xC0) == 0x80)
+			lead--;
+		for (edges->tailLen = 0; lead < nBytes; lead++)
+			edges->tailBytes[edges->tailLen++] = bytes[lead];
+	}
+	else
+	{
+		edges->tailLen = next->tailLen;
+		for (int i = 0; i < next->tailLen; i++)
+			edges->tailBytes[i] = next->tailBytes[i];
+	}
+}
+
+/**
+ *  \brief Close a run of chars ended by a separator.
+ *
+ *  Auxiliar function.
+ *
+ *  The first run closed becomes the head of the summary, any other one is counted right away.
+ *
+ *	\param summary chunk summary
+ *	\param word the run has word characters
+ *	\param vowelMask vowels of the run
+ *	\param chars chars of the run
+ */
+
+static void closeRun(struct ChunkSummary* summary, bool word, unsigned int vowelMask, long chars)
+{
+	struct ChunkEdges* edges = &summary->edges;
+	
+	if (!edges->separator)
+	{
+		edges->separator = true;
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
+		edges->headChars = chars;
+	}
+	else if (word)
+	{
+		summary->nWords++;
+		for (int i = 0; i < 6; i++)
+			summary->vowels[i] += (vowelMask >> i) & 1;
+		countLength(&summary->metrics, chars);
+	}
+}
+
+/**
+ *  \brief Count the newlines of a chunk.
+ *
+ *  Auxiliar function.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *
+ *  \return number of newlines
+ */
+
+static long countLines(unsigned char* buffer, int chunkSize)
+{
+	int lines = 0;
+	
+	/* a plain loop over the bytes, vectorized by the compiler */
+	for (int i = 0; i < chunkSize; i++)
+		lines += (buffer[i] == '\n');
+	return lines;
+}
+
+/**
+ *  \brief Count the chosen text metrics of a decoded byte.
+ *
+ *  Auxiliar function.
+ *
+ *  The chars are always counted, the word lengths are made of them.
+ *
+ *	\param metrics text metrics
+ *	\param selected metric flags
+ *	\param byte byte decoded
+ *	\param state decoder state before the byte
+ *	\param entry decoder entry of the byte
+ *
+ *  \return number of chars completed by the byte, malformed sequences included
+ */
+
+static inline long countMetrics(struct TextMetrics* metrics, unsigned int selected, unsigned char byte, unsigned int state, unsigned int entry)
+{
+	long chars = ((entry & 0x0F) == STATE_GROUND) + ((entry & ENTRY_CUT_CHAR) != 0);
+	
+	metrics->chars += chars;
+	if (selected & METRIC_LINES)
+		metrics->lines += (byte == '\n');
+	if ((selected & METRIC_ACCENTS) && state == STATE_C3 && (entry & ENTRY_INVALID) == 0 && accentOffset[byte & 0x1F] >= 0)
+		metrics->accents[accentOffset[byte & 0x1F]]++;
+	return chars;
+}
+
+/**
+ *  \brief Count a word in the word length metric.
+ *
+ *  Auxiliar function.
+ *
+ *  Runs whose chars were not counted (chunks processed without the metrics) are left out.
+ *
+ *	\param metrics text metrics
+ *	\param chars chars of the word
+ */
+
+static void countLength(struct TextMetrics* metrics, long chars)
+{
+	if (chars > 0)
+		metrics->lengths[((chars < WORD_LENGTHS) ? chars : WORD_LENGTHS) - 1]++;
+}
+
+/**
+ *  \brief Add a summary to the file results.
+ *
+ *  Operation carried out by main, once all the chunks of the file were joined.
+ *
+ *  The words left at the edges are complete, they are cut by the start and the end of the file, and
+ *  so is the char left uncomplete, which is malformed. The malformed sequences are added after the
+ *  ones already in the file result (a cached file), and so are the text metrics of the joins when
+ *  the file result has them.
+ *
+ *	\param fileResult file result
+ *	\param summary summary of the whole file
+ */
+
+void addSummary(struct FileResult* fileResult, struct ChunkSummary* summary)
+{
+	struct ChunkEdges* edges = &summary->edges;
+	bool tailWord = edges->separator && edges->tailWord;
+	unsigned int tailVowels = edges->separator ? edges->tailVowels : 0;
+	
+	fileResult->nWords += summary->nWords + edges->headWord + tailWord;
+	for (int i = 0; i < 6; i++)
+		fileResult->vowels[i] += summary->vowels[i] + ((edges->headVowels >> i) & 1) + ((tailVowels >> i) & 1);
+	
+	/* a char still uncomplete is cut by the end of the file */
+	long truncated = edges->size - edges->tailLen;
+	
+	addInvalid(&fileResult->invalid, fileResult->invalidAt, edges->invalid, edges->invalidAt, 0);
+	if (edges->tailLen > 0)
+		addInvalid(&fileResult->invalid, fileResult->invalidAt, 1, &truncated, 0);
+	
+	if (fileResult->metrics != NULL)
+	{
+		struct TextMetrics* metrics = fileResult->metrics;
+		
+		/* the truncated char ends the open run */
+		metrics->chars += summary->metrics.chars + (edges->tailLen > 0);
+		metrics->lines += summary->metrics.lines;
+		if (edges->headWord)
+			countLength(metrics, edges->headChars + (!edges->separator && edges->tailLen > 0));
+		if (tailWord)
+			countLength(metrics, edges->tailChars + (edges->tailLen > 0));
+		for (int i = 0; i < WORD_LENGTHS; i++)
+			metrics->lengths[i] += summary->metrics.lengths[i];
+		for (int i = 0; i < ACCENTS; i++)
+			metrics->accents[i] += summary->metrics.accents[i];
+	}
+}
+
+/**
+ *  \brief Keep the malformed sequences ended by a byte.
+ *
+ *  Auxiliar function.
+ *
+ *  The uncomplete char cut by the byte starts at its leading byte, right before its continuation
+ *  bytes, and comes before the byte itself when both are malformed.
+ *
+ *	\param edges edges of the chunk (or of the chunks joined)
+ *	\param bytes bytes decoded
+ *	\param pos position of the byte
+ *	\param entry decoder entry of the byte
+ *	\param base offset of the first byte
+ */
+
+static void keepInvalid(struct ChunkEdges* edges, unsigned char* bytes, int pos, unsigned int entry, long base)
+{
+	long offset;
+	
+	if (entry & ENTRY_CUT_CHAR)
+	{
+		int lead = pos - 1;
+		
+		while ((bytes[lead] & 0xC0) == 0x80)
+			lead--;
+		offset = base + lead;
+		addInvalid(&edges->invalid, edges->invalidAt, 1, &offset, 0);
+	}
+	if (entry & ENTRY_BAD_BYTE)
+	{
+		offset = base + pos;
+		addInvalid(&edges->invalid, edges->invalidAt, 1, &offset, 0);
+	}
+}
+
+/**
+ *  \brief Add malformed sequences after the ones already kept.
+ *
+ *  Auxiliar function.
+ *
+ *  Only the offsets of the first INVALID_OFFSETS sequences are kept, the others are just counted.
+ *
+ *	\param invalid malformed sequences kept so far
+ *	\param invalidAt offsets of the first ones
+ *	\param count sequences added
+ *	\param offsets offsets of the first sequences added
+ *	\param base offset added to them
+ */
+
+static void addInvalid(long* invalid, long invalidAt[INVALID_OFFSETS], long count, long* offsets, long base)
+{
+	for (long i = 0; i < count && *invalid + i < INVALID_OFFSETS; i++)
+		invalidAt[*invalid + i] = base + offsets[i];
+	*invalid += count;
+}
+
+#ifdef SIMD_ASCII
+/**
+ *  \brief Classify a block of SIMD_WIDTH bytes.
+ *
+ *  Builds the masks of the bytes that are not ascii, word characters (alpha numeric or underscore),
+ *  separators and each of the vowels (case insensitive).
+ *
+ *	\param block block of bytes to classify
+ *	\param masks bit masks of the block
+ */
+
+static void classifyBlock(unsigned char* block, struct AsciiMasks* masks)
+{
+	static const char vowels[6] = { 'a', 'e', 'i', 'o', 'u', 'y' };
+
+#if defined(__AVX2__)
+	__m256i b = _mm256_loadu_si256((__m256i*) block);
+	__m256i lower = _mm256_or_si256(b, _mm256_set1_epi8(0x20));
+	__m256i sep = _mm256_setzero_si256();
+	
+	/* letters, digits and underscore (bytes with the msb set are negative and never match) */
+	__m256i word = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+	word = _mm256_or_si256(word, _mm256_and_si256(_mm256_cmpgt_epi8(b, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), b)));
+	word = _mm256_or_si256(word, _mm256_cmpeq_epi8(b, _mm256_set1_epi8('_')));
+	
+	for (int i = 0; separators[i] != '\0'; i++)
+		sep = _mm256_or_si256(sep, _mm256_cmpeq_epi8(b, _mm256_set1_epi8(separators[i])));
+	
+	masks->high = (uint32_t) _mm256_movemask_epi8(b);
+	masks->word = (uint32_t) _mm256_movemask_epi8(word);
+	masks->separator = (uint32_t) _mm256_movemask_epi8(sep);
+	for (int i = 0; i < 6; i++)
+		masks->vowels[i] = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8(vowels[i])));
+#else
+	__m128i b = _mm_loadu_si128((__m128i*) block);
+	__m128i lower = _mm_or_si128(b, _mm_set1_epi8(0x20));
+	__m128i sep = _mm_setzero_si128();
+	
+	/* letters, digits and underscore (bytes with the msb set are negative and never match) */
+	__m128i word = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+	word = _mm_or_si128(word, _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(b, _mm_set1_epi8('9' + 1))));
+	word = _mm_or_si128(word, _mm_cmpeq_epi8(b, _mm_set1_epi8('_')));
+	
+	for (int i = 0; separators[i] != '\0'; i++)
+		sep = _mm_or_si128(sep, _mm_cmpeq_epi8(b, _mm_set1_epi8(separators[i])));
+	
+	masks->high = (uint32_t) _mm_movemask_epi8(b);
+	masks->word = (uint32_t) _mm_movemask_epi8(word);
+	masks->separator = (uint32_t) _mm_movemask_epi8(sep);
+	for (int i = 0; i < 6; i++)
+		masks->vowels[i] = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(lower, _mm_set1_epi8(vowels[i])));
+#endif
+}
+
+/**
+ *  \brief Process a run of ascii characters from its classification masks.
+ *
+ *  Same word state update as the table driven path, but word by word: a word starts at the first
+ *  word character found outside a word and ends at the next separator, every other character
+ *  leaves the state unchanged. The vowels of the word are then looked up in the masks all at once.
+ *
+ *	\param masks bit masks of the block
+ *	\param runLen number of ascii characters at the start of the block
+ *	\param inWord inWord flag
+ *	\param nWords total words
+ *	\param vowels number of words with each vowel
+ *	\param vowelMask vowels of the current word
+ */
+
+static void processAsciiRun(struct AsciiMasks* masks, int runLen, unsigned int* inWord, int* nWords, int vowels[7], unsigned int* vowelMask)
+{
+	uint64_t run = ((uint64_t) 1 << runLen) - 1;
+	uint64_t word = masks->word & run;
+	uint64_t separator = masks->separator & run;
+	uint64_t from = run;		/* mask of the positions not yet processed */
+	
+	while (true)
+	{
+		// outside a word, look for its first character
+		if (*inWord == 0)
+		{
+			if ((word & from) == 0)
+				return;
+			
+			int start = __builtin_ctzll(word & from);
+			from &= ~(((uint64_t) 1 << start) - 1);
+			
+			*inWord = 1;
+			(*nWords)++;
+			*vowelMask = 0;
+		}
+		
+		// inside a word, look for the separator that ends it
+		uint64_t end = separator & from;
+		uint64_t span = (end == 0) ? from : (from & ((end & -end) - 1));
+		unsigned int found = 0;
+		
+		for (int i = 0; i < 6; i++)
+			found |= ((masks->vowels[i] & span) != 0) << i;
+		
+		found &= ~*vowelMask;
+		for (int i = 0; i < 6; i++)
+			vowels[i] += (found >> i) & 1;
+		*vowelMask |= found;
+		
+		if (end == 0)
+			return;
+		
+		*inWord = 0;
+		from &= ~span;
+	}
+}
+#endif
@@ -0,0 +1,113 @@
+/**
+ *  \file textKernel.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Text processing kernel.
+ *
+ *  Byte level utf-8 decoder, which also finds the malformed sequences, and character classifier
+ *  driven by precomputed tables, used by the workers (chunk processing) and main (joining the chunks
+ *  of a file):
+ *     \li initDecoder
+ *     \li processChunk
+ *     \li processChunkMetrics
+ *     \li processChunkWords
+ *     \li countWordRuns
+ *     \li joinEdges
+ *     \li addSummary.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef TEXTKERNEL_H
+#define TEXTKERNEL_H
+
+/**
+ *  \brief Fill the decoder tables.
+ *
+ *  Operation carried out by main, before any other kernel operation.
+ */
+
+extern void initDecoder(void);
+
+/**
+ *  \brief Process a text chunk.
+ *
+ *  Operation carried out by the workers.
+ *
+ *  The chunk can start and end at any byte of the file.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *
+ *  \return chunk summary
+ */
+
+extern struct ChunkSummary processChunk(unsigned char* buffer, int chunkSize);
+
+/**
+ *  \brief Process a text chunk, counting its text metrics.
+ *
+ *  Operation carried out by the workers, when text metrics are counted.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *	\param selected metric flags
+ *
+ *  \return chunk summary, with the chosen metrics of the chunk
+ */
+
+extern struct ChunkSummary processChunkMetrics(unsigned char* buffer, int chunkSize, unsigned int selected);
+
+/**
+ *  \brief Process a text chunk, counting every word in the word table of the worker.
+ *
+ *  Operation carried out by the workers, when the word frequencies are counted.
+ *
+ *	\param buffer buffer to be parsed
+ *	\param chunkSize valid size of the buffer
+ *	\param tableId word table of the worker
+ *	\param fragments raw bytes of the runs cut by the chunk edges, kept in the arena
+ *	\param selected metric flags, 0 when no text metric is counted
+ *
+ *  \return chunk summary
+ */
+
+extern struct ChunkSummary processChunkWords(unsigned char* buffer, int chunkSize, int tableId, struct WordFragments* fragments, unsigned int selected);
+
+/**
+ *  \brief Count the words of runs of complete chars in a word table.
+ *
+ *  Operation carried out by the threads joining the chunk fragments of a file.
+ *
+ *	\param bytes bytes of the runs, from right after a separator to right before one
+ *	\param len number of bytes
+ *	\param tableId word table of the thread
+ */
+
+extern void countWordRuns(unsigned char* bytes, int len, int tableId);
+
+/**
+ *  \brief Join the edges of the next chunk of a file to the summary of the previous ones.
+ *
+ *  Operation carried out by main, for the chunks of each file in order (starting from a zeroed
+ *  summary).
+ *
+ *	\param summary summary of the previous chunks
+ *	\param next edges of the next chunk
+ */
+
+extern void joinEdges(struct ChunkSummary* summary, struct ChunkEdges* next);
+
+/**
+ *  \brief Add a summary to the file results.
+ *
+ *  Operation carried out by main, once all the chunks of the file were joined.
+ *
+ *	\param fileResult file result
+ *	\param summary summary of the whole file
+ */
+
+extern void addSummary(struct FileResult* fileResult, struct ChunkSummary* summary);
+
+#endif /* TEXTKERNEL_H */
\ No newline at end of file
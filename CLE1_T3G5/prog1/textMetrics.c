@@ -0,0 +1,220 @@
+/**
+ *  \file textMetrics.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Text metrics.
+ *
+ *  Registry of the metrics counted by the text kernel in the same pass as the words, chosen in the
+ *  command line, whose per worker counters are merged by main and printed with each file:
+ *     \li parseMetrics
+ *     \li addMetrics
+ *     \li printMetrics.
+ *
+ *  Only the chosen metrics are counted by processChunkMetrics (and processChunkWords), the bytes and
+ *  the newlines keep the ascii fast path, the others come from the decoder entries already looked up
+ *  for the words, and each one is a step of the kernel taken only when its flag is chosen. A new
+ *  metric takes a flag, its counters in the text metrics structure, a step in the kernel and an
+ *  entry here.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "consts.h"
+#include "textMetrics.h"
+
+/** \brief metric registry entry structure */
+struct Metric {
+	const char* name;
+	unsigned int flag;
+	void (*print)(struct TextMetrics* metrics);
+};
+
+/** \brief print the bytes of text */
+static void printBytes(struct TextMetrics* metrics);
+
+/** \brief print the chars */
+static void printChars(struct TextMetrics* metrics);
+
+/** \brief print the newlines */
+static void printLines(struct TextMetrics* metrics);
+
+/** \brief print the word length distribution */
+static void printLengths(struct TextMetrics* metrics);
+
+/** \brief print the accented letter frequencies */
+static void printAccents(struct TextMetrics* metrics);
+
+/** \brief metric registry, in printing order */
+static const struct Metric registry[] = {
+	{ "bytes", METRIC_BYTES, printBytes },
+	{ "chars", METRIC_CHARS, printChars },
+	{ "lines", METRIC_LINES, printLines },
+	{ "lengths", METRIC_LENGTHS, printLengths },
+	{ "accents", METRIC_ACCENTS, printAccents }
+};
+
+/** \brief number of registered metrics */
+#define METRICS ((int) (sizeof(registry) / sizeof(registry[0])))
+
+/** \brief accented letters, in the accent offset order of the kernel */
+static const char* accentNames[ACCENTS] = { "à", "á", "â", "ã", "ç", "é", "ê", "í", "ó", "ô", "õ", "ú" };
+
+/**
+ *  \brief Find the metrics named in a comma separated list.
+ *
+ *  Operation carried out by main, while parsing the command line.
+ *
+ *  \param list metric names (bytes, chars, lines, lengths and accents) or "all"
+ *
+ *  \return metric flags
+ */
+
+unsigned int parseMetrics(const char* list)
+{
+	unsigned int selected = 0;
+	const char* name = list;
+
+	while (true)
+	{
+		int len = strcspn(name, ",");
+		int i;
+
+		for (i = 0; i < METRICS; i++)
+			if ((int) strlen(registry[i].name) == len && strncmp(name, registry[i].name, len) == 0)
+				break;
+
+		if (i < METRICS)
+			selected |= registry[i].flag;
+		else if (len == 3 && strncmp(name, "all", len) == 0)
+			for (i = 0; i < METRICS; i++)
+				selected |= registry[i].flag;
+		else
+		{
+			fprintf(stderr, "invalid metric \"%.*s\" (bytes, chars, lines, lengths, accents or all)\n", len, name);
+			exit(EXIT_FAILURE);
+		}
+
+		if (name[len] == '\0')
+			return selected;
+		name += len + 1;
+	}
+}
+
+/**
+ *  \brief Add text metrics to others.
+ *
+ *  Operation carried out by the workers (on their own counters) and main (merging them).
+ *
+ *  \param metrics text metrics added to
+ *  \param more text metrics added
+ */
+
+void addMetrics(struct TextMetrics* metrics, struct TextMetrics* more)
+{
+	metrics->bytes += more->bytes;
+	metrics->chars += more->chars;
+	metrics->lines += more->lines;
+	for (int i = 0; i < WORD_LENGTHS; i++)
+		metrics->lengths[i] += more->lengths[i];
+	for (int i = 0; i < ACCENTS; i++)
+		metrics->accents[i] += more->accents[i];
+}
+
+/**
+ *  \brief Print the chosen text metrics of a file.
+ *
+ *  Operation carried out by main, with the file results.
+ *
+ *  \param metrics text metrics of the file
+ *  \param selected metric flags
+ */
+
+void printMetrics(struct TextMetrics* metrics, unsigned int selected)
+{
+	for (int i = 0; i < METRICS; i++)
+		if (selected & registry[i].flag)
+			registry[i].print(metrics);
+}
+
+/**
+ *  \brief Print the bytes of text.
+ *
+ *  Auxiliar function.
+ *
+ *  \param metrics text metrics of the file
+ */
+
+static void printBytes(struct TextMetrics* metrics)
+{
+	printf("Bytes of text = %ld\n", metrics->bytes);
+}
+
+/**
+ *  \brief Print the chars.
+ *
+ *  Auxiliar function.
+ *
+ *  \param metrics text metrics of the file
+ */
+
+static void printChars(struct TextMetrics* metrics)
+{
+	printf("Chars = %ld\n", metrics->chars);
+}
+
+/**
+ *  \brief Print the newlines.
+ *
+ *  Auxiliar function.
+ *
+ *  \param metrics text metrics of the file
+ */
+
+static void printLines(struct TextMetrics* metrics)
+{
+	printf("Lines = %ld\n", metrics->lines);
+}
+
+/**
+ *  \brief Print the word length distribution.
+ *
+ *  Auxiliar function.
+ *
+ *  \param metrics text metrics of the file
+ */
+
+static void printLengths(struct TextMetrics* metrics)
+{
+	printf("Number of words with a length (chars) of\n");
+	for (int i = 1; i < WORD_LENGTHS; i++)
+		printf("\t%d", i);
+	printf("\t%d+\n", WORD_LENGTHS);
+	for (int i = 0; i < WORD_LENGTHS; i++)
+		printf("\t%ld", metrics->lengths[i]);
+	printf("\n");
+}
+
+/**
+ *  \brief Print the accented letter frequencies.
+ *
+ *  Auxiliar function.
+ *
+ *  \param metrics text metrics of the file
+ */
+
+static void printAccents(struct TextMetrics* metrics)
+{
+	printf("Number of accented letters\n");
+	for (int i = 0; i < ACCENTS; i++)
+		printf("\t%s", accentNames[i]);
+	printf("\n");
+	for (int i = 0; i < ACCENTS; i++)
+		printf("\t%ld", metrics->accents[i]);
+	printf("\n");
+}
@@ -0,0 +1,54 @@
+/**
+ *  \file textMetrics.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Text metrics.
+ *
+ *  Registry of the metrics counted by the text kernel in the same pass as the words, chosen in the
+ *  command line, whose per worker counters are merged by main and printed with each file:
+ *     \li parseMetrics
+ *     \li addMetrics
+ *     \li printMetrics.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef TEXTMETRICS_H
+#define TEXTMETRICS_H
+
+/**
+ *  \brief Find the metrics named in a comma separated list.
+ *
+ *  Operation carried out by main, while parsing the command line.
+ *
+ *  \param list metric names (bytes, chars, lines, lengths and accents) or "all"
+ *
+ *  \return metric flags
+ */
+
+extern unsigned int parseMetrics(const char* list);
+
+/**
+ *  \brief Add text metrics to others.
+ *
+ *  Operation carried out by the workers (on their own counters) and main (merging them).
+ *
+ *  \param metrics text metrics added to
+ *  \param more text metrics added
+ */
+
+extern void addMetrics(struct TextMetrics* metrics, struct TextMetrics* more);
+
+/**
+ *  \brief Print the chosen text metrics of a file.
+ *
+ *  Operation carried out by main, with the file results.
+ *
+ *  \param metrics text metrics of the file
+ *  \param selected metric flags
+ */
+
+extern void printMetrics(struct TextMetrics* metrics, unsigned int selected);
+
+#endif /* TEXTMETRICS_H */
@@ -0,0 +1,512 @@
+/**
+ *  \file wordFreq.c (implementation file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Word frequency tables.
+ *
+ *  Exact count of every accent folded word, each thread inserting into its own table, used by the
+ *  text kernel (arena and insertion), the workers and main (joining the words cut by the chunk
+ *  edges, merging and printing the tables):
+ *     \li initWordTables
+ *     \li wordTable
+ *     \li growArena
+ *     \li insertWord
+ *     \li keepBytes
+ *     \li joinFragments
+ *     \li closeFragments
+ *     \li mergeWords
+ *     \li printWords.
+ *
+ *  The words are folded straight into the arena of the table, which is only grown by whole blocks:
+ *  a known word is just overwritten by the next one, a new one stays where it was folded and its
+ *  entry points to it. Each table is split in WORD_SHARDS open addressing shards by the high bits of
+ *  the hash, so the tables are merged shard by shard in parallel, with no lock.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "consts.h"
+#include "textKernel.h"
+#include "wordFreq.h"
+
+/** \brief worker threads return status array */
+extern int *statusWorkers;
+
+/** \brief main thread return status */
+extern int statusMain;
+
+/** \brief word tables, one per worker and the last one for main */
+static struct WordTable* wordTables = NULL;
+
+/** \brief number of workers */
+static int totalWorkers = 0;
+
+/** \brief initial capacity of a shard */
+#define  SHARD_CAPACITY           256
+
+/** \brief report an allocation error and end the thread */
+static void allocationError(int threadId, const char* what);
+
+/** \brief hash of a word */
+static unsigned long long hashWord(unsigned char* word, int len);
+
+/** \brief find a word in a shard, adding it if missing */
+static bool addEntry(int threadId, struct WordShard* shard, unsigned long long hash, unsigned char* word, int len, long count);
+
+/** \brief double the capacity of a shard */
+static void growShard(int threadId, struct WordShard* shard);
+
+/** \brief append bytes to an open run */
+static void appendRun(struct WordRun* run, unsigned char* bytes, int len, int tableId);
+
+/** \brief order two entries, most frequent first */
+static int compareEntries(const void* a, const void* b);
+
+/**
+ *  \brief Allocate the word tables.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  One table per worker and a last one for main, which counts the words cut by the chunk edges.
+ *
+ *  \param nWorkers number of workers
+ */
+
+void initWordTables(int nWorkers)
+{
+	if ((wordTables = aligned_alloc(CACHE_LINE_SIZE, (nWorkers + 1) * sizeof(struct WordTable))) == NULL)
+		allocationError(nWorkers, "word tables");
+	memset(wordTables, 0, (nWorkers + 1) * sizeof(struct WordTable));
+	totalWorkers = nWorkers;
+}
+
+/**
+ *  \brief Word table of a thread.
+ *
+ *  \param tableId worker id, or the number of workers for main
+ *
+ *  \return word table
+ */
+
+struct WordTable* wordTable(int tableId)
+{
+	return &wordTables[tableId];
+}
+
+/**
+ *  \brief Make room in the arena for a word being folded.
+ *
+ *  Operation carried out by the owner of the table, when the block has less than MAX_CHAR_BYTES
+ *  bytes left after the word.
+ *
+ *  The bytes folded so far, at the top of the arena, are moved to a new block. The rest of the old
+ *  block is left unused.
+ *
+ *  \param tableId table id
+ *  \param wordLen bytes folded so far
+ */
+
+void growArena(int tableId, int wordLen)
+{
+	struct WordArena* arena = &wordTables[tableId].arena;
+	long size = ARENA_BLOCK_SIZE;
+	unsigned char* block;
+
+	while (size < 2L * (wordLen + MAX_CHAR_BYTES))
+		size *= 2;
+
+	if ((block = malloc(size)) == NULL)
+		allocationError(tableId, "word arena");
+	if (wordLen > 0)
+		memcpy(block, arena->top, wordLen);
+
+	arena->top = block;
+	arena->end = block + size;
+}
+
+/**
+ *  \brief Count the word folded at the top of the arena.
+ *
+ *  Operation carried out by the owner of the table.
+ *
+ *  A new word stays in the arena, a known one is overwritten by the next.
+ *
+ *  \param tableId table id
+ *  \param wordLen word length in bytes
+ */
+
+void insertWord(int tableId, int wordLen)
+{
+	struct WordTable* table = &wordTables[tableId];
+	unsigned char* word = table->arena.top;
+	unsigned long long hash = hashWord(word, wordLen);
+
+	if (addEntry(tableId, &table->shards[(hash >> 32) % WORD_SHARDS], hash, word, wordLen, 1))
+		table->arena.top += wordLen;
+}
+
+/**
+ *  \brief Copy raw bytes into the arena.
+ *
+ *  Operation carried out by the owner of the table.
+ *
+ *  \param tableId table id
+ *  \param bytes bytes to keep
+ *  \param len number of bytes
+ *
+ *  \return copy of the bytes, kept until the end
+ */
+
+unsigned char* keepBytes(int tableId, unsigned char* bytes, int len)
+{
+	struct WordArena* arena = &wordTables[tableId].arena;
+	unsigned char* copy;
+
+	if (len == 0)
+		return NULL;
+	if (arena->end - arena->top < len)
+	{
+		/* a large copy gets its own block, so the current one can still be filled */
+		if (len > ARENA_BLOCK_SIZE / 4)
+		{
+			if ((copy = malloc(len)) == NULL)
+				allocationError(tableId, "word arena");
+			memcpy(copy, bytes, len);
+			return copy;
+		}
+		growArena(tableId, 0);
+	}
+
+	copy = arena->top;
+	memcpy(copy, bytes, len);
+	arena->top += len;
+
+	return copy;
+}
+
+/**
+ *  \brief Join the fragments of the next chunk of a file to its open run.
+ *
+ *  Operation carried out by main, or by the worker joining the stream buffers, for the chunks of
+ *  each file in order.
+ *
+ *  The head of the chunk ends the open run, which is then counted (a separator cut by the chunk
+ *  edge may split it in more than one word), and the tail of the chunk opens the next one. A chunk
+ *  with no separator just makes the open run longer.
+ *
+ *  \param run open run of the file
+ *  \param next fragments of the next chunk
+ *  \param tableId table of the thread joining
+ */
+
+void joinFragments(struct WordRun* run, struct WordFragments* next, int tableId)
+{
+	appendRun(run, next->head, next->headLen, tableId);
+
+	if (next->separator)
+	{
+		countWordRuns(run->bytes, run->len, tableId);
+		run->len = 0;
+		appendRun(run, next->tail, next->tailLen, tableId);
+	}
+}
+
+/**
+ *  \brief Count the words of the open run of a file, cut by the end of the file.
+ *
+ *  \param run open run of the file
+ *  \param tableId table of the thread joining
+ */
+
+void closeFragments(struct WordRun* run, int tableId)
+{
+	countWordRuns(run->bytes, run->len, tableId);
+	run->len = 0;
+}
+
+/**
+ *  \brief Merge a share of the table shards into the first table.
+ *
+ *  Operation carried out by the mergers, once every word was inserted.
+ *
+ *  Each merger owns the shards whose index is its id modulo the number of mergers, so no lock is
+ *  needed. The merged entries keep pointing to the arenas of the other tables.
+ *
+ *  \param mergerId merger id
+ *  \param nMergers number of mergers
+ */
+
+void mergeWords(int mergerId, int nMergers)
+{
+	for (int s = mergerId; s < WORD_SHARDS; s += nMergers)
+	{
+		struct WordShard* target = &wordTables[0].shards[s];
+
+		for (int t = 1; t <= totalWorkers; t++)
+		{
+			struct WordShard* shard = &wordTables[t].shards[s];
+
+			for (int i = 0; i < shard->capacity; i++)
+			{
+				struct WordEntry* entry = &shard->entries[i];
+
+				if (entry->word != NULL)
+					(void) addEntry(mergerId, target, entry->hash, entry->word, entry->len, entry->count);
+			}
+		}
+	}
+}
+
+/**
+ *  \brief Print the number of distinct words and the most frequent ones.
+ *
+ *  Operation carried out by main, after the mergers.
+ *
+ *  The most frequent words are kept in a min heap of topWords entries while going through the
+ *  merged shards, ties are broken by the byte order of the words.
+ *
+ *  \param topWords number of words printed
+ */
+
+void printWords(int topWords)
+{
+	struct WordEntry* heap;
+	long distinct = 0, total = 0;
+	int heapSize = 0;
+
+	if ((heap = malloc(topWords * sizeof(struct WordEntry))) == NULL)
+		allocationError(totalWorkers, "most frequent words");
+
+	for (int s = 0; s < WORD_SHARDS; s++)
+	{
+		struct WordShard* shard = &wordTables[0].shards[s];
+
+		for (int i = 0; i < shard->capacity; i++)
+		{
+			struct WordEntry* entry = &shard->entries[i];
+
+			if (entry->word == NULL)
+				continue;
+			distinct++;
+			total += entry->count;
+
+			/* the root is the least frequent of the words kept */
+			int pos;
+			if (heapSize < topWords)
+			{
+				/* sift up */
+				for (pos = heapSize++; pos > 0 && compareEntries(&heap[(pos - 1) / 2], entry) < 0; pos = (pos - 1) / 2)
+					heap[pos] = heap[(pos - 1) / 2];
+				heap[pos] = *entry;
+			}
+			else if (compareEntries(entry, &heap[0]) < 0)
+			{
+				/* sift down */
+				for (pos = 0; 2 * pos + 1 < heapSize; )
+				{
+					int child = 2 * pos + 1;
+
+					if (child + 1 < heapSize && compareEntries(&heap[child + 1], &heap[child]) > 0)
+						child++;
+					if (compareEntries(&heap[child], entry) <= 0)
+						break;
+					heap[pos] = heap[child];
+					pos = child;
+				}
+				heap[pos] = *entry;
+			}
+		}
+	}
+
+	qsort(heap, heapSize, sizeof(struct WordEntry), compareEntries);
+
+	printf("\nWord frequencies: %ld words, %ld distinct\n", total, distinct);
+	printf("%6s %12s  %s\n", "rank", "count", "word");
+	for (int i = 0; i < heapSize; i++)
+		printf("%6d %12ld  %.*s\n", i + 1, heap[i].count, heap[i].len, (char*) heap[i].word);
+
+	free(heap);
+}
+
+/**
+ *  \brief Report an allocation error and end the thread.
+ *
+ *  Auxiliar function.
+ *
+ *  \param threadId worker (or merger) id, or the number of workers for main
+ *  \param what what was being allocated
+ */
+
+static void allocationError(int threadId, const char* what)
+{
+	fprintf(stderr, "error on allocating space to the %s\n", what);
+	if (threadId < totalWorkers)
+	{
+		statusWorkers[threadId] = EXIT_FAILURE;
+		pthread_exit(&statusWorkers[threadId]);
+	}
+	statusMain = EXIT_FAILURE;
+	pthread_exit(&statusMain);
+}
+
+/**
+ *  \brief Hash of a word (FNV-1a, finished with a 64 bit mix so the high bits pick the shard).
+ *
+ *  Auxiliar function.
+ *
+ *  \param word word bytes
+ *  \param len word length
+ *
+ *  \return 64 bit hash
+ */
+
+static unsigned long long hashWord(unsigned char* word, int len)
+{
+	unsigned long long hash = 0xCBF29CE484222325ULL;
+
+	for (int i = 0; i < len; i++)
+		hash = (hash ^ word[i]) * 0x100000001B3ULL;
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/**
+ *  \brief Find a word in a shard, adding it if missing.
+ *
+ *  Auxiliar function, carried out by the owner of the shard.
+ *
+ *  \param threadId owner of the shard
+ *  \param shard shard
+ *  \param hash word hash
+ *  \param word word bytes, kept by a new entry
+ *  \param len word length
+ *  \param count occurrences to add
+ *
+ *  \return true if the word was added
+ */
+
+static bool addEntry(int threadId, struct WordShard* shard, unsigned long long hash, unsigned char* word, int len, long count)
+{
+	/* kept at most half full */
+	if (2 * (shard->used + 1) > shard->capacity)
+		growShard(threadId, shard);
+
+	unsigned int mask = shard->capacity - 1;
+
+	for (unsigned int slot = hash & mask; ; slot = (slot + 1) & mask)
+	{
+		struct WordEntry* entry = &shard->entries[slot];
+
+		if (entry->word == NULL)
+		{
+			entry->hash = hash;
+			entry->word = word;
+			entry->len = len;
+			entry->count = count;
+			shard->used++;
+			return true;
+		}
+		if (entry->hash == hash && entry->len == len && memcmp(entry->word, word, len) == 0)
+		{
+			entry->count += count;
+			return false;
+		}
+	}
+}
+
+/**
+ *  \brief Double the capacity of a shard.
+ *
+ *  Auxiliar function, carried out by the owner of the shard.
+ *
+ *  \param threadId owner of the shard
+ *  \param shard shard
+ */
+
+static void growShard(int threadId, struct WordShard* shard)
+{
+	struct WordEntry* old = shard->entries;
+	int oldCapacity = shard->capacity;
+
+	shard->capacity = (oldCapacity == 0) ? SHARD_CAPACITY : 2 * oldCapacity;
+	if ((shard->entries = calloc(shard->capacity, sizeof(struct WordEntry))) == NULL)
+		allocationError(threadId, "word tables");
+
+	unsigned int mask = shard->capacity - 1;
+
+	for (int i = 0; i < oldCapacity; i++)
+	{
+		unsigned int slot;
+
+		if (old[i].word == NULL)
+			continue;
+		for (slot = old[i].hash & mask; shard->entries[slot].word != NULL; slot = (slot + 1) & mask)
+			;
+		shard->entries[slot] = old[i];
+	}
+
+	free(old);
+}
+
+/**
+ *  \brief Append bytes to an open run.
+ *
+ *  Auxiliar function.
+ *
+ *  \param run open run
+ *  \param bytes bytes to append
+ *  \param len number of bytes
+ *  \param tableId table of the thread joining
+ */
+
+static void appendRun(struct WordRun* run, unsigned char* bytes, int len, int tableId)
+{
+	if (len == 0)
+		return;
+	if (run->len + len > run->capacity)
+	{
+		while (run->len + len > run->capacity)
+			run->capacity = (run->capacity == 0) ? 256 : 2 * run->capacity;
+		if ((run->bytes = realloc(run->bytes, run->capacity)) == NULL)
+			allocationError(tableId, "open word runs");
+	}
+
+	memcpy(run->bytes + run->len, bytes, len);
+	run->len += len;
+}
+
+/**
+ *  \brief Order two entries, most frequent first (then by the byte order of the words), for qsort.
+ *
+ *  Auxiliar function.
+ *
+ *  \param a first entry
+ *  \param b second entry
+ *
+ *  \return negative if the first entry goes first
+ */
+
+static int compareEntries(const void* a, const void* b)
+{
+	const struct WordEntry* x = a;
+	const struct WordEntry* y = b;
+
+	if (x->count != y->count)
+		return (x->count > y->count) ? -1 : 1;
+
+	int common = (x->len < y->len) ? x->len : y->len;
+	int order = memcmp(x->word, y->word, common);
+
+	return (order != 0) ? order : x->len - y->len;
+}
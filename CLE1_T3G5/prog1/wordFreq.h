@@ -0,0 +1,136 @@
+/**
+ *  \file wordFreq.h (interface file)
+ *
+ *  \brief Problem name: Count Portuguese Words.
+ *
+ *  Word frequency tables.
+ *
+ *  Exact count of every accent folded word, each thread inserting into its own table, used by the
+ *  text kernel (arena and insertion), the workers and main (joining the words cut by the chunk
+ *  edges, merging and printing the tables):
+ *     \li initWordTables
+ *     \li wordTable
+ *     \li growArena
+ *     \li insertWord
+ *     \li keepBytes
+ *     \li joinFragments
+ *     \li closeFragments
+ *     \li mergeWords
+ *     \li printWords.
+ *
+ *  \author Author Name - Month Year
+ */
+
+#ifndef WORDFREQ_H
+#define WORDFREQ_H
+
+/**
+ *  \brief Allocate the word tables.
+ *
+ *  Operation carried out by main, before the workers are created.
+ *
+ *  One table per worker and a last one for main, which counts the words cut by the chunk edges.
+ *
+ *  \param nWorkers number of workers
+ */
+
+extern void initWordTables(int nWorkers);
+
+/**
+ *  \brief Word table of a thread.
+ *
+ *  \param tableId worker id, or the number of workers for main
+ *
+ *  \return word table
+ */
+
+extern struct WordTable* wordTable(int tableId);
+
+/**
+ *  \brief Make room in the arena for a word being folded.
+ *
+ *  Operation carried out by the owner of the table, when the block has less than MAX_CHAR_BYTES
+ *  bytes left after the word.
+ *
+ *  The bytes folded so far, at the top of the arena, are moved to a new block.
+ *
+ *  \param tableId table id
+ *  \param wordLen bytes folded so far
+ */
+
+extern void growArena(int tableId, int wordLen);
+
+/**
+ *  \brief Count the word folded at the top of the arena.
+ *
+ *  Operation carried out by the owner of the table.
+ *
+ *  A new word stays in the arena, a known one is overwritten by the next.
+ *
+ *  \param tableId table id
+ *  \param wordLen word length in bytes
+ */
+
+extern void insertWord(int tableId, int wordLen);
+
+/**
+ *  \brief Copy raw bytes into the arena.
+ *
+ *  Operation carried out by the owner of the table.
+ *
+ *  \param tableId table id
+ *  \param bytes bytes to keep
+ *  \param len number of bytes
+ *
+ *  \return copy of the bytes, kept until the end
+ */
+
+extern unsigned char* keepBytes(int tableId, unsigned char* bytes, int len);
+
+/**
+ *  \brief Join the fragments of the next chunk of a file to its open run.
+ *
+ *  Operation carried out by main, or by the worker joining the stream buffers, for the chunks of
+ *  each file in order.
+ *
+ *  \param run open run of the file
+ *  \param next fragments of the next chunk
+ *  \param tableId table of the thread joining
+ */
+
+extern void joinFragments(struct WordRun* run, struct WordFragments* next, int tableId);
+
+/**
+ *  \brief Count the words of the open run of a file, cut by the end of the file.
+ *
+ *  \param run open run of the file
+ *  \param tableId table of the thread joining
+ */
+
+extern void closeFragments(struct WordRun* run, int tableId);
+
+/**
+ *  \brief Merge a share of the table shards into the first table.
+ *
+ *  Operation carried out by the mergers, once every word was inserted.
+ *
+ *  Each merger owns the shards whose index is its id modulo the number of mergers, so no lock is
+ *  needed.
+ *
+ *  \param mergerId merger id
+ *  \param nMergers number of mergers
+ */
+
+extern void mergeWords(int mergerId, int nMergers);
+
+/**
+ *  \brief Print the number of distinct words and the most frequent ones.
+ *
+ *  Operation carried out by main, after the mergers.
+ *
+ *  \param topWords number of words printed
+ */
+
+extern void printWords(int topWords);
+
+#endif /* WORDFREQ_H */
@@ -16,6 +16,9 @@
 /** \brief subsequence length at which the initial work will start (must be power of 2) */
 #define MIN_SUBLEN 128	// 128
 
+/** \brief largest number of worker threads accepted */
+#define MAX_THREADS 4096
+
 /** \brief shared region structure */
 struct SharedMemory {
 	char* fileName;
@@ -25,7 +28,6 @@ struct SharedMemory {
 
 	int maxRequests;
 	int curRequests;
-	int totalRequests;
 	int completeRequests;
 	
 	bool workAvailable;
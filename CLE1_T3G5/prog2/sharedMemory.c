@@ -28,6 +28,7 @@
 #include <errno.h>
 
 #include "consts.h"
+#include "../prog1/placement.h"
 
 /** \brief main thread return status */
 extern int statusMain;
@@ -47,9 +48,6 @@ static pthread_mutex_t accessCR = PTHREAD_MUTEX_INITIALIZER;
 /** \brief flag which warrants that the data transfer region is initialized exactly once */
 static pthread_once_t init = PTHREAD_ONCE_INIT;
 
-/** \brief distributor synchronization point when waiting for work requests */
-static pthread_cond_t waitRequest;
-
 /** \brief distributor synchronization point when waiting for work done */
 static pthread_cond_t waitCompletion;
 
@@ -69,12 +67,10 @@ static void initialization(void)
 	sharedMemory.maxRequests = 0;
 	sharedMemory.curRequests = 0;
 	sharedMemory.completeRequests = 0;
-	sharedMemory.totalRequests = 0;
 	
 	sharedMemory.workAvailable = false;
 	sharedMemory.workNeeded = true;
 	
-	pthread_cond_init (&waitRequest, NULL);				/* initialize distributor synchronization point */
 	pthread_cond_init (&waitCompletion, NULL);			/* initialize distributor synchronization point */
 	pthread_cond_init (&waitAssignment, NULL);			/* initialize workers synchronization point */
 }
@@ -214,7 +210,7 @@ void readIntegerSequence(void)
 		sharedMemory.maxRequests = sharedMemory.sequenceLen / MIN_SUBLEN;
 	
 	/* alocate integer sequence memory */
-	if ((sharedMemory.integerSequence = malloc(sharedMemory.sequenceLen * sizeof(int))) == NULL)
+	if ((sharedMemory.integerSequence = allocShared(sharedMemory.sequenceLen * sizeof(int))) == NULL)
 	{
 		fprintf(stderr, "error on allocating space to file name\n");
 		statusDistributor = EXIT_FAILURE;
@@ -252,10 +248,13 @@ void readIntegerSequence(void)
 }
 
 /**
- *  \brief Read binary file integer sequence.
+ *  \brief Hand out a level of the sort and wait for it to be done.
  *
  *  Operation carried out by distributor
  *
+ *  The whole level is published at once and the workers take its subsequences one after the other,
+ *  so no worker waits for the distributor to hand it a subsequence.
+ *
  *  \return true if there is more work to be done
  */
 
@@ -269,58 +268,6 @@ bool assignWork(void)
 		pthread_exit(&statusDistributor);
 	}
 	pthread_once(&init, initialization);                                       				/* internal data initialization */
-  
-	while (sharedMemory.totalRequests == 0 || sharedMemory.workAvailable)					/* wait while there are no work requests or no thread picked the current work */
-	{
-		if ((statusDistributor = pthread_cond_wait(&waitRequest, &accessCR)) != 0)
-		{
-			errno = statusDistributor;                            							/* save error in errno */
-			perror("error on waiting in waitRequest");
-			statusDistributor = EXIT_FAILURE;
-			pthread_exit(&statusDistributor);
-		}
-	}
-	
-	sharedMemory.totalRequests--;
-	
-	/* prepare work */
-	//int subSequenceLen = sharedMemory.sequenceLen / sharedMemory.maxRequests;
-	
-	sharedMemory.workAvailable = true;
-	sharedMemory.curRequests++;
-	
-	/* give work */
-	if ((statusDistributor = pthread_cond_signal(&waitAssignment)) != 0)
-	{
-		errno = statusDistributor;                            									/* save error in errno */
-		perror ("error on signaling waitAssignment");
-		statusDistributor = EXIT_FAILURE;
-		pthread_exit (&statusDistributor);
-	}
-	
-	/* if all iteration requests were completed wait for all work to be done and proceed to next iteration */
-	if (sharedMemory.curRequests == sharedMemory.maxRequests)
-	{
-		//sharedMemory.workNeeded = false;
-		
-		while (sharedMemory.completeRequests != sharedMemory.maxRequests)						/* wait while the current iteration work has not been completed */
-		{
-			if ((statusDistributor = pthread_cond_wait(&waitCompletion, &accessCR)) != 0)
-			{
-				errno = statusDistributor;                            							/* save error in errno */
-				perror ("error on waiting in waitCompletion");
-				statusDistributor = EXIT_FAILURE;
-				pthread_exit (&statusDistributor);
-			}
-		}
-		
-		sharedMemory.maxRequests /= 2;
-		sharedMemory.curRequests = 0;
-		sharedMemory.completeRequests = 0;
-		//sharedMemory.workNeeded = true;
-		
-		printf("[Distributor] waiting for work completion\n");
-	}
 	
 	/* check if all work is done */
 	if (sharedMemory.maxRequests < 1)
@@ -328,10 +275,10 @@ bool assignWork(void)
 		sharedMemory.workNeeded = false;
 		
 		/* inform there is no more work */
-		if ((statusDistributor = pthread_cond_signal(&waitAssignment)) != 0)
+		if ((statusDistributor = pthread_cond_broadcast(&waitAssignment)) != 0)
 		{
 			errno = statusDistributor;                            									/* save error in errno */
-			perror ("error on signaling waitAssignment");
+			perror ("error on broadcasting waitAssignment");
 			statusDistributor = EXIT_FAILURE;
 			pthread_exit (&statusDistributor);
 		}
@@ -347,6 +294,36 @@ bool assignWork(void)
 		return false;
 	}
 	
+	/* give work, every subsequence of the level */
+	sharedMemory.curRequests = 0;
+	sharedMemory.completeRequests = 0;
+	sharedMemory.workAvailable = true;
+	
+	if ((statusDistributor = pthread_cond_broadcast(&waitAssignment)) != 0)
+	{
+		errno = statusDistributor;                            									/* save error in errno */
+		perror ("error on broadcasting waitAssignment");
+		statusDistributor = EXIT_FAILURE;
+		pthread_exit (&statusDistributor);
+	}
+	
+	printf("[Distributor] waiting for work completion\n");
+	
+	/* wait for all work to be done and proceed to next iteration */
+	while (sharedMemory.completeRequests != sharedMemory.maxRequests)						/* wait while the current iteration work has not been completed */
+	{
+		if ((statusDistributor = pthread_cond_wait(&waitCompletion, &accessCR)) != 0)
+		{
+			errno = statusDistributor;                            							/* save error in errno */
+			perror ("error on waiting in waitCompletion");
+			statusDistributor = EXIT_FAILURE;
+			pthread_exit (&statusDistributor);
+		}
+	}
+	
+	sharedMemory.workAvailable = false;
+	sharedMemory.maxRequests /= 2;
+	
 	if ((statusDistributor = pthread_mutex_unlock(&accessCR)) != 0)								/* exit monitor */
 	{
 		errno = statusDistributor;																/* save error in errno */
@@ -377,29 +354,11 @@ int* requestWork(int workerId, int* subSequenceLen, int* startOffset, int* endOf
 	}
 	pthread_once(&init, initialization);                                       						/* internal data initialization */
 	
-	/* request work */
-	sharedMemory.totalRequests++;
-	if ((statusWorkers[workerId] = pthread_cond_signal(&waitRequest)) != 0)
-	{
-		errno = statusWorkers[workerId];                         									/* save error in errno */
-		perror ("error on signaling waitRequest");
-		statusWorkers[workerId] = EXIT_FAILURE;
-		pthread_exit(&statusWorkers[workerId]);
-	}
-	
-	while (!sharedMemory.workAvailable)																/* wait while there is no work available */
+	while (!sharedMemory.workAvailable || sharedMemory.curRequests == sharedMemory.maxRequests)		/* wait while there is no work available */
 	{
 		/* check if all work is done */
 		if (!sharedMemory.workNeeded)
 		{
-			if ((statusDistributor = pthread_cond_signal(&waitAssignment)) != 0)
-			{
-				errno = statusDistributor;                            								/* save error in errno */
-				perror ("error on signaling waitAssignment");
-				statusDistributor = EXIT_FAILURE;
-				pthread_exit (&statusDistributor);
-			}
-			
 			if ((statusWorkers[workerId] = pthread_mutex_unlock(&accessCR)) != 0)					/* exit monitor */
 			{
 				errno = statusWorkers[workerId];													/* save error in errno */
@@ -421,22 +380,12 @@ int* requestWork(int workerId, int* subSequenceLen, int* startOffset, int* endOf
 		}
 	}
 	
-	/* get work */
+	/* get work, the next subsequence of the level */
+	sharedMemory.curRequests++;
 	*subSequenceLen = sharedMemory.sequenceLen / sharedMemory.maxRequests;
 	*startOffset = (sharedMemory.curRequests - 1) * (*subSequenceLen);
 	*endOffset = sharedMemory.curRequests * (*subSequenceLen) - 1;
 	
-	sharedMemory.workAvailable = false;
-	
-	/* signal that the work was taken */
-	if ((statusWorkers[workerId] = pthread_cond_signal(&waitRequest)) != 0)
-	{
-		errno = statusWorkers[workerId];                         									/* save error in errno */
-		perror ("error on signaling waitRequest");
-		statusWorkers[workerId] = EXIT_FAILURE;
-		pthread_exit(&statusWorkers[workerId]);
-	}
-	
 	if ((statusWorkers[workerId] = pthread_mutex_unlock(&accessCR)) != 0)							/* exit monitor */
 	{
 		errno = statusWorkers[workerId];															/* save error in errno */
@@ -468,9 +417,9 @@ void informWork(int workerId)
 	}
 	pthread_once(&init, initialization);                                       						/* internal data initialization */
 	
-	/* inform work done */
+	/* inform work done, the distributor only wakes up once the level is done */
 	sharedMemory.completeRequests++;
-	if ((statusWorkers[workerId] = pthread_cond_signal(&waitCompletion)) != 0)
+	if (sharedMemory.completeRequests == sharedMemory.maxRequests && (statusWorkers[workerId] = pthread_cond_signal(&waitCompletion)) != 0)
 	{
 		errno = statusWorkers[workerId];                         									/* save error in errno */
 		perror ("error on signaling waitCompletion");
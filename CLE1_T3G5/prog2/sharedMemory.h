@@ -52,7 +52,7 @@ extern void validateArray(void);
 extern void readIntegerSequence(void);
 
 /**
- *  \brief Read binary file integer sequence.
+ *  \brief Hand out a level of the sort and wait for it to be done.
  *
  *  Operation carried out by distributor
  *
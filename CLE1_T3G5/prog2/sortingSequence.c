@@ -13,10 +13,14 @@
  */
  
 //	compile command
-// 		gcc -Wall -O3 -o sortingSequence sortingSequence.c sharedMemory.c -lpthread -lm
+// 		gcc -Wall -O3 -o sortingSequence sortingSequence.c sharedMemory.c ../prog1/placement.c -lpthread -lm
 
 //	run command
-// 		./sortingSequence 4 datSeq32.bin
+// 		./sortingSequence [-P policy] 4 datSeq32.bin
+// 		./sortingSequence datSeq32.bin		(one worker per online cpu)
+//
+//	options
+//		-P policy	pin the workers to cores ("compact", "scatter" or "none") and print their throughput
  
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,6 +34,7 @@
 
 #include "consts.h"
 #include "sharedMemory.h"
+#include "../prog1/placement.h"
 
 //#define nWorkers 4
 
@@ -51,6 +56,9 @@ static void *worker(void *id);
 /** \brief execution time measurement */
 static double get_delta_time(void);
 
+/** \brief thread number given in the command line */
+static int threadNumber(const char* arg);
+
 /** \brief bitonic sort a sequence of integers */
 static void sortSequence(int* integerSequence, int* subSequenceLen, int* startOffset, int* endOffset);
 
@@ -68,15 +76,45 @@ static void sortSequence(int* integerSequence, int* subSequenceLen, int* startOf
 
 int main(int argc, char *argv[])
 {
+	const char* placementPolicy = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "P:")) != -1)
+	{
+		switch (opt)
+		{
+			case 'P':
+				placementPolicy = optarg;
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-P compact|scatter|none] [nThreads] fileName\n", basename(argv[0]));
+				exit(EXIT_FAILURE);
+		}
+	}
+
 	// not enough arguments provided
-	if (argc < 3)
+	if (argc - optind < 1)
 	{
-		fprintf(stderr, "no thread number or file name provided\n");
+		fprintf(stderr, "no file name provided\n");
 		exit(EXIT_FAILURE);
 	}
 	
-	// get number of threads
-	int nWorkers = argv[1][0] - '0';
+	// get number of threads, one per online cpu if not given
+	int nWorkers = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	
+	if (argc - optind > 1)
+	{
+		if ((nWorkers = threadNumber(argv[optind])) < 1)
+		{
+			fprintf(stderr, "invalid number of threads \"%s\" (1 to %d)\n", argv[optind], MAX_THREADS);
+			exit(EXIT_FAILURE);
+		}
+		optind++;
+	}
+	if (nWorkers > MAX_THREADS)
+		nWorkers = MAX_THREADS;
+	if (nWorkers < 1)
+		nWorkers = 1;
 	
 	if ((statusWorkers = malloc (nWorkers * sizeof (int))) == NULL)
 	{
@@ -103,7 +141,11 @@ int main(int argc, char *argv[])
 	(void) get_delta_time();
 	
 	/* fill shared memory with file name */
-	fillFileName(argv[2]);
+	fillFileName(argv[optind]);
+
+	/* choose the cpu of each worker, before the distributor allocates the sequence */
+	if (placementPolicy != NULL)
+		initPlacement(placementPolicy, nWorkers);
 
 	/* generation of intervening entity threads */
 	if (pthread_create(&tIdDistributor, NULL, distributor, 0) != 0)	/* thread distributor */
@@ -114,7 +156,7 @@ int main(int argc, char *argv[])
 	
 	for (int i = 0; i < nWorkers; i++)
 	{
-		if (pthread_create(&tIdWorkers[i], NULL, worker, &workers[i]) != 0)		/* thread worker */
+		if (pthread_create(&tIdWorkers[i], workerAttributes(i), worker, &workers[i]) != 0)		/* thread worker */
 		{
 			perror("error on creating thread worker");
 			exit(EXIT_FAILURE);
@@ -143,6 +185,8 @@ int main(int argc, char *argv[])
 	
 	/* validate sorted sequence */
 	validateArray();
+
+	printPlacement("Mi");
 	
 	printf("\nElapsed time = %.6f s\n", get_delta_time());
 
@@ -186,6 +230,8 @@ static void *worker(void *par)
 	int endOffset = 0;
 	int workLeft = 0;
 
+	beginWork(id);
+
 	while ((integerSequence = requestWork(id, &subSequenceLen, &startOffset, &endOffset, &workLeft)))
 	{
 		if (workLeft == 0)
@@ -198,10 +244,13 @@ static void *worker(void *par)
 		
 		//printf("[Worker %d] working!\n", id);
 		sortSequence(integerSequence, &subSequenceLen, &startOffset, &endOffset);
+		recordWork(id, endOffset - startOffset + 1);	/* endOffset is inclusive */
 		informWork(id);
 		//printf("Worker %d finished!\n", id); 
 	}
 
+	endWork(id);
+
 	statusWorkers[id] = EXIT_SUCCESS;
 	pthread_exit(&statusWorkers[id]);
 }
@@ -285,4 +334,27 @@ static void sortSequence(int* integerSequence, int* subSequenceLen, int* startOf
 			}
 		}
 	}
+}
+
+/**
+ *  \brief Thread number given in the command line.
+ *
+ *  \param arg argument before the file name
+ *
+ *  \return number of threads, 0 if it is not a number from 1 to MAX_THREADS
+ */
+
+static int threadNumber(const char* arg)
+{
+	long number = 0;
+	
+	for (const char* c = arg; *c != '\0'; c++)
+	{
+		if (!isdigit((unsigned char) *c))
+			return 0;
+		if (number <= MAX_THREADS)
+			number = number * 10 + (*c - '0');
+	}
+	
+	return (number >= 1 && number <= MAX_THREADS) ? (int) number : 0;
 }
\ No newline at end of file
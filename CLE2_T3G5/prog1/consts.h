@@ -31,22 +31,84 @@
 /** \brief "y" character offset */
 #define Y 5
 
-/** \brief chunck size to be read */
-#define  MAX_CHUNK_SIZE           4096
+/** \brief smallest chunk size to be read */
+#define  MIN_CHUNK_SIZE           4096
 
-/** \brief file results structure */
+/** \brief largest chunk size to be read (chunk messages only carry the bytes read) */
+#define  MAX_CHUNK_SIZE           (1 << 20)
+
+/** \brief guided chunks are the remaining bytes split this many times per worker */
+#define  GUIDED_FACTOR            2
+
+/** \brief longest utf-8 char taken by the decoder, a lead byte announces up to 6 bytes */
+#define  MAX_CHAR_BYTES           6
+
+/** \brief the sidecar index keeps a safe split point about every this many bytes */
+#define  INDEX_STRIDE             (16 * 1024)
+
+/** \brief file results structure, 64-bit counters so files past 4 GB do not overflow */
 struct FileResult {
-	int nWords;
-	int vowels[6];
+	long nWords;
+	long vowels[6];
 	int fileId;
 };
 
+/** \brief chunk edges structure, the runs and bytes of a chunk only its neighbours can complete */
+struct ChunkEdges {
+	bool separator;				/* the chunk has a separator */
+	bool headWord;				/* run before the first separator (the whole chunk without one) has word characters */
+	bool tailWord;				/* run after the last separator has word characters */
+	unsigned int headVowels;	/* vowel bits of the run before the first separator */
+	unsigned int tailVowels;	/* vowel bits of the run after the last separator */
+	int headLen;
+	int tailLen;
+	unsigned char headBytes[MAX_CHAR_BYTES - 1];	/* leading continuation bytes, they may end the char cut at the start */
+	unsigned char tailBytes[MAX_CHAR_BYTES - 1];	/* bytes of the char cut at the end */
+	bool headOnly;				/* every byte of the chunk is a head byte */
+};
+
+/** \brief chunk summary structure, the words between the first and the last separators of a chunk and its edges */
+struct ChunkSummary {
+	long nWords;
+	long vowels[6];
+	struct ChunkEdges edges;
+	int fileId;
+	int chunkId;
+};
+
 /** \brief chunk data structure */
 struct ChunkData {
 	int hasWork;
 	int fileId;
+	int chunkId;				/* chunks are numbered in file order, their summaries are joined in that order */
 	int chunkSize;
+	long offset;				/* start of a range the worker reads itself */
 	unsigned char buffer[MAX_CHUNK_SIZE];
 };
 
+/** \brief sidecar index header, followed by count split points (offsets of ascii separators) */
+struct IndexHeader {
+	char magic[8];
+	long size;
+	long mtimeSec;
+	long mtimeNsec;
+	int stride;
+	int count;
+};
+
+/** \brief split points of a file, loaded from its sidecar index or collected while the file is read */
+struct FileIndex {
+	bool loaded;				/* ranges are handed out from the split points */
+	bool building;				/* split points are collected from the chunks read */
+	long size;
+	long mtimeSec;
+	long mtimeNsec;
+	long* offsets;
+	int count;
+	int capacity;
+	int next;					/* next split point to hand out */
+	long scanned;				/* bytes of the file already looked at */
+	long nextMark;				/* no split point is looked for before this offset */
+};
+
 #endif /* CONSTS_H_ */
@@ -14,10 +14,20 @@
 //	run command
 // 		mpiexec -n 5 ./countWords text0.txt text1.txt text2.txt text3.txt text4.txt
 
+//	options
+// 		-c bytes	fixed chunk size, otherwise chunks are a share of the bytes left and shrink toward the end
+// 		-i		keep a sidecar index of safe split points next to each file (file.cwi), valid indexes let
+// 				the workers read their ranges themselves, stale or missing ones are rebuilt while scanning
+
+#define _FILE_OFFSET_BITS 64
+
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <math.h>
@@ -30,25 +40,38 @@
 // general definitions
 #define WORKTODO       1
 #define NOMOREWORK     0
+#define WORKRANGE      2
 
 #define FILECONTINUE	0
 #define FILECOMPLETE	1
 #define FILEERROR	    2
 
+// malformed utf-8 sequence, taken as U+FFFD (neither a word character nor a separator)
+#define MALFORMED_CHAR	0xEFBFBD
+
 //#define DEBUG
 
 // internal functions declaration
 static double get_delta_time(void);
 static int parseCommandLine(char** commandLineArgs, int* totalFiles, char*** fileNames, struct FileResult** fileResults);
-static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* fileId);
+static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* fileId, int chunkLimit);
+static int nextChunkLimit(off_t remaining, int nWorkers, int chunkOption);
+static void loadIndex(char* fileName, struct FileIndex* index);
+static int getFileRange(struct ChunkData** chunkData, struct FileIndex* index, FILE** currentFile, int* fileId, int chunkLimit);
+static void indexChunk(struct FileIndex* index, unsigned char* buffer, int chunkSize);
+static void storeIndex(char* fileName, struct FileIndex* index);
+static int readRange(struct ChunkData* chunkData, char** fileNames, int* fds);
 static bool isSeparator(int c);
 static void printResults(int totalFiles, struct FileResult* fileResults, char** fileNames);
 
-static struct FileResult processChunk(unsigned char* buffer, int chunkSize);
-static void setToZero(int array[6]);
+static struct ChunkSummary processChunk(unsigned char* buffer, int chunkSize);
+static int cutCharStart(unsigned char* bytes, int from, int size);
+static void addChar(struct ChunkSummary* summary, int c, bool* word, unsigned int* vowelMask);
+static void closeRun(struct ChunkSummary* summary, bool word, unsigned int vowelMask);
+static void joinEdges(struct ChunkSummary* summary, struct ChunkSummary* next);
+static void addSummary(struct FileResult* fileResult, struct ChunkSummary* summary);
 static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsigned char UTF8Char[5]);
 static int isVowel(int c);
-static void processAChar(int c, int* inWord, int* nWords, int nWordswVowel[6], int firstOccur[6]);
 static int vowelOffset(int c);
 
 /**
@@ -66,12 +89,15 @@ int main(int argc, char *argv[])
 	// MPI initializations
 	int rank, nProc;
 	struct ChunkData *chunkData = NULL;
-	struct FileResult *resultData = NULL;
+	struct ChunkSummary *resultData = NULL;
 	
 	MPI_Init(&argc, &argv);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 	MPI_Comm_size(MPI_COMM_WORLD, &nProc);
 	int save = nProc;
+	int chunkOption = 0;
+	bool useIndex = false;
+	int opt;
 	
 	if (nProc < 2)
 	{
@@ -80,8 +106,26 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 	
+	// parse command line options
+	while ((opt = getopt(argc, argv, "c:i")) != -1)
+	{
+		if (opt == 'i')
+		{
+			useIndex = true;
+			continue;
+		}
+		chunkOption = (opt == 'c') ? atoi(optarg) : -1;
+		if (chunkOption < MIN_CHUNK_SIZE || chunkOption > MAX_CHUNK_SIZE)
+		{
+			if (rank == 0)
+				fprintf(stderr, "usage: %s [-c bytes (%d to %d)] [-i] file...\n", argv[0], MIN_CHUNK_SIZE, MAX_CHUNK_SIZE);
+			MPI_Finalize();
+			return EXIT_FAILURE;
+		}
+	}
+	
 	// not enough arguments provided
-	if (argc < 2)
+	if (argc - optind < 1)
 	{
 		fprintf(stderr, "no file name provided\n");
 		MPI_Finalize();
@@ -95,7 +139,7 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 	
-	if (((resultData = malloc(sizeof(struct FileResult))) == NULL))
+	if (((resultData = malloc(sizeof(struct ChunkSummary))) == NULL))
 	{
 		fprintf(stderr, "error on allocating space to the result data buffer\n");
 		MPI_Finalize();
@@ -115,16 +159,51 @@ int main(int argc, char *argv[])
 		//int chunkSize = 0;	// NOT NEEDED, ALREADY IN THE "chunkData" STRUCTURE (DELETE THIS LATER)
 		//bool openFile = true;
 		bool* availWorkers;
-		struct FileResult* resultsBuffer;
+		struct ChunkSummary* resultsBuffer;
+		struct ChunkData* sendBuffers;
 		MPI_Request reqSnd[nProc], reqRec[nProc];
+		off_t remaining = 0;
+		struct FileIndex* indexes = NULL;
+		struct ChunkSummary* summaries = NULL;		// summary of every chunk handed out, joined in order at the end
+		int totalChunks = 0, maxChunks = 0;
 		
 		// parse command line arguments and initialize file names and file results array
-		if (parseCommandLine(argv, &totalFiles, &fileNames, &fileResults) == 1)
+		if (parseCommandLine(&argv[optind - 1], &totalFiles, &fileNames, &fileResults) == 1)
 		{
 			MPI_Finalize();
 			return EXIT_FAILURE;
 		}
 		
+		// total size of the files, guided chunks are a share of the bytes not yet read
+		for (int i = 0; i < totalFiles; i++)
+		{
+			struct stat fileStat;
+			if (stat(fileNames[i], &fileStat) == 0)
+				remaining += fileStat.st_size;
+		}
+		
+		// load the sidecar indexes, files without a valid one are scanned and get it rebuilt
+		if (useIndex)
+		{
+			if (((indexes = calloc(totalFiles, sizeof(struct FileIndex))) == NULL))
+			{
+				fprintf(stderr, "error on allocating space to the file indexes\n");
+				MPI_Finalize();
+				return EXIT_FAILURE;
+			}
+			for (int i = 0; i < totalFiles; i++)
+				loadIndex(fileNames[i], &indexes[i]);
+		}
+		
+		// allocate one chunk buffer per worker, a buffer is only reused once its send completed
+		if (((sendBuffers = malloc(nProc * sizeof(struct ChunkData))) == NULL))
+		{
+			fprintf(stderr, "error on allocating space to the chunk buffers\n");
+			MPI_Finalize();
+			return EXIT_FAILURE;
+		}
+		for (int i = 0; i < nProc; i++) reqSnd[i] = MPI_REQUEST_NULL;
+		
 		// initialize available workers array
 		if (((availWorkers = malloc(nProc * sizeof(bool))) == NULL))
 		{
@@ -135,7 +214,7 @@ int main(int argc, char *argv[])
 		for (int i = 0; i < nProc; i++) availWorkers[i] = true;
 		
 		// allocate memory for results buffer
-		if (((resultsBuffer = malloc(nProc * sizeof(struct FileResult))) == NULL))
+		if (((resultsBuffer = malloc(nProc * sizeof(struct ChunkSummary))) == NULL))
 		{
 			fprintf(stderr, "error on allocating space to the results buffer pointers\n");
 			MPI_Finalize();
@@ -161,8 +240,42 @@ int main(int argc, char *argv[])
 				// workers available to receive work
 				if (availWorkers[i])
 				{
-					// get chunk of text
-					if (getFileChunk(&chunkData, &currentFile, &fileId) == FILECOMPLETE)
+					// previous chunk of this worker was received, its buffer can be refilled
+					MPI_Wait(&reqSnd[i], MPI_STATUS_IGNORE);
+					chunkData = &sendBuffers[i];
+					
+					// get chunk of text, only its range when the file has a valid index
+					int chunkFile = fileId;
+					int chunkLimit = nextChunkLimit(remaining, nProc - 1, chunkOption);
+					int status;
+					if (indexes != NULL && indexes[chunkFile].loaded)
+						status = getFileRange(&chunkData, &indexes[chunkFile], &currentFile, &fileId, chunkLimit);
+					else
+					{
+						status = getFileChunk(&chunkData, &currentFile, &fileId, chunkLimit);
+						if (indexes != NULL && indexes[chunkFile].building)
+						{
+							indexChunk(&indexes[chunkFile], chunkData->buffer, chunkData->chunkSize);
+							if (status == FILECOMPLETE)
+								storeIndex(fileNames[chunkFile], &indexes[chunkFile]);
+						}
+					}
+					remaining -= chunkData->chunkSize;
+					
+					// number the chunk, its summary is kept until the chunks of its file are joined
+					if (totalChunks == maxChunks)
+					{
+						maxChunks = (maxChunks == 0) ? 1024 : 2 * maxChunks;
+						if (((summaries = realloc(summaries, maxChunks * sizeof(struct ChunkSummary))) == NULL))
+						{
+							fprintf(stderr, "error on allocating space to the chunk summaries\n");
+							MPI_Finalize();
+							return EXIT_FAILURE;
+						}
+					}
+					chunkData->chunkId = totalChunks++;
+					
+					if (status == FILECOMPLETE)
 					{
 						// check if all files have been parsed
 						if (fileId < totalFiles)
@@ -176,11 +289,11 @@ int main(int argc, char *argv[])
 							}
 						}
 					}
-					// send data chunk
-					MPI_Isend(chunkData, sizeof(struct ChunkData), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqSnd[i]);
+					// send data chunk, only the bytes read (none for a range)
+					MPI_Isend(chunkData, offsetof(struct ChunkData, buffer) + ((chunkData->hasWork == WORKRANGE) ? 0 : chunkData->chunkSize), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqSnd[i]);
 					
 					// open receiving buffer worker
-					MPI_Irecv(&resultsBuffer[i], sizeof(struct FileResult), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqRec[i]);
+					MPI_Irecv(&resultsBuffer[i], sizeof(struct ChunkSummary), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqRec[i]);
 					availWorkers[i] = false;
 				}
 				// workers already with work assigned
@@ -191,13 +304,11 @@ int main(int argc, char *argv[])
 					// worker delivered results
 					if (hasMessage)
 					{
-						struct FileResult* result = &resultsBuffer[i];
+						struct ChunkSummary* result = &resultsBuffer[i];
 						//printf("Receiving result of file %d in box %d\n", result->fileId, i);
 						
 						// save results
-						fileResults[result->fileId].nWords += result->nWords;
-						for (int j = 0; j < 6; j++)
-							fileResults[result->fileId].vowels[j] += result->vowels[j];
+						summaries[result->chunkId] = *result;
 						
 						availWorkers[i] = true;
 					}
@@ -213,18 +324,29 @@ int main(int argc, char *argv[])
 			{
 				MPI_Wait(&reqRec[i], MPI_STATUS_IGNORE);
 				
-				struct FileResult* result = &resultsBuffer[i];
+				struct ChunkSummary* result = &resultsBuffer[i];
 				
 				// save results
-				fileResults[result->fileId].nWords += result->nWords;
-				for (int j = 0; j < 6; j++)
-					fileResults[result->fileId].vowels[j] += result->vowels[j];
+				summaries[result->chunkId] = *result;
 				
 				nProc = save;
 			}
 			
+			MPI_Wait(&reqSnd[i], MPI_STATUS_IGNORE);
+			chunkData = &sendBuffers[i];
 			chunkData->hasWork = NOMOREWORK;
-			MPI_Send(chunkData, sizeof(struct ChunkData), MPI_BYTE, i, 0, MPI_COMM_WORLD);
+			MPI_Send(chunkData, offsetof(struct ChunkData, buffer), MPI_BYTE, i, 0, MPI_COMM_WORLD);
+		}
+		
+		// join the chunk summaries of each file in order, the chunks of a file are numbered one after the other
+		struct ChunkSummary fileSummary;
+		for (int k = 0; k < totalChunks; k++)
+		{
+			if (k == 0 || summaries[k].fileId != summaries[k - 1].fileId)
+				memset(&fileSummary, 0, sizeof(struct ChunkSummary));
+			joinEdges(&fileSummary, &summaries[k]);
+			if (k == totalChunks - 1 || summaries[k + 1].fileId != summaries[k].fileId)
+				addSummary(&fileResults[summaries[k].fileId], &fileSummary);
 		}
 		
 		// print final results
@@ -236,6 +358,21 @@ int main(int argc, char *argv[])
 	// workers processes
 	else
 	{
+		int totalFiles = argc - optind;
+		int* fds = NULL;
+		
+		// files of the ranges are opened on first use
+		if (useIndex)
+		{
+			if (((fds = malloc(totalFiles * sizeof(int))) == NULL))
+			{
+				fprintf(stderr, "error on allocating space to the file descriptors\n");
+				MPI_Finalize();
+				return EXIT_FAILURE;
+			}
+			for (int i = 0; i < totalFiles; i++) fds[i] = -1;
+		}
+		
 		while (true)
 		{
 			// wait for work
@@ -244,12 +381,22 @@ int main(int argc, char *argv[])
 			if (chunkData->hasWork == NOMOREWORK)
 				break;
 			
+			// read the range of text handed out
+			if (chunkData->hasWork == WORKRANGE && readRange(chunkData, &argv[optind], fds) != 0)
+				chunkData->chunkSize = 0;
+			
 			*resultData = processChunk(chunkData->buffer, chunkData->chunkSize);
 			resultData->fileId = chunkData->fileId;
+			resultData->chunkId = chunkData->chunkId;
 			
 			// send results
-			MPI_Send(resultData, sizeof(struct FileResult), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+			MPI_Send(resultData, sizeof(struct ChunkSummary), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
 		}
+		
+		if (fds != NULL)
+			for (int i = 0; i < totalFiles; i++)
+				if (fds[i] != -1)
+					close(fds[i]);
 	}
 	
 #ifdef DEBUG
@@ -351,13 +498,18 @@ static int parseCommandLine(char** commandLineArgs, int* totalFiles, char*** fil
  *
  *  Operation carried out by the dispatcher process.
  *
+ *  The file is cut at fixed offsets, every chunk but the last one of a file is chunkLimit bytes long.
+ *  The words and the utf-8 chars cut are completed when the chunk summaries are joined, so nothing
+ *  is scanned backwards and the file is never rewound.
+ *
  *  \param chunkData chunk data structure
  *  \param currentFile current file being parsed
  *  \param fileId file identifier
+ *  \param chunkLimit maximum chunk size
  *
  *	\return function execution status
  */
-static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* fileId)
+static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* fileId, int chunkLimit)
 {
 	(*chunkData)->hasWork = WORKTODO;
 	
@@ -365,15 +517,15 @@ static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* f
 	(*chunkData)->fileId = *fileId;
 	
 	// read chunk of text
-    if (((*chunkData)->chunkSize = fread((*chunkData)->buffer, 1, MAX_CHUNK_SIZE - 1, *currentFile)) == EOF)
+	(*chunkData)->chunkSize = fread((*chunkData)->buffer, 1, chunkLimit, *currentFile);
+	if (ferror(*currentFile))
 	{
 		fprintf(stderr, "error on getting file chunk\n");
 		return FILEERROR;
 	}
-	(*chunkData)->buffer[((*chunkData)->chunkSize - 1)] = '\0';
 	
 	// the file was completely read, point to the next one
-	if ((*chunkData)->chunkSize < MAX_CHUNK_SIZE - 1)
+	if ((*chunkData)->chunkSize < chunkLimit)
 	{
 		if (fclose(*currentFile) == EOF)
 		{
@@ -383,110 +535,291 @@ static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* f
 		(*fileId)++;
 		return FILECOMPLETE;
 	}
-	// the file still has content, check if we are in the middle of a word
-	else
+	
+	return FILECONTINUE;
+}
+
+/**
+ *  \brief Get the maximum size of the next chunk.
+ *
+ *  Auxilar function.
+ *
+ *  Guided chunks are a share of the bytes not yet read, so they are large at the start of the run
+ *  and shrink down to MIN_CHUNK_SIZE toward its end.
+ *
+ *  \param remaining bytes of all the files not yet read
+ *  \param nWorkers number of worker processes
+ *  \param chunkOption chunk size given in the command line (0 if none)
+ *
+ *	\return chunk size limit
+ */
+static int nextChunkLimit(off_t remaining, int nWorkers, int chunkOption)
+{
+	if (chunkOption > 0)
+		return chunkOption;
+	
+	off_t limit = remaining / (GUIDED_FACTOR * nWorkers);
+	
+	if (limit < MIN_CHUNK_SIZE)
+		return MIN_CHUNK_SIZE;
+	if (limit > MAX_CHUNK_SIZE)
+		return MAX_CHUNK_SIZE;
+	return (int) limit;
+}
+
+/**
+ *  \brief Load the sidecar index of a file.
+ *
+ *  Operation carried out by the dispatcher process.
+ *
+ *  The index is only taken when the size and modification time it was written for are still those
+ *  of the file and its split points leave no range larger than a chunk, otherwise the file is
+ *  scanned and the index rebuilt from the chunks read.
+ *
+ *  \param fileName file name
+ *  \param index index of the file
+ */
+static void loadIndex(char* fileName, struct FileIndex* index)
+{
+	struct stat fileStat;
+	struct IndexHeader header;
+	char indexName[4096];
+	FILE* indexFile;
+	
+	if (stat(fileName, &fileStat) != 0)
+		return;
+	
+	index->size = fileStat.st_size;
+	index->mtimeSec = fileStat.st_mtim.tv_sec;
+	index->mtimeNsec = fileStat.st_mtim.tv_nsec;
+	index->building = true;
+	index->nextMark = INDEX_STRIDE;
+	
+	snprintf(indexName, sizeof(indexName), "%s.cwi", fileName);
+	if ((indexFile = fopen(indexName, "r")) == NULL)
+		return;
+	
+	// stale or foreign index
+	if (fread(&header, sizeof(struct IndexHeader), 1, indexFile) != 1 || memcmp(header.magic, "CWINDEX1", 8) != 0 ||
+		header.size != index->size || header.mtimeSec != index->mtimeSec || header.mtimeNsec != index->mtimeNsec ||
+		header.count < 0 || header.count > index->size / 2 + 1)
 	{
-		long currentFilePos;
-		int c = 0, j = 0, k = 0;
-		char cbuffer[4] = "";
-		
-		// check for uncomplete utf8 character
-		for (int i = (*chunkData)->chunkSize - 1; i >= 0; i--)
+		fclose(indexFile);
+		return;
+	}
+	
+	if (((index->offsets = malloc((header.count + 1) * sizeof(long))) == NULL) ||
+		fread(index->offsets, sizeof(long), header.count, indexFile) != (size_t) header.count)
+	{
+		fclose(indexFile);
+		free(index->offsets);
+		index->offsets = NULL;
+		return;
+	}
+	fclose(indexFile);
+	
+	// every range must fit in a chunk
+	long last = 0;
+	for (int i = 0; i <= header.count; i++)
+	{
+		long offset = (i < header.count) ? index->offsets[i] : index->size;
+		if (offset < last || offset - last > MAX_CHUNK_SIZE - 1)
 		{
-			// if the character is ascii, we can continue
-			if (j == 0 && ((*chunkData)->buffer[i] & 0x80) == 0)
-			{
-				//printf("ascii char, all good\n");
-				break;
-			}
-			
-			// get how many bytes the utf-8 char occupies
-			int bytes;
-			for (bytes = 1; (*chunkData)->buffer[i] & (0x80 >> bytes); bytes++);
-			
-			// first utf8 byte, check if the buffer has all its content
-			if (bytes > 1)
-			{
-				// uncomplete utf-8 char, backtrack the buffer
-				if (bytes > j)
-				{
-					//printf("uncomplete utf-8 char, backtracking buffer");
-					if ((currentFilePos = ftell(*currentFile)) == -1L)
-					{
-						fprintf(stderr, "error on telling text file\n");
-						return FILEERROR;
-					}
-					if (fseek(*currentFile, currentFilePos - (j + 1), SEEK_SET) != 0)
-					{
-						fprintf(stderr, "error on seeking text file\n");
-						return FILEERROR;
-					}
-					(*chunkData)->chunkSize -= (j + 1);
-				}
-				break;
-			}
-			j++;
+			free(index->offsets);
+			index->offsets = NULL;
+			return;
 		}
+		last = offset;
+	}
+	
+	index->count = header.count;
+	index->capacity = header.count + 1;
+	index->loaded = true;
+	index->building = false;
+}
+
+/**
+ *  \brief Get the range of the next chunk of a file with a valid index.
+ *
+ *  Operation carried out by the dispatcher process.
+ *
+ *  Ranges are whole intervals between split points, as many as fit in the chunk limit and at least
+ *  one, so nothing is read here and the worker reads the range itself.
+ *
+ *  \param chunkData chunk data structure
+ *  \param index index of the current file
+ *  \param currentFile current file being parsed
+ *  \param fileId file identifier
+ *  \param chunkLimit maximum chunk size
+ *
+ *	\return function execution status
+ */
+static int getFileRange(struct ChunkData** chunkData, struct FileIndex* index, FILE** currentFile, int* fileId, int chunkLimit)
+{
+	long start = (index->next == 0) ? 0 : index->offsets[index->next - 1];
+	int last = index->next;
+	
+	// the range end is a split point, or the end of the file after the last one
+	while (last < index->count && ((last + 1 < index->count) ? index->offsets[last + 1] : index->size) - start <= chunkLimit - 1)
+		last++;
+	long end = (last < index->count) ? index->offsets[last] : index->size;
+	index->next = last + 1;
+	
+	(*chunkData)->hasWork = WORKRANGE;
+	(*chunkData)->fileId = *fileId;
+	(*chunkData)->offset = start;
+	(*chunkData)->chunkSize = (int) (end - start);
 	
-		// check for separation character
-		j = 0;
-		for (int i = (*chunkData)->chunkSize - 1; i >= 0; i--)
+	// the file was completely handed out, point to the next one
+	if (last == index->count)
+	{
+		if (fclose(*currentFile) == EOF)
 		{
-			cbuffer[j++] = (*chunkData)->buffer[i];
-			
-			// character is ascii, check if it is separator
-			if (((*chunkData)->buffer[i] & 0x80) == 0)
-			{
-				j = 0;
-				if (isSeparator((*chunkData)->buffer[i]))
-				{
-					//printf("ascci char is separator\n");
-					(*chunkData)->buffer[i] = '\0';
-					break;
-				}
-			}
-			
-			// get how many bytes the current utf-8 char occupies
-			int bytes;
-			for (bytes = 1; (*chunkData)->buffer[i] & (0x80 >> bytes); bytes++);
-			
-			// utf8 char first byte
-			if (bytes > 1)
-			{
-				//printf("checking utf-8 character\n");
-				for (int l = bytes - 1; l >= 0; l--)
-					c = (c << 8) | cbuffer[l];
-				
-				if (isSeparator((*chunkData)->buffer[i]))
-				{
-					//printf("utf-8 char is separator\n");
-					(*chunkData)->buffer[i] = '\0';
-					break;
-				}
-				
-				c = 0;
-			}
-			k++;
+			fprintf(stderr, "error on closing text file\n");
+			return FILEERROR;
 		}
+		(*fileId)++;
+		return FILECOMPLETE;
+	}
+	
+	return FILECONTINUE;
+}
+
+/**
+ *  \brief Collect the split points of a chunk read from a file being indexed.
+ *
+ *  Operation carried out by the dispatcher process.
+ *
+ *  A split point is the first ascii separator at least INDEX_STRIDE bytes past the previous one,
+ *  a range starting there never cuts a word or a utf-8 character. The chunks of a file are read
+ *  back to back, so a split point not found by the end of a chunk is looked for in the next one.
+ *
+ *  \param index index of the file
+ *  \param buffer chunk of text
+ *  \param chunkSize chunk size
+ */
+static void indexChunk(struct FileIndex* index, unsigned char* buffer, int chunkSize)
+{
+	long end = index->scanned + chunkSize;
+	long last = (index->count == 0) ? 0 : index->offsets[index->count - 1];
 	
-		//printf("1 chunkSize = %d\n", *chunkSize);
+	while (index->building && index->nextMark < end)
+	{
+		long offset = (index->nextMark > index->scanned) ? index->nextMark : index->scanned;
 		
-		if ((currentFilePos = ftell(*currentFile)) == -1L)
+		while (offset < end && (buffer[offset - index->scanned] >= 0x80 || !isSeparator(buffer[offset - index->scanned])))
+			offset++;
+		if (offset == end)
+			break;
+		
+		// no split point for longer than a chunk, the file is not indexed
+		if (offset - last > MAX_CHUNK_SIZE - 1)
 		{
-			fprintf(stderr, "error on telling text file\n");
-			return FILEERROR;
+			index->building = false;
+			break;
 		}
-		if (fseek(*currentFile, currentFilePos - (k + 1), SEEK_SET) != 0)
+		
+		if (index->count == index->capacity)
 		{
-			fprintf(stderr, "error on seeking text file\n");
-			return FILEERROR;
+			int capacity = (index->capacity == 0) ? 1024 : 2 * index->capacity;
+			long* offsets;
+			if ((offsets = realloc(index->offsets, capacity * sizeof(long))) == NULL)
+			{
+				index->building = false;
+				break;
+			}
+			index->offsets = offsets;
+			index->capacity = capacity;
 		}
-		(*chunkData)->chunkSize -= (k + 1);
 		
-		//printf("2 chunkSize = %d\n", *chunkSize);
+		index->offsets[index->count++] = last = offset;
+		index->nextMark = offset + INDEX_STRIDE;
 	}
 	
-	return FILECONTINUE;
+	index->scanned = end;
+}
+
+/**
+ *  \brief Write the sidecar index of a file once it was completely read.
+ *
+ *  Operation carried out by the dispatcher process.
+ *
+ *  The index is written to a temporary file and renamed, a file that could not be indexed or that
+ *  changed while it was read gets no index.
+ *
+ *  \param fileName file name
+ *  \param index index of the file
+ */
+static void storeIndex(char* fileName, struct FileIndex* index)
+{
+	struct IndexHeader header;
+	char indexName[4096], tmpName[4096 + 32];
+	FILE* indexFile;
+	long last = (index->count == 0) ? 0 : index->offsets[index->count - 1];
+	
+	index->building = false;
+	if (index->scanned != index->size || index->size - last > MAX_CHUNK_SIZE - 1)
+		return;
+	
+	memset(&header, 0, sizeof(struct IndexHeader));
+	memcpy(header.magic, "CWINDEX1", 8);
+	header.size = index->size;
+	header.mtimeSec = index->mtimeSec;
+	header.mtimeNsec = index->mtimeNsec;
+	header.stride = INDEX_STRIDE;
+	header.count = index->count;
+	
+	snprintf(indexName, sizeof(indexName), "%s.cwi", fileName);
+	snprintf(tmpName, sizeof(tmpName), "%s.%d.tmp", indexName, (int) getpid());
+	if ((indexFile = fopen(tmpName, "w")) == NULL)
+	{
+		fprintf(stderr, "error on writing index file \"%s\"\n", indexName);
+		return;
+	}
+	
+	bool written = fwrite(&header, sizeof(struct IndexHeader), 1, indexFile) == 1 &&
+				   fwrite(index->offsets, sizeof(long), index->count, indexFile) == (size_t) index->count;
+	if (fclose(indexFile) == EOF || !written || rename(tmpName, indexName) == -1)
+	{
+		fprintf(stderr, "error on writing index file \"%s\"\n", indexName);
+		unlink(tmpName);
+	}
+}
+
+/**
+ *  \brief Read the range of text handed out to a worker.
+ *
+ *  Operation carried out by the worker processes.
+ *
+ *  \param chunkData chunk data structure, the range is replaced by its text
+ *  \param fileNames file names array
+ *  \param fds file descriptors of the files, -1 while not yet opened
+ *
+ *	\return function execution status (0 if nothing wrong)
+ */
+static int readRange(struct ChunkData* chunkData, char** fileNames, int* fds)
+{
+	int fileId = chunkData->fileId;
+	int done = 0;
+	
+	if (fds[fileId] == -1 && (fds[fileId] = open(fileNames[fileId], O_RDONLY)) == -1)
+	{
+		fprintf(stderr, "error on opening text file \"%s\"\n", fileNames[fileId]);
+		return 1;
+	}
+	
+	while (done < chunkData->chunkSize)
+	{
+		ssize_t n = pread(fds[fileId], chunkData->buffer + done, chunkData->chunkSize - done, chunkData->offset + done);
+		if (n <= 0)
+		{
+			fprintf(stderr, "error on reading text file \"%s\"\n", fileNames[fileId]);
+			return 1;
+		}
+		done += n;
+	}
+	
+	return 0;
 }
 
 /**
@@ -515,13 +848,13 @@ static void printResults(int totalFiles, struct FileResult* fileResults, char**
 {
 	for (int i = 0; i < totalFiles; i++)
 	{
-		int* vowels = fileResults[i].vowels;
+		long* vowels = fileResults[i].vowels;
 		
 		printf("File name: %s\n", fileNames[i]);
-		printf("Total number of words = %d\n", fileResults[i].nWords);
+		printf("Total number of words = %ld\n", fileResults[i].nWords);
 		printf("Number of words with an\n");
 		printf("\tA\tE\tI\tO\tU\tY\n");
-		printf("\t%d\t%d\t%d\t%d\t%d\t%d\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
+		printf("\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
 	}
 }
 
@@ -530,40 +863,241 @@ static void printResults(int totalFiles, struct FileResult* fileResults, char**
  *
  *  Operation carried by worker processes.
  *
+ *  The chunk can be any byte range of a file. Only the words between its first and last separators
+ *  are counted, the runs before the first one and after the last one, and the bytes of the utf-8
+ *  chars cut at both ends, are left in the summary edges to be joined with the neighbour chunks.
+ *
  *	\param buffer buffer to be parsed
  *	\param chunkSize valid size of the buffer
  *
- *  \return file result
+ *  \return chunk summary
  */
-static struct FileResult processChunk(unsigned char* buffer, int chunkSize)
+static struct ChunkSummary processChunk(unsigned char* buffer, int chunkSize)
 {
-	struct FileResult fileResult;
-	fileResult.nWords = 0;
-	setToZero(fileResult.vowels);
+	struct ChunkSummary summary;
+	struct ChunkEdges* edges = &summary.edges;
+	unsigned char UTF8Char[MAX_CHAR_BYTES + 1];
+	bool word = false;
+	unsigned int vowelMask = 0;
+	int cutf8;
+	int curPos = 0;
+	
+	memset(&summary, 0, sizeof(struct ChunkSummary));
+	
+	// leading continuation bytes, they may end the char cut at the start of the chunk
+	while (curPos < chunkSize && edges->headLen < MAX_CHAR_BYTES - 1 && (buffer[curPos] & 0xC0) == 0x80)
+		edges->headBytes[edges->headLen++] = buffer[curPos++];
+	edges->headOnly = (curPos == chunkSize);
+	
+	// bytes of the char cut at the end, it is ended by the next chunk
+	int end = cutCharStart(buffer, curPos, chunkSize);
+	for (int i = end; i < chunkSize; i++)
+		edges->tailBytes[edges->tailLen++] = buffer[i];
+	
+	while ((cutf8 = extractAChar(buffer, &curPos, &end, UTF8Char)) != EOF)
+		addChar(&summary, cutf8, &word, &vowelMask);
 	
-    int inWord = 0;
-    int firstOccur[6];
-    unsigned char UTF8Char[5];
+	// run still open at the end of the chunk
+	if (edges->separator)
+	{
+		edges->tailWord = word;
+		edges->tailVowels = vowelMask;
+	}
+	else
+	{
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
+	}
+	
+	return summary;
+}
+
+/**
+ *  \brief Find the start of the utf-8 char cut by the end of a range of bytes.
+ *
+ *  Auxilar function.
+ *
+ *  The last char of the range is cut when its lead byte announces more bytes than the range still
+ *  has, so it can only start in the last MAX_CHAR_BYTES - 1 bytes.
+ *
+ *	\param bytes range of bytes
+ *	\param from first byte that can start a char
+ *	\param size size of the range
+ *
+ *	\return offset of the lead byte of the char cut, size if no char is cut
+ */
+static int cutCharStart(unsigned char* bytes, int from, int size)
+{
+	for (int i = size - 1; i >= from && i >= size - (MAX_CHAR_BYTES - 1); i--)
+	{
+		// continuation byte
+		if ((bytes[i] & 0xC0) == 0x80)
+			continue;
+		
+		// ascii chars and lone bytes are whole, a lead byte announces the bytes of its char
+		int bytesLen = 1;
+		if ((bytes[i] & 0xC0) == 0xC0 && (bytes[i] & 0xFE) != 0xFE)
+			for (bytesLen = 1; bytes[i] & (0x80 >> bytesLen); bytesLen++);
+		
+		return (bytesLen > size - i) ? i : size;
+	}
+	
+	return size;
+}
+
+/**
+ *  \brief Add a char to the run of chars being read.
+ *
+ *  Auxilar function.
+ *
+ *  A separator closes the run, any other char goes on with it (a word is a run with an alpha numeric
+ *  character or an underscore, and its vowels are counted once).
+ *
+ *	\param summary chunk summary
+ *	\param c character
+ *	\param word the run has word characters
+ *	\param vowelMask vowel bits of the run
+ */
+static void addChar(struct ChunkSummary* summary, int c, bool* word, unsigned int* vowelMask)
+{
+	if (isSeparator(c))
+	{
+		closeRun(summary, *word, *vowelMask);
+		*word = false;
+		*vowelMask = 0;
+	}
+	else
+	{
+		*word |= (c > 64 && c < 91) || (c > 47 && c < 58) || c == '_';
+		if (isVowel(c))
+			*vowelMask |= 1 << vowelOffset(c);
+	}
+}
+
+/**
+ *  \brief Close a run of chars ended by a separator.
+ *
+ *  Auxilar function.
+ *
+ *  The first run closed becomes the head of the summary, any other one is counted right away.
+ *
+ *	\param summary chunk summary
+ *	\param word the run has word characters
+ *	\param vowelMask vowel bits of the run
+ */
+static void closeRun(struct ChunkSummary* summary, bool word, unsigned int vowelMask)
+{
+	struct ChunkEdges* edges = &summary->edges;
+	
+	if (!edges->separator)
+	{
+		edges->separator = true;
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
+	}
+	else if (word)
+	{
+		summary->nWords++;
+		for (int i = 0; i < 6; i++)
+			summary->vowels[i] += (vowelMask >> i) & 1;
+	}
+}
+
+/**
+ *  \brief Join the summary of the next chunk of a file to the summary of the previous ones.
+ *
+ *  Operation carried out by the dispatcher process, for the chunks of each file in order (starting
+ *  from a zeroed summary).
+ *
+ *  The char cut between the chunks is decoded from the bytes at both sides of the cut, then the
+ *  open run of the summary goes on through the head of the next chunk. A chunk made only of head
+ *  bytes may leave the char still cut, for the chunks after it.
+ *
+ *	\param summary summary of the previous chunks
+ *	\param next summary of the next chunk
+ */
+static void joinEdges(struct ChunkSummary* summary, struct ChunkSummary* next)
+{
+	struct ChunkEdges* edges = &summary->edges;
+	struct ChunkEdges* nextEdges = &next->edges;
+	unsigned char bytes[2 * (MAX_CHAR_BYTES - 1)];
+	unsigned char UTF8Char[MAX_CHAR_BYTES + 1];
+	int nBytes = 0;
 	int cutf8;
 	int curPos = 0;
 	
-	while ((cutf8 = extractAChar(buffer, &curPos, &chunkSize, UTF8Char)) != EOF)
+	// open run, after the last separator (or the whole text if there is none)
+	bool word = edges->separator ? edges->tailWord : edges->headWord;
+	unsigned int vowelMask = edges->separator ? edges->tailVowels : edges->headVowels;
+	
+	for (int i = 0; i < edges->tailLen; i++)
+		bytes[nBytes++] = edges->tailBytes[i];
+	for (int i = 0; i < nextEdges->headLen; i++)
+		bytes[nBytes++] = nextEdges->headBytes[i];
+	
+	// chars at the cut
+	int end = nextEdges->headOnly ? cutCharStart(bytes, 0, nBytes) : nBytes;
+	while ((cutf8 = extractAChar(bytes, &curPos, &end, UTF8Char)) != EOF)
+		addChar(summary, cutf8, &word, &vowelMask);
+	
+	// head of the next chunk, then its words
+	word |= nextEdges->headWord;
+	vowelMask |= nextEdges->headVowels;
+	if (nextEdges->separator)
+	{
+		closeRun(summary, word, vowelMask);
+		word = nextEdges->tailWord;
+		vowelMask = nextEdges->tailVowels;
+	}
+	summary->nWords += next->nWords;
+	for (int i = 0; i < 6; i++)
+		summary->vowels[i] += next->vowels[i];
+	
+	if (edges->separator)
+	{
+		edges->tailWord = word;
+		edges->tailVowels = vowelMask;
+	}
+	else
 	{
-		processAChar(cutf8, &inWord, &fileResult.nWords, fileResult.vowels, firstOccur);
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
 	}
 	
-	return fileResult;
+	// bytes of the char cut at the end of the next chunk, or still cut at its start
+	if (nextEdges->headOnly)
+	{
+		for (edges->tailLen = 0; end < nBytes; end++)
+			edges->tailBytes[edges->tailLen++] = bytes[end];
+	}
+	else
+	{
+		edges->tailLen = nextEdges->tailLen;
+		memcpy(edges->tailBytes, nextEdges->tailBytes, nextEdges->tailLen);
+	}
 }
 
 /**
- *  \brief Set all elements of a given array to 0.
+ *  \brief Add the summary of a whole file to its results.
+ *
+ *  Operation carried out by the dispatcher process, once all the chunks of the file were joined.
+ *
+ *  The runs left at the edges are complete, they are cut by the start and the end of the file. A
+ *  char still cut at the end is malformed, neither a word character nor a separator, so it changes
+ *  no run.
  *
- *	\param array buffer to be initialized
+ *	\param fileResult file result
+ *	\param summary summary of the whole file
  */
-static void setToZero(int array[6])
+static void addSummary(struct FileResult* fileResult, struct ChunkSummary* summary)
 {
-    for (int i = 0; i < 6; i++)
-        array[i] = 0;
+	struct ChunkEdges* edges = &summary->edges;
+	bool tailWord = edges->separator && edges->tailWord;
+	unsigned int tailVowels = edges->separator ? edges->tailVowels : 0;
+	
+	fileResult->nWords += summary->nWords + edges->headWord + tailWord;
+	for (int i = 0; i < 6; i++)
+		fileResult->vowels[i] += summary->vowels[i] + ((edges->headVowels >> i) & 1) + ((tailVowels >> i) & 1);
 }
 
 /**
@@ -600,12 +1134,12 @@ static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsi
     // not the first byte of the UTF-8 char (the second most significant bit must be 1 as well)
     else if ((UTF8Char[0] & 0xC0) == 0x80)   // 0xC0 -> [ 1 1 0 0 0 0 0 0 ]
     {
-        return -1;
+        return MALFORMED_CHAR;
     }
     // invalid UTF-8 stream (to be a valid UTF-8 char, it must have one zero in position 0, 2, 3 or 4 of the msb)
     else if ((UTF8Char[0] & 0xFE) == 0xFE)   // 0xFE -> [ 1 1 1 1 1 1 1 0 ]
     {
-        return -1;
+        return MALFORMED_CHAR;
     }
     // UTF-8 char
     else
@@ -614,10 +1148,12 @@ static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsi
         int bytes;
         for (bytes = 1; UTF8Char[0] & (0x80 >> bytes); bytes++);
 
-        // get remaining char bytes
+        // get remaining char bytes, a truncated char is malformed and the byte that cut it is left for the next one
         cutf8 = UTF8Char[0];
         for (int i = 1; i < bytes; i++)
         {
+			if (*curPos >= *chunkSize || (buffer[*curPos] & 0xC0) != 0x80)
+				return MALFORMED_CHAR;
 			UTF8Char[(i * sizeof(char))] = buffer[*curPos];
 			(*curPos)++;
 			
@@ -742,53 +1278,6 @@ static int isVowel(int c)
     return 0;
 }
 
-/**
- *  \brief Process a given character.
- *
- *	\param c character to be checked
- *	\param inWord inWord flag
- *	\param nWords total words
- *	\param nWordswVowel number of vowels per word
- *	\param firstOccur first vowel occurence flag
- */
-static void processAChar(int c, int* inWord, int* nWords, int nWordswVowel[6], int firstOccur[6])
-{
-    // outside a word
-    if (*inWord == 0)
-    {
-        // alpha numeric character or underscore
-        if ((c > 64 && c < 91) || (c > 47 && c < 58) || c == '_')
-        {
-            *inWord = 1;
-            (*nWords)++;
-            setToZero(firstOccur);
-            if (isVowel(c))
-            {
-                nWordswVowel[vowelOffset(c)] += 1;
-                firstOccur[vowelOffset(c)] = 1;
-            }
-        }
-    }
-    // inside a word
-    else 
-    {
-        // space or punctuation symbol or separation symbol
-        if ((c == 0x20 || c == 0x9 || c == 0xA || c == 0xD) || (c == '-' || c == 0x22 || c == 0xE2809C || c == 0xE2809D || c == '[' || c == ']' || c == '(' || c == ')') || (c == '.' || c == ',' || c == ':' || c == ';' || c == '?' || c == '!' || c == 0xE28093 || c == 0xE280A6))
-        {
-            *inWord = 0;
-        }
-        // alpha numeric character or underscore or apostrophe
-        if ((c > 64 && c < 91) || (c > 47 && c < 58) || c == '_' || c == 0x27)
-        {
-            if (isVowel(c) && firstOccur[vowelOffset(c)] == 0)
-            {
-                nWordswVowel[vowelOffset(c)] += 1;
-                firstOccur[vowelOffset(c)] = 1;
-            }
-        }
-    }
-}
-
 /**
  *  \brief Get the offset of a vowel.
  *
@@ -14,6 +14,8 @@
 //	run command
 // 		mpiexec -n 5 ./countWords text0.txt text1.txt text2.txt text3.txt text4.txt
 
+#define _FILE_OFFSET_BITS 64
+
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -35,6 +37,9 @@
 #define FILECOMPLETE	1
 #define FILEERROR	    2
 
+// malformed utf-8 sequence, taken as U+FFFD (neither a word character nor a separator)
+#define MALFORMED_CHAR	0xEFBFBD
+
 //#define DEBUG
 
 // internal functions declaration
@@ -44,11 +49,14 @@ static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* f
 static bool isSeparator(int c);
 static void printResults(int totalFiles, struct FileResult* fileResults, char** fileNames);
 
-static struct FileResult processChunk(unsigned char* buffer, int chunkSize);
-static void setToZero(int array[6]);
+static struct ChunkSummary processChunk(unsigned char* buffer, int chunkSize);
+static int cutCharStart(unsigned char* bytes, int from, int size);
+static void addChar(struct ChunkSummary* summary, int c, bool* word, unsigned int* vowelMask);
+static void closeRun(struct ChunkSummary* summary, bool word, unsigned int vowelMask);
+static void joinEdges(struct ChunkSummary* summary, struct ChunkSummary* next);
+static void addSummary(struct FileResult* fileResult, struct ChunkSummary* summary);
 static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsigned char UTF8Char[5]);
 static int isVowel(int c);
-static void processAChar(int c, int* inWord, int* nWords, int nWordswVowel[6], int firstOccur[6]);
 static int vowelOffset(int c);
 
 /**
@@ -66,7 +74,7 @@ int main(int argc, char *argv[])
 	// MPI initializations
 	int rank, nProc;
 	struct ChunkData *chunkData = NULL;
-	struct FileResult *resultData = NULL;
+	struct ChunkSummary *resultData = NULL;
 	
 	MPI_Init(&argc, &argv);
 	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -95,7 +103,7 @@ int main(int argc, char *argv[])
 		return EXIT_FAILURE;
 	}
 	
-	if (((resultData = malloc(sizeof(struct FileResult))) == NULL))
+	if (((resultData = malloc(sizeof(struct ChunkSummary))) == NULL))
 	{
 		fprintf(stderr, "error on allocating space to the result data buffer\n");
 		MPI_Finalize();
@@ -115,8 +123,11 @@ int main(int argc, char *argv[])
 		//int chunkSize = 0;	// NOT NEEDED, ALREADY IN THE "chunkData" STRUCTURE (DELETE THIS LATER)
 		//bool openFile = true;
 		bool* availWorkers;
-		struct FileResult* resultsBuffer;
+		struct ChunkSummary* resultsBuffer;
+		struct ChunkData* sendBuffers;
 		MPI_Request reqSnd[nProc], reqRec[nProc];
+		struct ChunkSummary* summaries = NULL;		// summary of every chunk handed out, joined in order at the end
+		int totalChunks = 0, maxChunks = 0;
 		
 		// parse command line arguments and initialize file names and file results array
 		if (parseCommandLine(argv, &totalFiles, &fileNames, &fileResults) == 1)
@@ -135,13 +146,22 @@ int main(int argc, char *argv[])
 		for (int i = 0; i < nProc; i++) availWorkers[i] = true;
 		
 		// allocate memory for results buffer
-		if (((resultsBuffer = malloc(nProc * sizeof(struct FileResult))) == NULL))
+		if (((resultsBuffer = malloc(nProc * sizeof(struct ChunkSummary))) == NULL))
 		{
 			fprintf(stderr, "error on allocating space to the results buffer pointers\n");
 			MPI_Finalize();
 			return EXIT_FAILURE;
 		}
 		
+		// allocate one chunk buffer per worker, a buffer is only reused once its send completed
+		if (((sendBuffers = malloc(nProc * sizeof(struct ChunkData))) == NULL))
+		{
+			fprintf(stderr, "error on allocating space to the chunk buffers\n");
+			MPI_Finalize();
+			return EXIT_FAILURE;
+		}
+		for (int i = 0; i < nProc; i++) reqSnd[i] = MPI_REQUEST_NULL;
+		
 		// open first text file
 		if ((currentFile = fopen(fileNames[fileId], "r")) == NULL)
 		{
@@ -161,6 +181,23 @@ int main(int argc, char *argv[])
 				// workers available to receive work
 				if (availWorkers[i])
 				{
+					// previous chunk of this worker was received, its buffer can be refilled
+					MPI_Wait(&reqSnd[i], MPI_STATUS_IGNORE);
+					chunkData = &sendBuffers[i];
+					
+					// number the chunk, its summary is kept until the chunks of its file are joined
+					if (totalChunks == maxChunks)
+					{
+						maxChunks = (maxChunks == 0) ? 1024 : 2 * maxChunks;
+						if (((summaries = realloc(summaries, maxChunks * sizeof(struct ChunkSummary))) == NULL))
+						{
+							fprintf(stderr, "error on allocating space to the chunk summaries\n");
+							MPI_Finalize();
+							return EXIT_FAILURE;
+						}
+					}
+					chunkData->chunkId = totalChunks++;
+					
 					// get chunk of text
 					if (getFileChunk(&chunkData, &currentFile, &fileId) == FILECOMPLETE)
 					{
@@ -180,7 +217,7 @@ int main(int argc, char *argv[])
 					MPI_Isend(chunkData, sizeof(struct ChunkData), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqSnd[i]);
 					
 					// open receiving buffer worker
-					MPI_Irecv(&resultsBuffer[i], sizeof(struct FileResult), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqRec[i]);
+					MPI_Irecv(&resultsBuffer[i], sizeof(struct ChunkSummary), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqRec[i]);
 					availWorkers[i] = false;
 				}
 				// workers already with work assigned
@@ -191,13 +228,11 @@ int main(int argc, char *argv[])
 					// worker delivered results
 					if (hasMessage)
 					{
-						struct FileResult* result = &resultsBuffer[i];
+						struct ChunkSummary* result = &resultsBuffer[i];
 						//printf("Receiving result of file %d in box %d\n", result->fileId, i);
 						
 						// save results
-						fileResults[result->fileId].nWords += result->nWords;
-						for (int j = 0; j < 6; j++)
-							fileResults[result->fileId].vowels[j] += result->vowels[j];
+						summaries[result->chunkId] = *result;
 						
 						availWorkers[i] = true;
 					}
@@ -211,7 +246,7 @@ int main(int argc, char *argv[])
 			{
 				if (availWorkers[i])
 				{
-					MPI_Irecv(&resultsBuffer[i], sizeof(struct FileResult), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqRec[i]);
+					MPI_Irecv(&resultsBuffer[i], sizeof(struct ChunkSummary), MPI_BYTE, i, 0, MPI_COMM_WORLD, &reqRec[i]);
 					availWorkers[i] = false;
 				}
 			}
@@ -241,20 +276,31 @@ int main(int argc, char *argv[])
 			{
 				MPI_Wait(&reqRec[i], MPI_STATUS_IGNORE);
 				
-				struct FileResult* result = &resultsBuffer[i];
+				struct ChunkSummary* result = &resultsBuffer[i];
 				
 				// save results
-				fileResults[result->fileId].nWords += result->nWords;
-				for (int j = 0; j < 6; j++)
-					fileResults[result->fileId].vowels[j] += result->vowels[j];
+				summaries[result->chunkId] = *result;
 				
 				nProc = save;
 			}
 			
+			MPI_Wait(&reqSnd[i], MPI_STATUS_IGNORE);
+			chunkData = &sendBuffers[i];
 			chunkData->hasWork = NOMOREWORK;
 			MPI_Send(chunkData, sizeof(struct ChunkData), MPI_BYTE, i, 0, MPI_COMM_WORLD);
 		}
 		
+		// join the chunk summaries of each file in order, the chunks of a file are numbered one after the other
+		struct ChunkSummary fileSummary;
+		for (int k = 0; k < totalChunks; k++)
+		{
+			if (k == 0 || summaries[k].fileId != summaries[k - 1].fileId)
+				memset(&fileSummary, 0, sizeof(struct ChunkSummary));
+			joinEdges(&fileSummary, &summaries[k]);
+			if (k == totalChunks - 1 || summaries[k + 1].fileId != summaries[k].fileId)
+				addSummary(&fileResults[summaries[k].fileId], &fileSummary);
+		}
+		
 		// print final results
 		//printResults(totalFiles, fileResults, fileNames);
 		
@@ -279,13 +325,14 @@ int main(int argc, char *argv[])
 			
 			*resultData = processChunk(chunkData->buffer, chunkData->chunkSize);
 			resultData->fileId = chunkData->fileId;
+			resultData->chunkId = chunkData->chunkId;
 			
 			//printf("> %d\n", (*resultData).nWords);
 			
 			//printf("%d Sending Results!\n", rank);
 			
 			// send results
-			MPI_Send(resultData, sizeof(struct FileResult), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
+			MPI_Send(resultData, sizeof(struct ChunkSummary), MPI_BYTE, 0, 0, MPI_COMM_WORLD);
 			
 			//printf("%d Results Delivered!\n", rank);
 			
@@ -392,6 +439,10 @@ static int parseCommandLine(char** commandLineArgs, int* totalFiles, char*** fil
  *
  *  Operation carried out by the dispatcher process.
  *
+ *  The file is cut at fixed offsets, every chunk but the last one of a file is MAX_CHUNK_SIZE bytes
+ *  long. The words and the utf-8 chars cut are completed when the chunk summaries are joined, so
+ *  nothing is scanned backwards and the file is never rewound.
+ *
  *  \param chunkData chunk data structure
  *  \param currentFile current file being parsed
  *  \param fileId file identifier
@@ -406,15 +457,15 @@ static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* f
 	(*chunkData)->fileId = *fileId;
 	
 	// read chunk of text
-    if (((*chunkData)->chunkSize = fread((*chunkData)->buffer, 1, MAX_CHUNK_SIZE - 1, *currentFile)) == EOF)
+	(*chunkData)->chunkSize = fread((*chunkData)->buffer, 1, MAX_CHUNK_SIZE, *currentFile);
+	if (ferror(*currentFile))
 	{
 		fprintf(stderr, "error on getting file chunk\n");
 		return FILEERROR;
 	}
-	(*chunkData)->buffer[((*chunkData)->chunkSize - 1)] = '\0';
 	
 	// the file was completely read, point to the next one
-	if ((*chunkData)->chunkSize < MAX_CHUNK_SIZE - 1)
+	if ((*chunkData)->chunkSize < MAX_CHUNK_SIZE)
 	{
 		if (fclose(*currentFile) == EOF)
 		{
@@ -424,108 +475,6 @@ static int getFileChunk(struct ChunkData** chunkData, FILE** currentFile, int* f
 		(*fileId)++;
 		return FILECOMPLETE;
 	}
-	// the file still has content, check if we are in the middle of a word
-	else
-	{
-		long currentFilePos;
-		int c = 0, j = 0, k = 0;
-		char cbuffer[4] = "";
-		
-		// check for uncomplete utf8 character
-		for (int i = (*chunkData)->chunkSize - 1; i >= 0; i--)
-		{
-			// if the character is ascii, we can continue
-			if (j == 0 && ((*chunkData)->buffer[i] & 0x80) == 0)
-			{
-				//printf("ascii char, all good\n");
-				break;
-			}
-			
-			// get how many bytes the utf-8 char occupies
-			int bytes;
-			for (bytes = 1; (*chunkData)->buffer[i] & (0x80 >> bytes); bytes++);
-			
-			// first utf8 byte, check if the buffer has all its content
-			if (bytes > 1)
-			{
-				// uncomplete utf-8 char, backtrack the buffer
-				if (bytes > j)
-				{
-					//printf("uncomplete utf-8 char, backtracking buffer");
-					if ((currentFilePos = ftell(*currentFile)) == -1L)
-					{
-						fprintf(stderr, "error on telling text file\n");
-						return FILEERROR;
-					}
-					if (fseek(*currentFile, currentFilePos - (j + 1), SEEK_SET) != 0)
-					{
-						fprintf(stderr, "error on seeking text file\n");
-						return FILEERROR;
-					}
-					(*chunkData)->chunkSize -= (j + 1);
-				}
-				break;
-			}
-			j++;
-		}
-	
-		// check for separation character
-		j = 0;
-		for (int i = (*chunkData)->chunkSize - 1; i >= 0; i--)
-		{
-			cbuffer[j++] = (*chunkData)->buffer[i];
-			
-			// character is ascii, check if it is separator
-			if (((*chunkData)->buffer[i] & 0x80) == 0)
-			{
-				j = 0;
-				if (isSeparator((*chunkData)->buffer[i]))
-				{
-					//printf("ascci char is separator\n");
-					(*chunkData)->buffer[i] = '\0';
-					break;
-				}
-			}
-			
-			// get how many bytes the current utf-8 char occupies
-			int bytes;
-			for (bytes = 1; (*chunkData)->buffer[i] & (0x80 >> bytes); bytes++);
-			
-			// utf8 char first byte
-			if (bytes > 1)
-			{
-				//printf("checking utf-8 character\n");
-				for (int l = bytes - 1; l >= 0; l--)
-					c = (c << 8) | cbuffer[l];
-				
-				if (isSeparator((*chunkData)->buffer[i]))
-				{
-					//printf("utf-8 char is separator\n");
-					(*chunkData)->buffer[i] = '\0';
-					break;
-				}
-				
-				c = 0;
-			}
-			k++;
-		}
-	
-		//printf("1 chunkSize = %d\n", *chunkSize);
-		
-		if ((currentFilePos = ftell(*currentFile)) == -1L)
-		{
-			fprintf(stderr, "error on telling text file\n");
-			return FILEERROR;
-		}
-		if (fseek(*currentFile, currentFilePos - (k + 1), SEEK_SET) != 0)
-		{
-			fprintf(stderr, "error on seeking text file\n");
-			return FILEERROR;
-		}
-		(*chunkData)->chunkSize -= (k + 1);
-		
-		//printf("2 chunkSize = %d\n", *chunkSize);
-	}
 	
 	return FILECONTINUE;
 }
@@ -556,13 +505,13 @@ static void printResults(int totalFiles, struct FileResult* fileResults, char**
 {
 	for (int i = 0; i < totalFiles; i++)
 	{
-		int* vowels = fileResults[i].vowels;
+		long* vowels = fileResults[i].vowels;
 		
 		printf("File name: %s\n", fileNames[i]);
-		printf("Total number of words = %d\n", fileResults[i].nWords);
+		printf("Total number of words = %ld\n", fileResults[i].nWords);
 		printf("Number of words with an\n");
 		printf("\tA\tE\tI\tO\tU\tY\n");
-		printf("\t%d\t%d\t%d\t%d\t%d\t%d\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
+		printf("\t%ld\t%ld\t%ld\t%ld\t%ld\t%ld\n\n", vowels[A], vowels[E], vowels[I], vowels[O], vowels[U], vowels[Y]);
 	}
 }
 
@@ -571,40 +520,241 @@ static void printResults(int totalFiles, struct FileResult* fileResults, char**
  *
  *  Operation carried by worker processes.
  *
+ *  The chunk can be any byte range of a file. Only the words between its first and last separators
+ *  are counted, the runs before the first one and after the last one, and the bytes of the utf-8
+ *  chars cut at both ends, are left in the summary edges to be joined with the neighbour chunks.
+ *
  *	\param buffer buffer to be parsed
  *	\param chunkSize valid size of the buffer
  *
- *  \return file result
+ *  \return chunk summary
+ */
+static struct ChunkSummary processChunk(unsigned char* buffer, int chunkSize)
+{
+	struct ChunkSummary summary;
+	struct ChunkEdges* edges = &summary.edges;
+	unsigned char UTF8Char[MAX_CHAR_BYTES + 1];
+	bool word = false;
+	unsigned int vowelMask = 0;
+	int cutf8;
+	int curPos = 0;
+	
+	memset(&summary, 0, sizeof(struct ChunkSummary));
+	
+	// leading continuation bytes, they may end the char cut at the start of the chunk
+	while (curPos < chunkSize && edges->headLen < MAX_CHAR_BYTES - 1 && (buffer[curPos] & 0xC0) == 0x80)
+		edges->headBytes[edges->headLen++] = buffer[curPos++];
+	edges->headOnly = (curPos == chunkSize);
+	
+	// bytes of the char cut at the end, it is ended by the next chunk
+	int end = cutCharStart(buffer, curPos, chunkSize);
+	for (int i = end; i < chunkSize; i++)
+		edges->tailBytes[edges->tailLen++] = buffer[i];
+	
+	while ((cutf8 = extractAChar(buffer, &curPos, &end, UTF8Char)) != EOF)
+		addChar(&summary, cutf8, &word, &vowelMask);
+	
+	// run still open at the end of the chunk
+	if (edges->separator)
+	{
+		edges->tailWord = word;
+		edges->tailVowels = vowelMask;
+	}
+	else
+	{
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
+	}
+	
+	return summary;
+}
+
+/**
+ *  \brief Find the start of the utf-8 char cut by the end of a range of bytes.
+ *
+ *  Auxilar function.
+ *
+ *  The last char of the range is cut when its lead byte announces more bytes than the range still
+ *  has, so it can only start in the last MAX_CHAR_BYTES - 1 bytes.
+ *
+ *	\param bytes range of bytes
+ *	\param from first byte that can start a char
+ *	\param size size of the range
+ *
+ *	\return offset of the lead byte of the char cut, size if no char is cut
+ */
+static int cutCharStart(unsigned char* bytes, int from, int size)
+{
+	for (int i = size - 1; i >= from && i >= size - (MAX_CHAR_BYTES - 1); i--)
+	{
+		// continuation byte
+		if ((bytes[i] & 0xC0) == 0x80)
+			continue;
+		
+		// ascii chars and lone bytes are whole, a lead byte announces the bytes of its char
+		int bytesLen = 1;
+		if ((bytes[i] & 0xC0) == 0xC0 && (bytes[i] & 0xFE) != 0xFE)
+			for (bytesLen = 1; bytes[i] & (0x80 >> bytesLen); bytesLen++);
+		
+		return (bytesLen > size - i) ? i : size;
+	}
+	
+	return size;
+}
+
+/**
+ *  \brief Add a char to the run of chars being read.
+ *
+ *  Auxilar function.
+ *
+ *  A separator closes the run, any other char goes on with it (a word is a run with an alpha numeric
+ *  character or an underscore, and its vowels are counted once).
+ *
+ *	\param summary chunk summary
+ *	\param c character
+ *	\param word the run has word characters
+ *	\param vowelMask vowel bits of the run
  */
-static struct FileResult processChunk(unsigned char* buffer, int chunkSize)
+static void addChar(struct ChunkSummary* summary, int c, bool* word, unsigned int* vowelMask)
 {
-	struct FileResult fileResult;
-	fileResult.nWords = 0;
-	setToZero(fileResult.vowels);
+	if (isSeparator(c))
+	{
+		closeRun(summary, *word, *vowelMask);
+		*word = false;
+		*vowelMask = 0;
+	}
+	else
+	{
+		*word |= (c > 64 && c < 91) || (c > 47 && c < 58) || c == '_';
+		if (isVowel(c))
+			*vowelMask |= 1 << vowelOffset(c);
+	}
+}
+
+/**
+ *  \brief Close a run of chars ended by a separator.
+ *
+ *  Auxilar function.
+ *
+ *  The first run closed becomes the head of the summary, any other one is counted right away.
+ *
+ *	\param summary chunk summary
+ *	\param word the run has word characters
+ *	\param vowelMask vowel bits of the run
+ */
+static void closeRun(struct ChunkSummary* summary, bool word, unsigned int vowelMask)
+{
+	struct ChunkEdges* edges = &summary->edges;
 	
-    int inWord = 0;
-    int firstOccur[6];
-    unsigned char UTF8Char[5];
+	if (!edges->separator)
+	{
+		edges->separator = true;
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
+	}
+	else if (word)
+	{
+		summary->nWords++;
+		for (int i = 0; i < 6; i++)
+			summary->vowels[i] += (vowelMask >> i) & 1;
+	}
+}
+
+/**
+ *  \brief Join the summary of the next chunk of a file to the summary of the previous ones.
+ *
+ *  Operation carried out by the dispatcher process, for the chunks of each file in order (starting
+ *  from a zeroed summary).
+ *
+ *  The char cut between the chunks is decoded from the bytes at both sides of the cut, then the
+ *  open run of the summary goes on through the head of the next chunk. A chunk made only of head
+ *  bytes may leave the char still cut, for the chunks after it.
+ *
+ *	\param summary summary of the previous chunks
+ *	\param next summary of the next chunk
+ */
+static void joinEdges(struct ChunkSummary* summary, struct ChunkSummary* next)
+{
+	struct ChunkEdges* edges = &summary->edges;
+	struct ChunkEdges* nextEdges = &next->edges;
+	unsigned char bytes[2 * (MAX_CHAR_BYTES - 1)];
+	unsigned char UTF8Char[MAX_CHAR_BYTES + 1];
+	int nBytes = 0;
 	int cutf8;
 	int curPos = 0;
 	
-	while ((cutf8 = extractAChar(buffer, &curPos, &chunkSize, UTF8Char)) != EOF)
+	// open run, after the last separator (or the whole text if there is none)
+	bool word = edges->separator ? edges->tailWord : edges->headWord;
+	unsigned int vowelMask = edges->separator ? edges->tailVowels : edges->headVowels;
+	
+	for (int i = 0; i < edges->tailLen; i++)
+		bytes[nBytes++] = edges->tailBytes[i];
+	for (int i = 0; i < nextEdges->headLen; i++)
+		bytes[nBytes++] = nextEdges->headBytes[i];
+	
+	// chars at the cut
+	int end = nextEdges->headOnly ? cutCharStart(bytes, 0, nBytes) : nBytes;
+	while ((cutf8 = extractAChar(bytes, &curPos, &end, UTF8Char)) != EOF)
+		addChar(summary, cutf8, &word, &vowelMask);
+	
+	// head of the next chunk, then its words
+	word |= nextEdges->headWord;
+	vowelMask |= nextEdges->headVowels;
+	if (nextEdges->separator)
+	{
+		closeRun(summary, word, vowelMask);
+		word = nextEdges->tailWord;
+		vowelMask = nextEdges->tailVowels;
+	}
+	summary->nWords += next->nWords;
+	for (int i = 0; i < 6; i++)
+		summary->vowels[i] += next->vowels[i];
+	
+	if (edges->separator)
+	{
+		edges->tailWord = word;
+		edges->tailVowels = vowelMask;
+	}
+	else
 	{
-		processAChar(cutf8, &inWord, &fileResult.nWords, fileResult.vowels, firstOccur);
+		edges->headWord = word;
+		edges->headVowels = vowelMask;
 	}
 	
-	return fileResult;
+	// bytes of the char cut at the end of the next chunk, or still cut at its start
+	if (nextEdges->headOnly)
+	{
+		for (edges->tailLen = 0; end < nBytes; end++)
+			edges->tailBytes[edges->tailLen++] = bytes[end];
+	}
+	else
+	{
+		edges->tailLen = nextEdges->tailLen;
+		memcpy(edges->tailBytes, nextEdges->tailBytes, nextEdges->tailLen);
+	}
 }
 
 /**
- *  \brief Set all elements of a given array to 0.
+ *  \brief Add the summary of a whole file to its results.
  *
- *	\param array buffer to be initialized
+ *  Operation carried out by the dispatcher process, once all the chunks of the file were joined.
+ *
+ *  The runs left at the edges are complete, they are cut by the start and the end of the file. A
+ *  char still cut at the end is malformed, neither a word character nor a separator, so it changes
+ *  no run.
+ *
+ *	\param fileResult file result
+ *	\param summary summary of the whole file
  */
-static void setToZero(int array[6])
+static void addSummary(struct FileResult* fileResult, struct ChunkSummary* summary)
 {
-    for (int i = 0; i < 6; i++)
-        array[i] = 0;
+	struct ChunkEdges* edges = &summary->edges;
+	bool tailWord = edges->separator && edges->tailWord;
+	unsigned int tailVowels = edges->separator ? edges->tailVowels : 0;
+	
+	fileResult->nWords += summary->nWords + edges->headWord + tailWord;
+	for (int i = 0; i < 6; i++)
+		fileResult->vowels[i] += summary->vowels[i] + ((edges->headVowels >> i) & 1) + ((tailVowels >> i) & 1);
 }
 
 /**
@@ -641,12 +791,12 @@ static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsi
     // not the first byte of the UTF-8 char (the second most significant bit must be 1 as well)
     else if ((UTF8Char[0] & 0xC0) == 0x80)   // 0xC0 -> [ 1 1 0 0 0 0 0 0 ]
     {
-        return -1;
+        return MALFORMED_CHAR;
     }
     // invalid UTF-8 stream (to be a valid UTF-8 char, it must have one zero in position 0, 2, 3 or 4 of the msb)
     else if ((UTF8Char[0] & 0xFE) == 0xFE)   // 0xFE -> [ 1 1 1 1 1 1 1 0 ]
     {
-        return -1;
+        return MALFORMED_CHAR;
     }
     // UTF-8 char
     else
@@ -655,10 +805,12 @@ static int extractAChar(unsigned char* buffer, int* curPos, int* chunkSize, unsi
         int bytes;
         for (bytes = 1; UTF8Char[0] & (0x80 >> bytes); bytes++);
 
-        // get remaining char bytes
+        // get remaining char bytes, a truncated char is malformed and the byte that cut it is left for the next one
         cutf8 = UTF8Char[0];
         for (int i = 1; i < bytes; i++)
         {
+			if (*curPos >= *chunkSize || (buffer[*curPos] & 0xC0) != 0x80)
+				return MALFORMED_CHAR;
 			UTF8Char[(i * sizeof(char))] = buffer[*curPos];
 			(*curPos)++;
 			
@@ -783,53 +935,6 @@ static int isVowel(int c)
     return 0;
 }
 
-/**
- *  \brief Process a given character.
- *
- *	\param c character to be checked
- *	\param inWord inWord flag
- *	\param nWords total words
- *	\param nWordswVowel number of vowels per word
- *	\param firstOccur first vowel occurence flag
- */
-static void processAChar(int c, int* inWord, int* nWords, int nWordswVowel[6], int firstOccur[6])
-{
-    // outside a word
-    if (*inWord == 0)
-    {
-        // alpha numeric character or underscore
-        if ((c > 64 && c < 91) || (c > 47 && c < 58) || c == '_')
-        {
-            *inWord = 1;
-            (*nWords)++;
-            setToZero(firstOccur);
-            if (isVowel(c))
-            {
-                nWordswVowel[vowelOffset(c)] += 1;
-                firstOccur[vowelOffset(c)] = 1;
-            }
-        }
-    }
-    // inside a word
-    else 
-    {
-        // space or punctuation symbol or separation symbol
-        if ((c == 0x20 || c == 0x9 || c == 0xA || c == 0xD) || (c == '-' || c == 0x22 || c == 0xE2809C || c == 0xE2809D || c == '[' || c == ']' || c == '(' || c == ')') || (c == '.' || c == ',' || c == ':' || c == ';' || c == '?' || c == '!' || c == 0xE28093 || c == 0xE280A6))
-        {
-            *inWord = 0;
-        }
-        // alpha numeric character or underscore or apostrophe
-        if ((c > 64 && c < 91) || (c > 47 && c < 58) || c == '_' || c == 0x27)
-        {
-            if (isVowel(c) && firstOccur[vowelOffset(c)] == 0)
-            {
-                nWordswVowel[vowelOffset(c)] += 1;
-                firstOccur[vowelOffset(c)] = 1;
-            }
-        }
-    }
-}
-
 /**
  *  \brief Get the offset of a vowel.
  *